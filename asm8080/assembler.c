@@ -40,6 +40,7 @@
 FILE *assembly_file 	= NULL;		//input source file
 FILE *object_file 	= NULL;		//output containing loader directives and machine-code file
 FILE *listing_file 	= NULL; 	//output file containing original code and machine code in a readable format
+FILE *symbol_file 	= NULL;		//output file containing the address of every code label
 
 char *assembly_code 	= NULL;		//buffer for assembly code drawn from input file
 token *lines 		= NULL;		//array of line tokens (see line_token_array.h for description of line_tokens)
@@ -69,6 +70,8 @@ int main(int argc, char *argv[])
 	instruction i;			//used to access instructions from the instruction set
 	
 	void	*temporary_ptr = NULL;	
+
+	char	*symbol_filename = NULL;
 	
 	//open asm, object, and listing files
 	if(argc < 3)
@@ -90,6 +93,20 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if((symbol_filename = malloc(strlen(argv[2]) + sizeof(".sym"))) == NULL)
+	{
+		printf("Failed to allocate memory for symbol file name.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	sprintf(symbol_filename, "%s.sym", argv[2]);
+
+	if((symbol_file = fopen(symbol_filename, "w")) == NULL)
+	{
+		printf("Failed to open symbol file.\n");
+		exit(EXIT_FAILURE);
+	}
+
 	if((listing_file = fopen(strcat(argv[2],".list"), "w")) == NULL)
 	{
 		printf("Failed to open assembly file\n");
@@ -535,6 +552,8 @@ int main(int argc, char *argv[])
 
 	fprintf(listing_file, "fi\n");
 
+	WriteSymbolFile(symbol_file, labels);
+
 	printf("Done!\n");
 
 	//close files and free memory
@@ -547,6 +566,12 @@ int main(int argc, char *argv[])
 	fclose(listing_file);
 	listing_file = NULL;
 
+	fclose(symbol_file);
+	symbol_file = NULL;
+
+	free(symbol_filename);
+	symbol_filename = NULL;
+
 	if(assembly_code != NULL)
 	{
 		free(assembly_code);
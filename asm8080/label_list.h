@@ -148,6 +148,25 @@ label FindLabelInOperand(char *operand, label *head)
 	return no_label_found;
 }
 
+/*
+ * Writes one "<address> <label>" line per address label, for the emulator's
+ * sampling profiler; EQU and data labels (index -1) are left out
+ */
+void WriteSymbolFile(FILE *symbol_file, label *head)
+{
+	label *label_node = head;
+
+	while(label_node != NULL)
+	{
+		if(label_node -> index != -1 && label_node -> value != 0x10000)
+		{
+			fprintf(symbol_file, "%04x %s\n", label_node -> value, label_node -> label);
+		}
+
+		label_node = label_node -> next;
+	}
+}
+
 void FreeLabelList(label **head)
 {
 	label 	*current_node,
@@ -0,0 +1,347 @@
+/************************************************************************
+ * 8080 Image Analysis							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Recursive-descent walk of an 8080 image from its entry points and	*
+ * RST vectors, finding basic blocks, call targets and jump tables;	*
+ * shared by the analyzer and the recompiler				*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define IMAGE_SIZE		0x10000
+#define MAX_ENTRY_POINTS	64
+#define MAX_TABLE_ENTRIES	64
+#define MAX_JUMP_TABLES		256
+#define COM_LOAD_ADDRESS	0x0100
+
+//Per-address analysis flags
+#define LOADED			0x01	//byte is part of the image
+#define CODE			0x02	//first byte of a reachable instruction
+#define LEADER			0x04	//first instruction of a basic block
+#define CALL_TARGET		0x08	//called by CALL, Ccc or RST
+#define OPERAND			0x10	//operand byte of a reachable instruction
+
+#define LXI_H			0x21
+#define JMP_OPCODE		0xc3
+#define PCHL_OPCODE		0xe9
+
+uint8_t image[IMAGE_SIZE];
+uint8_t flags[IMAGE_SIZE];
+
+//Addresses still to be walked
+uint16_t pending[IMAGE_SIZE];
+uint32_t pending_count = 0;
+
+typedef struct jump_table_entry
+{
+	uint16_t address;
+	uint16_t entries;
+} jump_table;
+
+jump_table jump_tables[MAX_JUMP_TABLES];
+uint32_t jump_table_count = 0;
+
+static inline uint16_t Word(uint16_t address)
+{
+	return (image[(uint16_t)(address + 1)] << 8) + image[address];
+}
+
+void AddTarget(uint16_t address, uint8_t kind)
+{
+	if(!(flags[address] & LOADED))
+	{
+		return;
+	}
+
+	//each leader is queued once, so pending can't overflow
+	if(!(flags[address] & LEADER))
+	{
+		pending[pending_count++] = address;
+	}
+
+	flags[address] |= LEADER | kind;
+}
+
+/*
+ * Jump tables dispatched by PCHL, with HL last loaded by LXI H in the same walk.
+ * A table of JMP instructions (LXI H, table / DAD / PCHL) makes each JMP a target;
+ * otherwise a table of addresses (... MOV E, M / INX H / MOV D, M / XCHG / PCHL)
+ * makes each entry a target. Either ends at the first entry that can't be code.
+ */
+void FindJumpTable(uint16_t table)
+{
+	uint16_t entries = 0, target;
+
+	if(!(flags[table] & LOADED) || jump_table_count == MAX_JUMP_TABLES)
+	{
+		return;
+	}
+
+	if(image[table] == JMP_OPCODE)
+	{
+		while(entries < MAX_TABLE_ENTRIES && (flags[(uint16_t)(table + entries * 3)] & LOADED)
+		&& image[(uint16_t)(table + entries * 3)] == JMP_OPCODE)
+		{
+			AddTarget(table + entries * 3, 0);
+			entries++;
+		}
+	}
+	else
+	{
+		while(entries < MAX_TABLE_ENTRIES && (flags[(uint16_t)(table + entries * 2)] & LOADED)
+		&& !(flags[(uint16_t)(table + entries * 2)] & (CODE | OPERAND)))
+		{
+			target = Word(table + entries * 2);
+
+			if(!(flags[target] & LOADED) || target == table)
+			{
+				break;
+			}
+
+			AddTarget(target, 0);
+			entries++;
+		}
+	}
+
+	if(entries > 0)
+	{
+		jump_tables[jump_table_count].address = table;
+		jump_tables[jump_table_count].entries = entries;
+		jump_table_count++;
+	}
+}
+
+//Follows straight-line code from address until it leaves or rejoins walked code
+void Walk(uint16_t address)
+{
+	uint8_t opcode, size, i;
+	int32_t hl_constant = -1;
+
+	while((flags[address] & LOADED) && !(flags[address] & CODE))
+	{
+		opcode = image[address];
+		size = instruction_set_data[opcode].size;
+
+		flags[address] |= CODE;
+		for(i = 1; i < size; i++)
+		{
+			flags[(uint16_t)(address + i)] |= OPERAND;
+		}
+
+		if(opcode == LXI_H)
+		{
+			hl_constant = Word(address + 1);
+		}
+
+		//JMP
+		if(opcode == JMP_OPCODE)
+		{
+			AddTarget(Word(address + 1), 0);
+			return;
+		}
+		//RET, PCHL, HLT
+		else if(opcode == 0xc9 || opcode == PCHL_OPCODE || opcode == 0x76)
+		{
+			if(opcode == PCHL_OPCODE && hl_constant >= 0)
+			{
+				FindJumpTable(hl_constant);
+			}
+
+			return;
+		}
+		//Jcc
+		else if((opcode & 0xc7) == 0xc2)
+		{
+			AddTarget(Word(address + 1), 0);
+			AddTarget(address + size, 0);
+		}
+		//CALL, Ccc
+		else if(opcode == 0xcd || (opcode & 0xc7) == 0xc4)
+		{
+			AddTarget(Word(address + 1), CALL_TARGET);
+			AddTarget(address + size, 0);
+		}
+		//RST
+		else if((opcode & 0xc7) == 0xc7)
+		{
+			AddTarget(opcode & 0x38, CALL_TARGET);
+			AddTarget(address + size, 0);
+		}
+		//Rcc, and EI and DI, which end a block (EndsBlock)
+		else if((opcode & 0xc7) == 0xc0 || opcode == 0xfb || opcode == 0xf3)
+		{
+			AddTarget(address + size, 0);
+		}
+
+		address += size;
+	}
+}
+
+void Analyze()
+{
+	uint32_t next = 0;
+
+	while(next < pending_count)
+	{
+		Walk(pending[next++]);
+	}
+}
+
+//End (exclusive) of the basic block starting at the leader start
+uint32_t BlockEnd(uint32_t start)
+{
+	uint32_t address = start;
+	uint8_t opcode;
+
+	do
+	{
+		opcode = image[address];
+		address += instruction_set_data[opcode].size;
+	}
+	while(address < IMAGE_SIZE && (flags[address] & CODE) && !(flags[address] & LEADER) && !EndsBlock(opcode));
+
+	return address > IMAGE_SIZE ? IMAGE_SIZE : address;
+}
+
+static inline uint8_t IsBlockStart(uint32_t address)
+{
+	return (flags[address] & LEADER) && (flags[address] & CODE);
+}
+
+//Marks bytes [address, address + count) as loaded
+void MarkLoaded(uint32_t address, uint32_t count)
+{
+	while(count-- > 0 && address < IMAGE_SIZE)
+	{
+		flags[address++] |= LOADED;
+	}
+}
+
+//Bytes of an object file past the image are left out
+int StoreImageByte(uint32_t address, uint8_t value, void *context)
+{
+	if(address < IMAGE_SIZE)
+	{
+		image[address] = value;
+		MarkLoaded(address, 1);
+	}
+
+	(void)context;
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Object files (.list) hold "CCCCAAAA" lines (byte count, start address)
+ * each followed by that many 2-digit hex bytes, and end with "fi", as the
+ * emulator reads them (ReadProgramFile). Anything else is a raw binary loaded at origin.
+ */
+int LoadImage(char *filename, uint32_t origin)
+{
+	FILE *file;
+	size_t length = strlen(filename), count;
+
+	if(length > 5 && strcmp(filename + length - 5, ".list") == 0)
+	{
+		return ReadProgramFile(filename, StoreImageByte, NULL);
+	}
+
+	if((file = fopen(filename, "rb")) == NULL)
+	{
+		printf("Couldn't open image %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	count = fread(image + origin, 1, IMAGE_SIZE - origin, file);
+	MarkLoaded(origin, count);
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Loads and analyzes the image named on the command line:
+ * [-org <address>] [-entry <address>]... <image> <output>
+ * -org <address>	- load address of a raw binary (default 0x0000, 0x0100 for .com files)
+ * -entry <address>	- additional entry point (0x0000, the RST vectors and a .com's 0x0100 are always used)
+ */
+int AnalyzeCommandLine(int argc, char *argv[], char **image_name, char **output_name)
+{
+	uint32_t entry_points[MAX_ENTRY_POINTS], entry_count = 0, origin = 0, i;
+	size_t length;
+	int option;
+
+	*image_name = NULL;
+	*output_name = NULL;
+
+	for(option = 1; option < argc; option++)
+	{
+		if(strcmp(argv[option], "-org") == 0 && option + 1 < argc)
+		{
+			origin = strtoul(argv[++option], NULL, 16) & 0xffff;
+		}
+		else if(strcmp(argv[option], "-entry") == 0 && option + 1 < argc && entry_count < MAX_ENTRY_POINTS)
+		{
+			entry_points[entry_count++] = strtoul(argv[++option], NULL, 16) & 0xffff;
+		}
+		else if(*image_name == NULL)
+		{
+			*image_name = argv[option];
+		}
+		else if(*output_name == NULL)
+		{
+			*output_name = argv[option];
+		}
+		else
+		{
+			*output_name = NULL;
+			break;
+		}
+	}
+
+	if(*image_name == NULL || *output_name == NULL)
+	{
+		printf("Usage: %s [-org <address>] [-entry <address>]... <image> <output>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	length = strlen(*image_name);
+	if(length > 4 && strcmp(*image_name + length - 4, ".com") == 0)
+	{
+		origin = COM_LOAD_ADDRESS;
+	}
+
+	if(LoadImage(*image_name, origin) != EXIT_SUCCESS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	if(origin == COM_LOAD_ADDRESS)
+	{
+		AddTarget(COM_LOAD_ADDRESS, 0);
+	}
+
+	//reset and the RST vectors (interrupt handlers)
+	for(i = 0; i < 0x40; i += 8)
+	{
+		AddTarget(i, i == 0 ? 0 : CALL_TARGET);
+	}
+
+	for(i = 0; i < entry_count; i++)
+	{
+		AddTarget(entry_points[i], 0);
+	}
+
+	Analyze();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/************************************************************************
+ * 8080 Image Analyzer							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Writes the basic blocks, call targets and jump tables found in an	*
+ * 8080 image as a block map for the emulator's decode cache		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include "machine.h"
+#include "instruction_set.h"
+#include "program.h"
+#include "analysis.h"
+
+/*
+ * Block Map (text)
+ * block <start> <end>		- basic block from start up to (not including) end
+ * call <address>		- subroutine entry (CALL, Ccc or RST target)
+ * table <address> <entries>	- jump table dispatched by PCHL
+ */
+int WriteBlockMap(char *filename, char *image_name)
+{
+	FILE *file;
+	uint32_t address, end, blocks = 0, i;
+
+	if((file = fopen(filename, "w")) == NULL)
+	{
+		printf("Couldn't open block map %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(file, "; block map of %s\n", image_name);
+
+	for(address = 0; address < IMAGE_SIZE; address++)
+	{
+		if(IsBlockStart(address))
+		{
+			end = BlockEnd(address);
+			fprintf(file, "block %04x %04x\n", address, end);
+			blocks++;
+		}
+	}
+
+	for(address = 0; address < IMAGE_SIZE; address++)
+	{
+		if((flags[address] & CALL_TARGET) && (flags[address] & CODE))
+		{
+			fprintf(file, "call %04x\n", address);
+		}
+	}
+
+	for(i = 0; i < jump_table_count; i++)
+	{
+		fprintf(file, "table %04x %u\n", jump_tables[i].address, jump_tables[i].entries);
+	}
+
+	fclose(file);
+
+	printf("%u blocks, %u jump tables written to %s.\n", blocks, jump_table_count, filename);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	char *image_name, *map_name;
+
+	if(AnalyzeCommandLine(argc, argv, &image_name, &map_name) != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	return WriteBlockMap(map_name, image_name);
+}
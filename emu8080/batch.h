@@ -0,0 +1,211 @@
+/************************************************************************
+ * 8080 Emulator Batch Runs						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Headless runs: a program and keyboard input from files, a cycle	*
+ * limit, and the machine's end state written as JSON, with an exit	*
+ * code telling a halt from a timeout, a fault or a signal		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <sys/time.h>
+
+#define MAX_DUMP_RANGES		16
+#define BATCH_DEADLINE_STEP	(1u << 30)	//longest wait between deadlines, inside the 32-bit time's range
+
+//Exit codes of a headless run (EXIT_FAILURE is left for errors before the run)
+typedef enum batch_outcome_type
+{
+	BATCH_HALTED	= 0,
+	BATCH_TIMEOUT	= 2,
+	BATCH_FAULT	= 3,
+	BATCH_INTERRUPTED	= 4		//SIGINT or SIGTERM (StopOnSignal)
+} batch_outcome_code;
+
+const char *const batch_outcome_names[5] = {"halted", "", "timeout", "fault", "interrupted"};
+
+typedef struct dump_range_entry
+{
+	uint32_t start;
+	uint32_t end;					//exclusive
+} dump_range;
+
+uint8_t headless = 0,
+	batch_enabled = 0;			//a cycle limit or fault check is in force
+char *program_file = NULL,
+     *dump_file = NULL;
+FILE *batch_input = NULL;
+
+uint64_t batch_cycle_limit = 0,			//0 for none
+	 batch_cycles_left = 0;			//after the current deadline
+uint32_t batch_deadline = 0;
+batch_outcome_code batch_outcome = BATCH_HALTED;
+uint16_t batch_fault_address = 0;		//instruction that jumped out of memory
+
+dump_range dump_ranges[MAX_DUMP_RANGES];
+uint32_t dump_range_count = 0;
+
+//Keyboard input from the -input file; ERR once it runs out, as if no key were pressed
+int BatchKeyboardByte()
+{
+	return fgetc(batch_input);
+}
+
+//Moves the deadline on by at most BATCH_DEADLINE_STEP, or ends the run if the limit is used up
+void BatchDeadline()
+{
+	uint32_t step;
+
+	if(batch_cycles_left == 0)
+	{
+		batch_outcome = BATCH_TIMEOUT;
+		halt_enable = 1;
+		batch_deadline = time + BATCH_DEADLINE_STEP;
+		return;
+	}
+
+	step = batch_cycles_left > BATCH_DEADLINE_STEP ? BATCH_DEADLINE_STEP : batch_cycles_left;
+	batch_cycles_left -= step;
+	batch_deadline += step;
+}
+
+/*
+ * Called after every instruction. Outside CP/M, code can only run from
+ * volatile memory, so a pc above it is a fault (as in fuzz.h).
+ */
+static inline void BatchCheck(uint16_t address)
+{
+	if((int32_t)(time - batch_deadline) >= 0)
+	{
+		BatchDeadline();
+	}
+
+	if(!cpm_mode && pc >= MEMORY_SIZE && batch_outcome == BATCH_HALTED)
+	{
+		batch_outcome = BATCH_FAULT;
+		batch_fault_address = address;
+		halt_enable = 1;
+	}
+}
+
+void StartBatch()
+{
+	batch_cycles_left = batch_cycle_limit ? batch_cycle_limit : UINT64_MAX;
+	batch_deadline = time;
+	BatchDeadline();
+	batch_enabled = 1;
+}
+
+//Program bytes go straight into memory, which they must fit in
+int StoreProgramByte(uint32_t address, uint8_t value, void *filename)
+{
+	if(address >= MEMORY_SIZE)
+	{
+		printf("Program %s doesn't fit in memory.\n", (char *)filename);
+		return EXIT_FAILURE;
+	}
+
+	memory[address] = value;
+
+	return EXIT_SUCCESS;
+}
+
+int LoadProgramFile(char *filename)
+{
+	return ReadProgramFile(filename, StoreProgramByte, filename);
+}
+
+//Parses <start>:<end> in hex, end exclusive
+int ParseDumpRange(char *option)
+{
+	unsigned int start, end;
+
+	if(sscanf(option, "%x:%x", &start, &end) != 2 || start >= end || end > ADDRESSED_SPACE_SIZE)
+	{
+		printf("Memory to dump is given as <start>:<end> in hex, with start < end <= 10000.\n");
+		return EXIT_FAILURE;
+	}
+
+	if(dump_range_count == MAX_DUMP_RANGES)
+	{
+		printf("At most %d memory ranges can be dumped.\n", MAX_DUMP_RANGES);
+		return EXIT_FAILURE;
+	}
+
+	dump_ranges[dump_range_count].start = start;
+	dump_ranges[dump_range_count].end = end;
+	dump_range_count++;
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * End State (JSON; numbers are decimal, memory is a string of hex bytes)
+ * {"outcome", "fault_address" (faults only), "registers": {...}, "pc", "sp",
+ *  "interrupt_enable", "counters": {...}, "memory": [{"start", "end", "bytes"}...]}
+ * The counters come from stats.h, which -headless turns on.
+ */
+int WriteBatchDump()
+{
+	FILE *file = stdout;
+	struct timeval now;
+	double seconds;
+	uint32_t i, address;
+
+	if(dump_file != NULL && (file = fopen(dump_file, "w")) == NULL)
+	{
+		printf("Couldn't open dump file %s.\n", dump_file);
+		return EXIT_FAILURE;
+	}
+
+	gettimeofday(&now, NULL);
+	seconds = StatsSeconds(&(stats_start.when), &now);
+
+	fprintf(file, "{\n\t\"outcome\": \"%s\",\n", batch_outcome_names[batch_outcome]);
+
+	if(batch_outcome == BATCH_FAULT)
+	{
+		fprintf(file, "\t\"fault_address\": %u,\n", batch_fault_address);
+	}
+
+	fprintf(file, "\t\"registers\": {\"a\": %u, \"b\": %u, \"c\": %u, \"d\": %u, \"e\": %u, \"h\": %u, \"l\": %u, \"flags\": %u},\n",
+		a[0], b[0], c[0], d[0], e[0], h[0], l[0], status[0]);
+	fprintf(file, "\t\"pc\": %u,\n\t\"sp\": %u,\n\t\"interrupt_enable\": %u,\n", pc, sp, interrupt_enable);
+	fprintf(file, "\t\"counters\": {\"cycles\": %llu, \"instructions\": %llu, \"interrupts\": %lu, \"device_events\": %lu,"
+		" \"seconds\": %.6f, \"mips\": %.2f},\n",
+		(unsigned long long)stats_cycles, (unsigned long long)stats_instructions,
+		(unsigned long)interrupts_taken, (unsigned long)device_events,
+		seconds, seconds > 0 ? stats_instructions / seconds / 1e6 : 0);
+	fprintf(file, "\t\"memory\": [");
+
+	for(i = 0; i < dump_range_count; i++)
+	{
+		fprintf(file, "%s\n\t\t{\"start\": %lu, \"end\": %lu, \"bytes\": \"", i ? "," : "",
+			(unsigned long)dump_ranges[i].start, (unsigned long)dump_ranges[i].end);
+
+		for(address = dump_ranges[i].start; address < dump_ranges[i].end; address++)
+		{
+			fprintf(file, "%02x", memory[address]);
+		}
+
+		fprintf(file, "\"}");
+	}
+
+	fprintf(file, "%s]\n}\n", dump_range_count ? "\n\t" : "");
+
+	if(file != stdout)
+	{
+		fclose(file);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,650 @@
+/************************************************************************
+ * 8080 Emulator Benchmarks						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Times the interpreter on microbenchmarks of each instruction class,	*
+ * on a generated program and on assembled programs (.list), with	*
+ * warm-up, repetitions and a comparison against an earlier run		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <math.h>
+#include <sys/time.h>
+
+#include "machine.h"
+#include "instruction_set.h"
+#include "storage.h"
+#include "vt100.h"
+#include "cpm.h"
+#include "coverage.h"
+#include "profile.h"
+#include "trace.h"
+#include "sampler.h"
+#include "shared.h"
+#include "snapshot.h"
+#include "compress.h"
+#include "checkpoint.h"
+#include "stats.h"
+#include "lockstep.h"
+#include "program.h"
+#include "batch.h"
+#include "video.h"
+#include "ui.h"
+#include "core.h"
+#include "splitmix.h"
+
+#define MAX_WORKLOADS		64
+#define MAX_REPETITIONS		100
+#define BENCH_ENTRY		0x0100		//where every generated workload starts
+#define BENCH_SUBROUTINES	0x0040		//RET-ending routines called by the generated code
+#define BENCH_DATA		0x2000		//HL points here (below the device registers)
+#define BENCH_STACK		0x2f00
+#define BENCH_UNROLL		32		//copies of a microbenchmark body per loop
+#define BENCH_GENERATED_END	0x1f00		//end of the generated program
+
+typedef struct bench_workload_entry
+{
+	char name[64];
+	const char *kind;			//micro, generated or program
+	uint8_t image[0x10000];
+	uint32_t low, high;			//extent of the loaded bytes
+	uint16_t entry;
+
+	//results
+	uint32_t repetitions;
+	uint64_t instructions;			//per repetition
+	uint64_t cycles;			//per repetition
+	double ns_per_instruction[MAX_REPETITIONS];
+	double median, mean, deviation, minimum;
+} bench_workload;
+
+/*
+ * Microbenchmark bodies. The operand of a 3-byte jump or call is the next
+ * instruction's address when written as 0x0000, so every branch falls
+ * through to the following copy whether it is taken or not.
+ */
+typedef struct bench_micro_entry
+{
+	const char *name;
+	uint8_t length;
+	uint8_t body[24];
+} bench_micro;
+
+const bench_micro bench_micros[] =
+{
+	{"mov", 8, {0x41, 0x53, 0x48, 0x5a, 0x78, 0x47, 0x51, 0x5f}},
+	{"alu_register", 8, {0x80, 0x89, 0x92, 0x9b, 0xa0, 0xa9, 0xb2, 0xbb}},
+	{"alu_memory", 8, {0x86, 0x8e, 0x96, 0x9e, 0xa6, 0xae, 0xb6, 0xbe}},
+	{"alu_immediate", 16, {0xc6, 0x01, 0xce, 0x02, 0xd6, 0x03, 0xde, 0x04, 0xe6, 0xff, 0xee, 0x55, 0xf6, 0x00, 0xfe, 0x10}},
+	{"inr_dcr", 8, {0x04, 0x05, 0x0c, 0x0d, 0x14, 0x15, 0x1c, 0x1d}},
+	{"load_store", 15, {0x7e, 0x77, 0x3a, 0x10, 0x20, 0x32, 0x11, 0x20, 0x1a, 0x12, 0x22, 0x20, 0x20, 0x13, 0x1b}},
+	{"branch", 15, {0xc3, 0x00, 0x00, 0xc2, 0x00, 0x00, 0xca, 0x00, 0x00, 0xda, 0x00, 0x00, 0xd2, 0x00, 0x00}},
+	{"call_return", 9, {0xcd, BENCH_SUBROUTINES, 0x00, 0xc4, BENCH_SUBROUTINES, 0x00, 0xcc, BENCH_SUBROUTINES, 0x00}},
+	{"stack", 8, {0xc5, 0xe3, 0xe3, 0xc1, 0xf5, 0xf1, 0xd5, 0xd1}}
+};
+
+#define BENCH_MICROS	(sizeof(bench_micros) / sizeof(bench_micro))
+
+//LXI H, BENCH_DATA; LXI D, BENCH_DATA + 0x100; LXI B, 0x0102; LXI SP, BENCH_STACK; MVI A, 01
+const uint8_t bench_prologue[] = {0x21, 0x00, 0x20, 0x11, 0x00, 0x21, 0x01, 0x02, 0x01, 0x31, 0x00, 0x2f, 0x3e, 0x01};
+
+bench_workload *workloads[MAX_WORKLOADS];
+uint32_t workload_count = 0;
+
+uint32_t bench_repetitions = 5,
+	 bench_warmup = 1,
+	 bench_cycles = 20000000;		//emulated cycles per repetition (8 s at 2.5 MHz)
+double bench_threshold = 5;			//percent slower than the baseline that is a regression
+uint64_t bench_seed = 0x8080;
+
+bench_workload *NewWorkload(const char *name, const char *kind)
+{
+	bench_workload *workload;
+
+	if(workload_count == MAX_WORKLOADS)
+	{
+		printf("Too many workloads.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if((workload = calloc(1, sizeof(bench_workload))) == NULL)
+	{
+		printf("Couldn't allocate workload %s.\n", name);
+		exit(EXIT_FAILURE);
+	}
+
+	snprintf(workload -> name, sizeof(workload -> name), "%s", name);
+	workload -> kind = kind;
+	workload -> entry = BENCH_ENTRY;
+	workload -> low = 0;
+	workload -> high = BENCH_ENTRY;
+	workloads[workload_count++] = workload;
+
+	return workload;
+}
+
+//Appends count bytes at the workload's end; subroutines and the entry point are set up by the callers
+void EmitBytes(bench_workload *workload, const uint8_t *bytes, uint32_t count)
+{
+	memcpy(workload -> image + workload -> high, bytes, count);
+	workload -> high += count;
+}
+
+void EmitJump(bench_workload *workload, uint8_t opcode, uint16_t target)
+{
+	uint8_t bytes[3] = {opcode, target & 0xff, target >> 8};
+
+	EmitBytes(workload, bytes, 3);
+}
+
+//Every generated workload can call a RET at BENCH_SUBROUTINES
+void EmitSubroutines(bench_workload *workload, const uint8_t *routine, uint8_t length, uint8_t count)
+{
+	uint8_t i;
+
+	for(i = 0; i < count; i++)
+	{
+		memcpy(workload -> image + BENCH_SUBROUTINES + i * 8, routine, length);
+	}
+}
+
+void AddMicrobenchmarks()
+{
+	bench_workload *workload;
+	const bench_micro *micro;
+	uint8_t opcode, size, ret = 0xc9;
+	uint32_t i, copy, loop;
+	uint16_t target;
+
+	for(i = 0; i < BENCH_MICROS; i++)
+	{
+		micro = &bench_micros[i];
+		workload = NewWorkload(micro -> name, "micro");
+		EmitSubroutines(workload, &ret, 1, 1);
+		EmitBytes(workload, bench_prologue, sizeof(bench_prologue));
+		loop = workload -> high;
+
+		for(copy = 0; copy < BENCH_UNROLL; copy++)
+		{
+			for(size = 0; size < micro -> length; size += instruction_set_data[opcode].size)
+			{
+				opcode = micro -> body[size];
+				target = micro -> body[size + 1] + (micro -> body[size + 2] << 8);
+
+				if(instruction_set_data[opcode].size == 3 && target == 0)
+				{
+					EmitJump(workload, opcode, workload -> high + 3);
+				}
+				else
+				{
+					EmitBytes(workload, micro -> body + size, instruction_set_data[opcode].size);
+				}
+			}
+		}
+
+		EmitJump(workload, 0xc3, loop);
+	}
+}
+
+/*
+ * A straight-line mix of the instructions that leave HL and SP alone, with a
+ * conditional jump or a call every 16 instructions on average, filling the
+ * space up to BENCH_GENERATED_END before jumping back to the start
+ */
+void AddGeneratedProgram()
+{
+	bench_workload *workload = NewWorkload("generated_mix", "generated");
+	const uint8_t registers[5] = {0, 1, 2, 3, 7},			//B, C, D, E, A in the opcode's register field
+		      routine[3] = {0x80, 0xa9, 0xc9};			//ADD B; XRA C; RET
+	uint8_t bytes[2];
+	uint64_t choice;
+
+	EmitSubroutines(workload, routine, sizeof(routine), 8);
+	EmitBytes(workload, bench_prologue, sizeof(bench_prologue));
+
+	while(workload -> high < BENCH_GENERATED_END)
+	{
+		choice = SplitMix64(&bench_seed);
+
+		switch(choice % 16)
+		{
+		case 0:		//JNZ, JC, JPE or JM to the next instruction
+			EmitJump(workload, 0xc2 + ((choice >> 8) & 0x03) * 0x10, workload -> high + 3);
+			break;
+		case 1:		//CALL one of the routines
+			EmitJump(workload, 0xcd, BENCH_SUBROUTINES + ((choice >> 8) & 0x07) * 8);
+			break;
+		case 2:		//MVI r
+		case 3:		//ALU immediate
+			bytes[0] = (choice % 16 == 2) ? 0x06 + (registers[(choice >> 8) % 5] << 3) : 0xc6 + (((uint8_t)(choice >> 8) & 0x07) << 3);
+			bytes[1] = choice >> 16;
+			EmitBytes(workload, bytes, 2);
+			break;
+		case 4:		//INR or DCR r
+			bytes[0] = 0x04 + (registers[(choice >> 8) % 5] << 3) + ((choice >> 12) & 0x01);
+			EmitBytes(workload, bytes, 1);
+			break;
+		case 5:		//ALU M
+			bytes[0] = 0x86 + (((choice >> 8) & 0x07) << 3);
+			EmitBytes(workload, bytes, 1);
+			break;
+		case 6:		//RLC, RRC, RAL, RAR, CMA or CMC
+			bytes[0] = (const uint8_t []){0x07, 0x0f, 0x17, 0x1f, 0x2f, 0x3f}[(choice >> 8) % 6];
+			EmitBytes(workload, bytes, 1);
+			break;
+		case 7:
+		case 8:
+		case 9:
+		case 10:	//ALU r
+			bytes[0] = 0x80 + (((choice >> 8) & 0x07) << 3) + registers[(choice >> 12) % 5];
+			EmitBytes(workload, bytes, 1);
+			break;
+		default:	//MOV r, r
+			bytes[0] = 0x40 + (registers[(choice >> 8) % 5] << 3) + registers[(choice >> 12) % 5];
+			EmitBytes(workload, bytes, 1);
+			break;
+		};
+	}
+
+	EmitJump(workload, 0xc3, BENCH_ENTRY);
+}
+
+//Keeps the span of addresses a program fills, so a reset only copies that much back
+int StoreWorkloadByte(uint32_t address, uint8_t value, void *context)
+{
+	bench_workload *workload = context;
+
+	workload -> image[address] = value;
+	workload -> low = address < workload -> low ? address : workload -> low;
+	workload -> high = address + 1 > workload -> high ? address + 1 : workload -> high;
+
+	return EXIT_SUCCESS;
+}
+
+//Object files (.list) as written by the assembler; they start at 0x0000
+int AddProgram(char *filename)
+{
+	bench_workload *workload;
+	char *name = strrchr(filename, '/');
+
+	workload = NewWorkload(name ? name + 1 : filename, "program");
+	workload -> entry = 0x0000;
+	workload -> low = 0x10000;
+	workload -> high = 0;
+
+	if(ReadProgramFile(filename, StoreWorkloadByte, workload) != EXIT_SUCCESS)
+	{
+		free(workloads[--workload_count]);
+		return EXIT_FAILURE;
+	}
+
+	if(workload -> high == 0)
+	{
+		workload -> low = 0;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+void StartBenchMachine()
+{
+	address_space = calloc(ADDRESSED_SPACE_SIZE, sizeof(uint8_t));
+	hard_disk = calloc(HARD_DISK_SIZE, sizeof(uint8_t));
+	io = calloc(PORTS, sizeof(uint8_t));
+
+	if(address_space == NULL || hard_disk == NULL || io == NULL)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	memory = address_space + MEMORY_START_ADDRESS;
+	video_memory = address_space + VIDEO_MEM_START_ADDRESS;
+	monitor_enabled = 0;
+}
+
+//Puts the workload's bytes back and restarts it, as after a reset with storage ready
+void ResetBenchMachine(bench_workload *workload)
+{
+	memcpy(memory + workload -> low, workload -> image + workload -> low, workload -> high - workload -> low);
+	memset(register_file, 0, sizeof(register_file));
+
+	pc = workload -> entry;
+	sp = BENCH_STACK;
+	halt_enable = 0;
+	interrupt_enable = 0;
+	interrupt_request = 0;
+	interrupt_vector = NO_INTERRUPT;
+	storage_state = READY;
+	storage_op_completion_time = INT_MAX;
+	memory[NV_MEM_CTRL_REG] = RDY;
+}
+
+/*
+ * Runs the workload for bench_cycles cycles, restarting it whenever it halts,
+ * and returns the instructions executed
+ */
+uint64_t RunWorkload(bench_workload *workload, uint64_t *cycles)
+{
+	uint64_t instructions = 0;
+	uint32_t start;
+
+	*cycles = 0;
+
+	while(*cycles < bench_cycles)
+	{
+		ResetBenchMachine(workload);
+		start = time;
+
+		while(!halt_enable && time - start < bench_cycles - *cycles)
+		{
+			ExecuteInstruction();
+			instructions++;
+		}
+
+		*cycles += (uint32_t)(time - start);
+
+		//a program that halts without taking a cycle would never finish the repetition
+		if(time == start)
+		{
+			break;
+		}
+	}
+
+	return instructions;
+}
+
+int CompareDoubles(const void *first, const void *second)
+{
+	double x = *(const double *)first, y = *(const double *)second;
+
+	return (x > y) - (x < y);
+}
+
+void MeasureWorkload(bench_workload *workload)
+{
+	struct timeval before, after;
+	double sorted[MAX_REPETITIONS], sum = 0, squares = 0, elapsed;
+	uint32_t i;
+
+	memset(memory, 0, MEMORY_SIZE);
+
+	for(i = 0; i < bench_warmup; i++)
+	{
+		RunWorkload(workload, &(workload -> cycles));
+	}
+
+	workload -> repetitions = bench_repetitions;
+
+	for(i = 0; i < bench_repetitions; i++)
+	{
+		gettimeofday(&before, NULL);
+		workload -> instructions = RunWorkload(workload, &(workload -> cycles));
+		gettimeofday(&after, NULL);
+
+		elapsed = (after.tv_sec - before.tv_sec) * 1e9 + (after.tv_usec - before.tv_usec) * 1e3;
+		workload -> ns_per_instruction[i] = workload -> instructions ? elapsed / workload -> instructions : 0;
+		sum += workload -> ns_per_instruction[i];
+	}
+
+	memcpy(sorted, workload -> ns_per_instruction, bench_repetitions * sizeof(double));
+	qsort(sorted, bench_repetitions, sizeof(double), CompareDoubles);
+
+	workload -> mean = sum / bench_repetitions;
+	workload -> minimum = sorted[0];
+	workload -> median = (bench_repetitions % 2) ? sorted[bench_repetitions / 2]
+				: (sorted[bench_repetitions / 2 - 1] + sorted[bench_repetitions / 2]) / 2;
+
+	for(i = 0; i < bench_repetitions; i++)
+	{
+		squares += (workload -> ns_per_instruction[i] - workload -> mean) * (workload -> ns_per_instruction[i] - workload -> mean);
+	}
+
+	workload -> deviation = bench_repetitions > 1 ? sqrt(squares / (bench_repetitions - 1)) : 0;
+}
+
+/*
+ * Results File (CSV, one header line)
+ * workload,kind,repetitions,instructions,cycles,median_ns,mean_ns,stddev_ns,min_ns,mips
+ * The ns columns are host nanoseconds per guest instruction; mips is from the median.
+ */
+int WriteCsv(char *filename)
+{
+	FILE *file;
+	bench_workload *workload;
+	uint32_t i;
+
+	if((file = fopen(filename, "w")) == NULL)
+	{
+		printf("Couldn't open %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(file, "workload,kind,repetitions,instructions,cycles,median_ns,mean_ns,stddev_ns,min_ns,mips\n");
+
+	for(i = 0; i < workload_count; i++)
+	{
+		workload = workloads[i];
+		fprintf(file, "%s,%s,%lu,%llu,%llu,%.3f,%.3f,%.3f,%.3f,%.2f\n", workload -> name, workload -> kind,
+			(unsigned long)workload -> repetitions, (unsigned long long)workload -> instructions,
+			(unsigned long long)workload -> cycles, workload -> median, workload -> mean,
+			workload -> deviation, workload -> minimum, workload -> median ? 1e3 / workload -> median : 0);
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+//The same fields as the CSV, as an array of objects, with each repetition's time as well
+int WriteJson(char *filename)
+{
+	FILE *file;
+	bench_workload *workload;
+	uint32_t i, j;
+
+	if((file = fopen(filename, "w")) == NULL)
+	{
+		printf("Couldn't open %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(file, "[\n");
+
+	for(i = 0; i < workload_count; i++)
+	{
+		workload = workloads[i];
+		fprintf(file, "\t{\"workload\": \"%s\", \"kind\": \"%s\", \"repetitions\": %lu, \"instructions\": %llu, \"cycles\": %llu,"
+			" \"median_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"min_ns\": %.3f, \"mips\": %.2f, \"samples_ns\": [",
+			workload -> name, workload -> kind, (unsigned long)workload -> repetitions,
+			(unsigned long long)workload -> instructions, (unsigned long long)workload -> cycles,
+			workload -> median, workload -> mean, workload -> deviation, workload -> minimum,
+			workload -> median ? 1e3 / workload -> median : 0);
+
+		for(j = 0; j < workload -> repetitions; j++)
+		{
+			fprintf(file, "%s%.3f", j ? ", " : "", workload -> ns_per_instruction[j]);
+		}
+
+		fprintf(file, "]}%s\n", i + 1 < workload_count ? "," : "");
+	}
+
+	fprintf(file, "]\n");
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+//Median ns per instruction of the named workload in a results CSV, or 0 if it isn't there
+double BaselineMedian(FILE *baseline, char *name)
+{
+	char line[512], *field;
+	int column;
+
+	rewind(baseline);
+
+	while(fgets(line, sizeof(line), baseline) != NULL)
+	{
+		if((field = strtok(line, ",")) == NULL || strcmp(field, name) != 0)
+		{
+			continue;
+		}
+
+		for(column = 1; column <= 5 && (field = strtok(NULL, ",")) != NULL; column++);
+
+		return field ? strtod(field, NULL) : 0;
+	}
+
+	return 0;
+}
+
+/*
+ * Prints one line per workload, with its change from the baseline if there is one.
+ * Returns EXIT_FAILURE if any workload is more than bench_threshold percent slower.
+ */
+int PrintResults(char *baseline_file)
+{
+	FILE *baseline = NULL;
+	bench_workload *workload;
+	double before, change;
+	uint32_t i;
+	int result = EXIT_SUCCESS;
+
+	if(baseline_file != NULL && (baseline = fopen(baseline_file, "r")) == NULL)
+	{
+		printf("Couldn't open baseline %s.\n", baseline_file);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-24s %-9s %14s %10s %10s %8s%s\n", "workload", "kind", "instructions", "median ns", "stddev", "mips",
+		baseline ? "   baseline   change" : "");
+
+	for(i = 0; i < workload_count; i++)
+	{
+		workload = workloads[i];
+		printf("%-24s %-9s %14llu %10.3f %10.3f %8.2f", workload -> name, workload -> kind,
+			(unsigned long long)workload -> instructions, workload -> median, workload -> deviation,
+			workload -> median ? 1e3 / workload -> median : 0);
+
+		if(baseline && (before = BaselineMedian(baseline, workload -> name)) > 0)
+		{
+			change = 100 * (workload -> median - before) / before;
+			printf(" %10.3f %+7.1f%%%s", before, change, change > bench_threshold ? "  REGRESSION" : "");
+
+			if(change > bench_threshold)
+			{
+				result = EXIT_FAILURE;
+			}
+		}
+
+		printf("\n");
+	}
+
+	if(baseline)
+	{
+		fclose(baseline);
+	}
+
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	char *csv_file = NULL, *json_file = NULL, *baseline_file = NULL;
+	int i, result;
+	uint32_t workload;
+
+	/*
+	 * Options
+	 * -repetitions <count>		- timed repetitions per workload (5)
+	 * -warmup <count>		- untimed repetitions first (1)
+	 * -cycles <count>		- emulated cycles per repetition (20000000)
+	 * -csv <file>			- write the results as CSV
+	 * -json <file>			- write the results as JSON
+	 * -baseline <file>		- compare with a CSV from an earlier run
+	 * -threshold <percent>		- slowdown that counts as a regression (5)
+	 * <program.list>...		- assembled programs to run after the built-in workloads
+	 */
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-repetitions") == 0 && i + 1 < argc)
+		{
+			bench_repetitions = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-warmup") == 0 && i + 1 < argc)
+		{
+			bench_warmup = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-cycles") == 0 && i + 1 < argc)
+		{
+			bench_cycles = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+		{
+			csv_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+		{
+			json_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-baseline") == 0 && i + 1 < argc)
+		{
+			baseline_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-threshold") == 0 && i + 1 < argc)
+		{
+			bench_threshold = strtod(argv[++i], NULL);
+		}
+		else if(argv[i][0] != '-')
+		{
+			break;
+		}
+		else
+		{
+			printf("Usage: %s [-repetitions <count>] [-warmup <count>] [-cycles <count>] [-csv <file>] [-json <file>] [-baseline <file>] [-threshold <percent>] [<program.list>...]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(bench_repetitions < 1 || bench_repetitions > MAX_REPETITIONS)
+	{
+		printf("Repetitions must be from 1 to %d.\n", MAX_REPETITIONS);
+		return EXIT_FAILURE;
+	}
+
+	AddMicrobenchmarks();
+	AddGeneratedProgram();
+
+	for(; i < argc; i++)
+	{
+		if(AddProgram(argv[i]) != EXIT_SUCCESS)
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	StartBenchMachine();
+
+	for(workload = 0; workload < workload_count; workload++)
+	{
+		MeasureWorkload(workloads[workload]);
+	}
+
+	result = PrintResults(baseline_file);
+
+	if((csv_file != NULL && WriteCsv(csv_file) != EXIT_SUCCESS)
+	|| (json_file != NULL && WriteJson(json_file) != EXIT_SUCCESS))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return result;
+}
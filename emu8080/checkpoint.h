@@ -0,0 +1,344 @@
+/************************************************************************
+ * 8080 Emulator Checkpoints						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Snapshot files stored as compressed XOR deltas against a base	*
+ * snapshot, written periodically while the program runs		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define SNAPSHOT_MAGIC		"SNP8080"	//8 bytes with the terminator
+#define SNAPSHOT_PAGE_SIZE	256
+#define SNAPSHOT_PAGES		((sizeof(snapshot) + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE)
+#define SNAPSHOT_BITMAP_SIZE	((SNAPSHOT_PAGES + BYTE - 1) / BYTE)
+#define SNAPSHOT_NAME_SIZE	512
+#define SNAPSHOT_MAX_DEPTH	8		//bases read under one snapshot; checkpoints only ever use one
+#define CHECKPOINT_BASE_NAME	"checkpoint_000000.snap"
+
+/*
+ * Snapshot File
+ * 8 bytes	- "SNP8080\0"
+ * 4 bytes	- sizeof(snapshot), so files from a build with another layout are refused
+ * 4 bytes	- compressed length
+ * 1 byte	- length of the base file's name (0 for none), then the name,
+ *		  relative to this file's directory
+ * compressed	- bitmap of the pages that differ from the base, then the XOR
+ *		  of each of those pages with the base
+ * Integers are little endian. Without a base the delta is against zeros,
+ * so zero pages are left out as well as unchanged ones.
+ */
+
+//options
+char *checkpoint_directory = NULL;
+uint32_t checkpoint_cycles = CLOCK_RATE / 100;	//10 ms of emulated time
+char *restore_file = NULL;
+
+snapshot *checkpoint_base = NULL,
+	 *checkpoint_current = NULL;
+uint32_t checkpoint_count = 0,
+	 last_checkpoint_time = 0;
+
+static inline void WriteLittleEndian(uint32_t value, FILE *file)
+{
+	fputc(value & 0xff, file);
+	fputc((value >> 8) & 0xff, file);
+	fputc((value >> 16) & 0xff, file);
+	fputc((value >> 24) & 0xff, file);
+}
+
+static inline int ReadLittleEndian(uint32_t *value, FILE *file)
+{
+	uint8_t bytes[4];
+
+	if(fread(bytes, 1, 4, file) != 4)
+	{
+		return EXIT_FAILURE;
+	}
+
+	*value = bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + ((uint32_t)bytes[3] << 24);
+
+	return EXIT_SUCCESS;
+}
+
+//Writes save as a delta against base (NULL for none), which is stored in the file named base_name
+int WriteSnapshotFile(char *filename, snapshot *save, snapshot *base, char *base_name)
+{
+	FILE *file;
+	uint8_t *current = (uint8_t *)save,
+		*reference = (uint8_t *)base,
+		*delta, *compressed, changed;
+	size_t page, offset, page_length, length = SNAPSHOT_BITMAP_SIZE, compressed_length, i,
+	       name_length = (base_name != NULL) ? strlen(base_name) : 0;
+
+	if(name_length > 0xff)
+	{
+		printf("Snapshot base name %s is too long.\n", base_name);
+		return EXIT_FAILURE;
+	}
+
+	delta = calloc(SNAPSHOT_BITMAP_SIZE + sizeof(snapshot), 1);
+	compressed = malloc(CompressBound(SNAPSHOT_BITMAP_SIZE + sizeof(snapshot)));
+
+	if(delta == NULL || compressed == NULL)
+	{
+		printf("Couldn't allocate memory for snapshot %s.\n", filename);
+		free(delta);
+		free(compressed);
+		return EXIT_FAILURE;
+	}
+
+	for(page = 0; page < SNAPSHOT_PAGES; page++)
+	{
+		offset = page * SNAPSHOT_PAGE_SIZE;
+		page_length = (offset + SNAPSHOT_PAGE_SIZE > sizeof(snapshot)) ? sizeof(snapshot) - offset : SNAPSHOT_PAGE_SIZE;
+
+		if(reference != NULL && memcmp(current + offset, reference + offset, page_length) == 0)
+		{
+			continue;
+		}
+
+		changed = 0;
+		for(i = 0; i < page_length; i++)
+		{
+			delta[length + i] = current[offset + i] ^ (reference != NULL ? reference[offset + i] : 0);
+			changed |= delta[length + i];
+		}
+
+		if(changed)
+		{
+			delta[page / BYTE] |= 1 << (page % BYTE);
+			length += page_length;
+		}
+	}
+
+	compressed_length = CompressBytes(delta, length, compressed);
+	free(delta);
+
+	if((file = fopen(filename, "wb")) == NULL)
+	{
+		printf("Couldn't open snapshot file %s.\n", filename);
+		free(compressed);
+		return EXIT_FAILURE;
+	}
+
+	fwrite(SNAPSHOT_MAGIC, 1, sizeof(SNAPSHOT_MAGIC), file);
+	WriteLittleEndian(sizeof(snapshot), file);
+	WriteLittleEndian(compressed_length, file);
+	fputc(name_length, file);
+	fwrite(base_name, 1, name_length, file);
+	fwrite(compressed, 1, compressed_length, file);
+	free(compressed);
+
+	//a full disk shows up as a write error or a failed close
+	if(ferror(file) | fclose(file))
+	{
+		printf("Couldn't write snapshot file %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//Reads a snapshot file into save, reading its base first if it has one (depth bases have been read on the way here)
+int ReadSnapshotChain(char *filename, snapshot *save, int depth)
+{
+	FILE *file;
+	char magic[sizeof(SNAPSHOT_MAGIC)], base_path[SNAPSHOT_NAME_SIZE], *directory_end;
+	uint8_t *current = (uint8_t *)save, *delta = NULL, *compressed = NULL;
+	uint32_t snapshot_size, compressed_length;
+	size_t page, offset, page_length, length, position = SNAPSHOT_BITMAP_SIZE, i;
+	int name_length, result = EXIT_FAILURE;
+
+	if((file = fopen(filename, "rb")) == NULL)
+	{
+		printf("Couldn't open snapshot file %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0
+	|| ReadLittleEndian(&snapshot_size, file) != EXIT_SUCCESS || ReadLittleEndian(&compressed_length, file) != EXIT_SUCCESS
+	|| (name_length = fgetc(file)) == EOF)
+	{
+		printf("%s is not a snapshot file.\n", filename);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	if(snapshot_size != sizeof(snapshot))
+	{
+		printf("Snapshot %s was written by a different build of the emulator.\n", filename);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	//the base's name is relative to this file's directory
+	memset(save, 0, sizeof(snapshot));
+
+	if(name_length > 0 && depth == SNAPSHOT_MAX_DEPTH)
+	{
+		printf("Snapshot %s has too many bases (or one that leads back to itself).\n", filename);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	if(name_length > 0)
+	{
+		directory_end = strrchr(filename, '/');
+		i = (directory_end != NULL) ? directory_end - filename + 1 : 0;
+
+		if(i + name_length >= SNAPSHOT_NAME_SIZE)
+		{
+			printf("Snapshot base path of %s is too long.\n", filename);
+			fclose(file);
+			return EXIT_FAILURE;
+		}
+
+		memcpy(base_path, filename, i);
+
+		if(fread(base_path + i, 1, name_length, file) != (size_t)name_length)
+		{
+			printf("%s is not a snapshot file.\n", filename);
+			fclose(file);
+			return EXIT_FAILURE;
+		}
+
+		base_path[i + name_length] = 0;
+
+		if(ReadSnapshotChain(base_path, save, depth + 1) != EXIT_SUCCESS)
+		{
+			fclose(file);
+			return EXIT_FAILURE;
+		}
+	}
+
+	delta = malloc(SNAPSHOT_BITMAP_SIZE + sizeof(snapshot));
+	compressed = malloc(compressed_length);
+
+	if(delta == NULL || compressed == NULL || fread(compressed, 1, compressed_length, file) != compressed_length)
+	{
+		printf("Couldn't read snapshot %s.\n", filename);
+	}
+	else if((length = DecompressBytes(compressed, compressed_length, delta, SNAPSHOT_BITMAP_SIZE + sizeof(snapshot))) < SNAPSHOT_BITMAP_SIZE
+	|| length > SNAPSHOT_BITMAP_SIZE + sizeof(snapshot))
+	{
+		printf("Snapshot %s is corrupt.\n", filename);
+	}
+	else
+	{
+		result = EXIT_SUCCESS;
+
+		for(page = 0; page < SNAPSHOT_PAGES && result == EXIT_SUCCESS; page++)
+		{
+			if(!(delta[page / BYTE] & (1 << (page % BYTE))))
+			{
+				continue;
+			}
+
+			offset = page * SNAPSHOT_PAGE_SIZE;
+			page_length = (offset + SNAPSHOT_PAGE_SIZE > sizeof(snapshot)) ? sizeof(snapshot) - offset : SNAPSHOT_PAGE_SIZE;
+
+			if(position + page_length > length)
+			{
+				printf("Snapshot %s is corrupt.\n", filename);
+				result = EXIT_FAILURE;
+				break;
+			}
+
+			for(i = 0; i < page_length; i++)
+			{
+				current[offset + i] ^= delta[position + i];
+			}
+
+			position += page_length;
+		}
+	}
+
+	fclose(file);
+	free(delta);
+	free(compressed);
+
+	return result;
+}
+
+int ReadSnapshotFile(char *filename, snapshot *save)
+{
+	return ReadSnapshotChain(filename, save, 0);
+}
+
+/*
+ * Writes <checkpoint_directory>/checkpoint_<n>.snap.
+ * The first checkpoint is the base; the rest are deltas against it.
+ * If one can't be written, no more are taken for the rest of the run.
+ */
+void TakeCheckpoint()
+{
+	char filename[SNAPSHOT_NAME_SIZE];
+	int result;
+
+	last_checkpoint_time = time;
+
+	if(checkpoint_base == NULL)
+	{
+		checkpoint_base = calloc(1, sizeof(snapshot));
+		checkpoint_current = calloc(1, sizeof(snapshot));
+
+		if(checkpoint_base == NULL || checkpoint_current == NULL)
+		{
+			printf("Couldn't allocate the checkpoint snapshots.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		SaveMachineState(checkpoint_base);
+		snprintf(filename, sizeof(filename), "%s/" CHECKPOINT_BASE_NAME, checkpoint_directory);
+		result = WriteSnapshotFile(filename, checkpoint_base, NULL, NULL);
+	}
+	else
+	{
+		SaveMachineState(checkpoint_current);
+		snprintf(filename, sizeof(filename), "%s/checkpoint_%06u.snap", checkpoint_directory, checkpoint_count);
+		result = WriteSnapshotFile(filename, checkpoint_current, checkpoint_base, CHECKPOINT_BASE_NAME);
+	}
+
+	if(result != EXIT_SUCCESS)
+	{
+		printf("Checkpointing stopped after %u checkpoints.\n", checkpoint_count);
+		checkpoint_directory = NULL;
+		return;
+	}
+
+	checkpoint_count++;
+}
+
+static inline void CheckpointCheck()
+{
+	if(time - last_checkpoint_time >= checkpoint_cycles)
+	{
+		TakeCheckpoint();
+	}
+}
+
+//Replaces the loaded program with the machine saved in restore_file
+int RestoreSnapshotFile()
+{
+	snapshot *save = malloc(sizeof(snapshot));
+
+	if(save == NULL || ReadSnapshotFile(restore_file, save) != EXIT_SUCCESS)
+	{
+		free(save);
+		return EXIT_FAILURE;
+	}
+
+	RestoreMachineState(save);
+	free(save);
+
+	return EXIT_SUCCESS;
+}
@@ -40,13 +40,21 @@
 #define PSW			6
 
 #define HARD_DISK_SIZE		0xffff		//space in non-volatile memory in bytes
-#define ADDRESSED_SPACE_SIZE	0xffff	
+#define ADDRESSED_SPACE_SIZE	0x10000
 #define MEMORY_START_ADDRESS	0x0000		//volatile memory (0x0000 to 0x2fff) (3 kB)
 #define MEMORY_SIZE		0x3000
 //#define IO_START_ADDRESS	0x3000		//memory-mapped io (0x3000 to 0x3fff)
 //#define IO_SIZE		0x1000
-#define VIDEO_MEM_START_ADDRESS	0x4000		//graphics memory (0x4000 to 0x7fff) (4 kB)	
+#define VIDEO_MEM_START_ADDRESS	0x4000		//graphics memory (0x4000 to 0x7fff) (16 kB)	
 #define VIDEO_MEM_SIZE		0x4000
+#define VIDEO_WIDTH		256		//pixels of 2 bits, four to a byte, leftmost in the high bits
+#define VIDEO_HEIGHT		256
+#define VIDEO_ROW_BYTES		(VIDEO_WIDTH / 4)
+
+#define STORE_VIDEO		0x01		//store_pages: the page is video memory
+#define STORE_CODE		0x02		//store_pages: the page holds decoded code
+#define STORE_WATCH		0x04		//store_pages: the page holds write watchpoints
+
 #define PORTS			256
 
 #define BYTE			8
@@ -63,6 +71,8 @@
 #define KB_CTRL_REG		0x3ff9
 #define KB_DATA_REG		0x3ffa
 
+#define DEVICE_REGISTER_PAGE	0x3f		//high byte of the device registers' addresses
+
 #define INTERRUPT_ENABLE	0x01
 #define RDY			0x02
 #define READ_REQUEST		0x04
@@ -78,6 +88,14 @@ extern uint8_t 	*address_space,
 		*video_memory,
 		*io; 
 
+//Rows of video memory written since the renderer last converted them (video.h)
+extern uint8_t video_dirty_rows[VIDEO_HEIGHT];
+
+//Pages whose stores are tracked (STORE_VIDEO, STORE_CODE, STORE_WATCH), and what a store to decoded code (decode.h) or a watched page (debug.h) calls
+extern uint8_t store_pages[256];
+extern void (*code_store_hook)(uint16_t address, uint32_t count);
+extern void (*watch_store_hook)(uint16_t address, uint32_t count);
+
 extern uint8_t register_file[10];
 
 /*
@@ -145,6 +163,10 @@ extern uint16_t control;
 extern uint8_t interrupt_enable;
 extern uint8_t halt_enable;
 extern uint8_t interrupt_request;
+extern uint32_t interrupts_taken;
+extern uint32_t device_events;
+extern uint32_t decode_cache_hits;
+extern uint32_t decode_cache_misses;
 //---
 
 //USER INTERFACE---
@@ -164,7 +186,7 @@ typedef struct instruction_data
 	const char name[12];		//Instruction mnemonic		
 	const uint8_t size;		//size of instruction in bytes
 	const uint8_t flags;		//flags triggered by instruction
-	const uint8_t duration;		//number of clock cycles instruction takes (instructions marked that have 0xFF have (11 or 17) cc or (5 or 11) cc
+	const uint8_t duration;		//number of clock cycles instruction takes (conditional calls and returns give the not-taken count; taking them adds 6)
 } data; 
 
 //Function that emulates instruction
@@ -186,6 +208,15 @@ typedef enum interrupt_request_device
 
 extern interrupt_device interrupt_vector; 
 
+//Fetches the next instruction (or the pending interrupt's RST) into the instruction register
+void InterruptCheckAndInstructionFetch();
+
+//Per-instruction work after an instruction has run (coverage, peripherals)
+void InstructionComplete(uint16_t instruction_address);
+
+//Fetches, runs and completes one instruction
+void ExecuteInstruction();
+
 typedef enum io_operation_state
 {
 	READY,
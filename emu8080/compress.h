@@ -0,0 +1,154 @@
+/************************************************************************
+ * 8080 Emulator Compression						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Byte-oriented LZ codec (runs are matches at distance 1) for		*
+ * snapshot deltas and other mostly-zero data				*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define LZ_MIN_MATCH		3
+#define LZ_MAX_MATCH		(0x7f + LZ_MIN_MATCH)
+#define LZ_MAX_LITERALS		0x80
+#define LZ_MAX_DISTANCE		0xffff
+#define LZ_HASH_BITS		12
+
+/*
+ * Compressed Stream
+ * 0nnnnnnn			- n + 1 literal bytes follow
+ * 1nnnnnnn <low> <high>	- copy n + 3 bytes from <high><low> bytes back
+ *				  (copies may overlap what they write, so a
+ *				  distance of 1 repeats the last byte)
+ */
+
+//Worst case size of the compressed form of length bytes (all literals)
+static inline size_t CompressBound(size_t length)
+{
+	return length + length / LZ_MAX_LITERALS + 1;
+}
+
+static inline uint32_t LzHash(const uint8_t *bytes)
+{
+	return ((bytes[0] << 16 | bytes[1] << 8 | bytes[2]) * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static inline size_t FlushLiterals(const uint8_t *literals, size_t count, uint8_t *output)
+{
+	size_t written = 0, run;
+
+	while(count > 0)
+	{
+		run = (count > LZ_MAX_LITERALS) ? LZ_MAX_LITERALS : count;
+
+		output[written++] = run - 1;
+		memcpy(output + written, literals, run);
+
+		written += run;
+		literals += run;
+		count -= run;
+	}
+
+	return written;
+}
+
+//Returns the compressed size; output must hold CompressBound(length) bytes
+size_t CompressBytes(const uint8_t *input, size_t length, uint8_t *output)
+{
+	uint32_t last_seen[1 << LZ_HASH_BITS] = {0};	//position + 1 of the last 3 bytes with each hash
+	size_t position = 0, literal_start = 0, written = 0, candidate, match, hash;
+
+	while(position + LZ_MIN_MATCH <= length)
+	{
+		hash = LzHash(input + position);
+		candidate = last_seen[hash];
+		last_seen[hash] = position + 1;
+
+		if(candidate == 0 || position - (candidate - 1) > LZ_MAX_DISTANCE
+		|| memcmp(input + candidate - 1, input + position, LZ_MIN_MATCH) != 0)
+		{
+			position++;
+			continue;
+		}
+
+		candidate--;
+
+		for(match = LZ_MIN_MATCH; match < LZ_MAX_MATCH && position + match < length; match++)
+		{
+			if(input[candidate + match] != input[position + match])
+			{
+				break;
+			}
+		}
+
+		written += FlushLiterals(input + literal_start, position - literal_start, output + written);
+
+		output[written++] = 0x80 | (match - LZ_MIN_MATCH);
+		output[written++] = (position - candidate) & 0xff;
+		output[written++] = (position - candidate) >> 8;
+
+		position += match;
+		literal_start = position;
+	}
+
+	written += FlushLiterals(input + literal_start, length - literal_start, output + written);
+
+	return written;
+}
+
+//Returns the decompressed size, or capacity + 1 if the stream is corrupt or doesn't fit
+size_t DecompressBytes(const uint8_t *input, size_t length, uint8_t *output, size_t capacity)
+{
+	size_t position = 0, written = 0, count, distance;
+	uint8_t control;
+
+	while(position < length)
+	{
+		control = input[position++];
+
+		if(control & 0x80)
+		{
+			if(position + 2 > length)
+			{
+				return capacity + 1;
+			}
+
+			count = (control & 0x7f) + LZ_MIN_MATCH;
+			distance = input[position] + (input[position + 1] << 8);
+			position += 2;
+
+			if(distance == 0 || distance > written || written + count > capacity)
+			{
+				return capacity + 1;
+			}
+
+			for(; count > 0; count--, written++)
+			{
+				output[written] = output[written - distance];
+			}
+		}
+		else
+		{
+			count = control + 1;
+
+			if(position + count > length || written + count > capacity)
+			{
+				return capacity + 1;
+			}
+
+			memcpy(output + written, input + position, count);
+			position += count;
+			written += count;
+		}
+	}
+
+	return written;
+}
@@ -0,0 +1,141 @@
+/************************************************************************
+ * 8080 Emulator Core							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Instruction fetch and execution, and the peripherals polled after	*
+ * every instruction; shared by the emulator and libemu8080		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+//Devices polled after every instruction (keyboard input is only read when asked for)
+uint8_t monitor_enabled = 1,
+	storage_attached = 1,
+	keyboard_attached = 0;
+
+void InterruptCheckAndInstructionFetch()
+{
+	if (interrupt_request && interrupt_enable)
+	{
+		interrupt_request = 0;
+		interrupts_taken++;
+
+		switch (interrupt_vector){
+		case STORAGE_READ:
+			instruction_register = 0xd7;	//RST 02
+			return;
+		case STORAGE_WRITE:
+			instruction_register = 0xdf;	//RST 03
+			return;
+		case KEYBOARD:
+			instruction_register = 0xe7;	//RST 04
+			return;
+		case DISPLAY:
+			instruction_register = 0xef;	//RST 05
+			return;
+		case NO_INTERRUPT: 
+		default:
+			break;
+		};		
+	}
+
+	//printf("Current pc: %2x\n", pc);
+	instruction_register = memory[pc];
+	pc++;
+}
+
+//Work done after every instruction, by the interpreter and the decode cache alike
+void InstructionComplete(uint16_t instruction_address)
+{
+	if(coverage_enabled)
+	{
+		RecordCoverage(instruction_address);
+	}
+
+	if(profile_enabled)
+	{
+		RecordProfile(instruction_address);
+	}
+
+	if(trace_enabled)
+	{
+		RecordTrace(instruction_address);
+	}
+
+	if(sample_enabled)
+	{
+		SampleCheck(instruction_address);
+	}
+
+	if(stats_enabled)
+	{
+		CountInstruction();
+	}
+
+	if(lockstep_enabled)
+	{
+		LockstepCheck(instruction_address);
+	}
+
+	if(batch_enabled)
+	{
+		BatchCheck(instruction_address);
+	}
+
+	if(checkpoint_directory != NULL)
+	{
+		CheckpointCheck();
+	}
+
+	//CP/M programs have no memory-mapped peripherals or monitor
+	if(!cpm_mode)
+	{
+		//printf("Control Register: %x\n", memory[NV_MEM_CTRL_REG]);
+		if(monitor_enabled)
+		{
+			PrintMachineState();
+		}
+
+		if(storage_attached)
+		{
+			NonVolatileMemoryOperation();
+		}
+
+		if(keyboard_attached)
+		{
+			ReadKeyboardInput();
+		}
+
+		if(video_enabled)
+		{
+			VideoCheck();
+		}
+
+		if(ui_enabled)
+		{
+			UiCheck();
+		}
+	}
+}
+
+void ExecuteInstruction()
+{
+	uint16_t instruction_address = pc;
+
+	//fetches interrupt vector or next-instruction-in-program to instruction register
+	InterruptCheckAndInstructionFetch();
+
+	//decode - execute - store
+	instruction_set[instruction_register]			//calls the instruction-emulating function
+		(&instruction_set_data[instruction_register]);	//passes references to data needed to carry out instruction
+
+	InstructionComplete(instruction_address);
+}
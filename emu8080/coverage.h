@@ -0,0 +1,182 @@
+/************************************************************************
+ * 8080 Emulator Code Coverage						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Bitmaps of executed addresses and of the directions taken by	*
+ * conditional branches, with export and merging of saved maps		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define COVERAGE_MAP_SIZE	(0x10000 / BYTE)
+#define COVERAGE_MAGIC		"COV8080"	//8 bytes with the terminator
+
+/*
+ * Coverage File (binary)
+ * 8 bytes	- "COV8080\0"
+ * 8 KiB	- executed map
+ * 8 KiB	- taken map (conditional branch at the address jumped, called or returned)
+ * 8 KiB	- not-taken map (conditional branch at the address fell through)
+ * Bit (address & 7) of byte (address >> 3) stands for address.
+ */
+typedef struct coverage_maps
+{
+	uint8_t executed[COVERAGE_MAP_SIZE];
+	uint8_t taken[COVERAGE_MAP_SIZE];
+	uint8_t not_taken[COVERAGE_MAP_SIZE];
+} __attribute__ ((aligned (16))) coverage_data;
+
+//16-byte vector for merging maps with SIMD OR
+typedef uint8_t coverage_vector __attribute__ ((vector_size (16)));
+
+coverage_data coverage;
+uint8_t coverage_enabled = 0;
+char *coverage_file = NULL;
+
+static inline uint8_t IsConditionalBranch(uint8_t opcode)
+{
+	//Jcc - 11ccc010, Ccc - 11ccc100, Rcc - 11ccc000
+	return (opcode & 0xc7) == 0xc2 || (opcode & 0xc7) == 0xc4 || (opcode & 0xc7) == 0xc0;
+}
+
+//Called after the instruction at address has executed
+static inline void RecordCoverage(uint16_t address)
+{
+	uint8_t bit = 1 << (address & 0x07);
+
+	coverage.executed[address >> 3] |= bit;
+
+	if(IsConditionalBranch(instruction_register))
+	{
+		if(pc != (uint16_t)(address + instruction_set_data[instruction_register].size))
+		{
+			coverage.taken[address >> 3] |= bit;
+		}
+		else
+		{
+			coverage.not_taken[address >> 3] |= bit;
+		}
+	}
+}
+
+//ORs source into destination, 16 bytes at a time
+void MergeCoverageMaps(coverage_data *destination, coverage_data *source)
+{
+	coverage_vector *to = (coverage_vector *)destination,
+			*from = (coverage_vector *)source;
+	size_t i;
+
+	for(i = 0; i < sizeof(coverage_data) / sizeof(coverage_vector); i++)
+	{
+		to[i] |= from[i];
+	}
+}
+
+int ReadCoverage(char *filename, coverage_data *maps)
+{
+	FILE *file;
+	char magic[sizeof(COVERAGE_MAGIC)];
+
+	if((file = fopen(filename, "rb")) == NULL)
+	{
+		printf("Couldn't open coverage file %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, COVERAGE_MAGIC, sizeof(magic)) != 0
+	|| fread(maps, sizeof(coverage_data), 1, file) != 1)
+	{
+		printf("%s is not a coverage file.\n", filename);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Writes the maps to filename.
+ * Files ending in .txt get one line per executed address instead:
+ * <address> [T][N]	- T/N: the branch at the address was taken/not taken
+ */
+int WriteCoverage(char *filename, coverage_data *maps)
+{
+	FILE *file;
+	size_t length = strlen(filename);
+	uint32_t address;
+	uint8_t bit;
+
+	if((file = fopen(filename, "wb")) == NULL)
+	{
+		printf("Couldn't open coverage file %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	if(length > 4 && strcmp(filename + length - 4, ".txt") == 0)
+	{
+		for(address = 0; address < 0x10000; address++)
+		{
+			bit = 1 << (address & 0x07);
+
+			if(maps -> executed[address >> 3] & bit)
+			{
+				fprintf(file, "%04x %s%s\n", address,
+					(maps -> taken[address >> 3] & bit) ? "T" : "",
+					(maps -> not_taken[address >> 3] & bit) ? "N" : "");
+			}
+		}
+	}
+	else
+	{
+		fwrite(COVERAGE_MAGIC, 1, sizeof(COVERAGE_MAGIC), file);
+		fwrite(maps, sizeof(coverage_data), 1, file);
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+//Merges the coverage files from many runs into one (binary or text, by the output's name)
+int MergeCoverageFiles(char *output, int count, char *inputs[])
+{
+	coverage_data *merged = calloc(1, sizeof(coverage_data)),
+		      *input = malloc(sizeof(coverage_data));
+	int i, result = EXIT_SUCCESS;
+
+	if(merged == NULL || input == NULL)
+	{
+		printf("Couldn't allocate coverage maps to merge.\n");
+		free(merged);
+		free(input);
+		return EXIT_FAILURE;
+	}
+
+	for(i = 0; i < count && result == EXIT_SUCCESS; i++)
+	{
+		if((result = ReadCoverage(inputs[i], input)) == EXIT_SUCCESS)
+		{
+			MergeCoverageMaps(merged, input);
+		}
+	}
+
+	if(result == EXIT_SUCCESS)
+	{
+		result = WriteCoverage(output, merged);
+	}
+
+	free(merged);
+	free(input);
+
+	return result;
+}
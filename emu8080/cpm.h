@@ -0,0 +1,659 @@
+/************************************************************************
+ * 8080 Emulator CP/M Support						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Loads CP/M .COM programs at 0x0100 and services their BDOS calls	*
+ * with host-side C functions instead of an emulated BDOS		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <ctype.h>
+#include <dirent.h>
+
+#define CPM_TPA_ADDRESS		0x0100		//.COM programs are loaded and started here
+#define CPM_BDOS_ADDRESS	0x0005		//programs reach the BDOS with CALL 5
+#define CPM_BDOS_ENTRY		0xfe00		//top of the TPA; holds the trap opcode
+#define CPM_DEFAULT_DMA		0x0080
+#define CPM_FCB_1		0x005c
+#define CPM_FCB_2		0x006c
+#define CPM_FCB_SIZE		36		//with the random record bytes
+#define CPM_RECORD_SIZE		128
+#define CPM_EOF			0x1a
+
+/*
+ * 0xED is an unused opcode (treated as NOP by the interpreter), so the BDOS
+ * entry point holds it and only CP/M mode points its instruction_set[] slot
+ * at BdosTrap. The dispatch of every other opcode is untouched.
+ */
+#define BDOS_TRAP_OPCODE	0xed
+
+//File Control Block offsets
+#define FCB_DRIVE		0
+#define FCB_NAME		1
+#define FCB_TYPE		9
+#define FCB_EX			12
+#define FCB_RC			15
+#define FCB_NEW_NAME		17
+#define FCB_CR			32
+#define FCB_R0			33
+
+uint8_t cpm_mode = 0;
+char *cpm_directory = ".";		//host directory that stands in for every CP/M drive
+
+uint16_t cpm_dma = CPM_DEFAULT_DMA;
+uint8_t cpm_current_disk = 0;
+
+DIR *cpm_search = NULL;			//directory stream for Search First/Search Next
+uint8_t cpm_search_pattern[11];
+
+//Converts the 11-byte name in an FCB into a lower-case host path inside cpm_directory
+void FcbToHostPath(uint8_t *name, char *path, int path_size)
+{
+	char filename[13];
+	int i, length = 0;
+
+	for(i = 0; i < 8 && (name[i] & 0x7f) != ' '; i++)
+	{
+		filename[length++] = tolower(name[i] & 0x7f);
+	}
+
+	if((name[8] & 0x7f) != ' ')
+	{
+		filename[length++] = '.';
+
+		for(i = 8; i < 11 && (name[i] & 0x7f) != ' '; i++)
+		{
+			filename[length++] = tolower(name[i] & 0x7f);
+		}
+	}
+
+	filename[length] = 0;
+
+	snprintf(path, path_size, "%s/%s", cpm_directory, filename);
+}
+
+//Converts a host filename into the 11-byte, space-padded, upper-case CP/M form; returns 0 if it doesn't fit
+int HostNameToFcb(char *filename, uint8_t *name, uint8_t wildcards)
+{
+	int i = 0, j;
+	char *dot = strrchr(filename, '.');
+
+	memset(name, ' ', 11);
+
+	for(j = 0; filename[j] != 0 && filename + j != dot; j++)
+	{
+		if(wildcards && filename[j] == '*')
+		{
+			for(; i < 8; i++)
+			{
+				name[i] = '?';
+			}
+			continue;
+		}
+
+		if(i >= 8)
+		{
+			return 0;
+		}
+
+		name[i++] = toupper(filename[j]);
+	}
+
+	if(dot != NULL)
+	{
+		for(i = 8, j = 1; dot[j] != 0; j++)
+		{
+			if(wildcards && dot[j] == '*')
+			{
+				for(; i < 11; i++)
+				{
+					name[i] = '?';
+				}
+				continue;
+			}
+
+			if(i >= 11)
+			{
+				return 0;
+			}
+
+			name[i++] = toupper(dot[j]);
+		}
+	}
+
+	return 1;
+}
+
+static inline uint32_t FcbSequentialRecord(uint8_t *fcb)
+{
+	return fcb[FCB_EX] * CPM_RECORD_SIZE + fcb[FCB_CR];
+}
+
+static inline void FcbSetSequentialRecord(uint8_t *fcb, uint32_t record)
+{
+	fcb[FCB_EX] = (record / CPM_RECORD_SIZE) & 0x1f;
+	fcb[FCB_CR] = record % CPM_RECORD_SIZE;
+}
+
+static inline uint32_t FcbRandomRecord(uint8_t *fcb)
+{
+	return fcb[FCB_R0] + (fcb[FCB_R0 + 1] << 8) + ((fcb[FCB_R0 + 2] & 0x03) << 16);
+}
+
+//Reads one 128-byte record into the DMA buffer (0 - success, 1 - end of file, 0xff - no file)
+uint8_t ReadRecord(uint8_t *fcb, uint32_t record)
+{
+	char path[512];
+	FILE *file;
+	size_t bytes_read;
+
+	FcbToHostPath(fcb + FCB_NAME, path, sizeof(path));
+
+	if((file = fopen(path, "rb")) == NULL)
+	{
+		return 0xff;
+	}
+
+	bytes_read = 0;
+	if(fseek(file, (long)record * CPM_RECORD_SIZE, SEEK_SET) == 0)
+	{
+		bytes_read = fread(memory + cpm_dma, 1, CPM_RECORD_SIZE, file);
+	}
+
+	fclose(file);
+
+	if(bytes_read == 0)
+	{
+		return 1;
+	}
+
+	memset(memory + cpm_dma + bytes_read, CPM_EOF, CPM_RECORD_SIZE - bytes_read);
+	MarkStoreRange(cpm_dma, CPM_RECORD_SIZE);
+
+	return 0;
+}
+
+//Writes the DMA buffer as one 128-byte record (0 - success, 0xff - no file)
+uint8_t WriteRecord(uint8_t *fcb, uint32_t record)
+{
+	char path[512];
+	FILE *file;
+	uint8_t result = 0;
+
+	FcbToHostPath(fcb + FCB_NAME, path, sizeof(path));
+
+	if((file = fopen(path, "r+b")) == NULL)
+	{
+		return 0xff;
+	}
+
+	if(fseek(file, (long)record * CPM_RECORD_SIZE, SEEK_SET) != 0
+	|| fwrite(memory + cpm_dma, 1, CPM_RECORD_SIZE, file) != CPM_RECORD_SIZE)
+	{
+		result = 2;	//disk full
+	}
+
+	fclose(file);
+
+	return result;
+}
+
+long HostFileSize(uint8_t *fcb)
+{
+	char path[512];
+	FILE *file;
+	long size;
+
+	FcbToHostPath(fcb + FCB_NAME, path, sizeof(path));
+
+	if((file = fopen(path, "rb")) == NULL)
+	{
+		return -1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fclose(file);
+
+	return size;
+}
+
+//Reads the CP/M name of the next file in directory matching pattern ('?' matches any character); returns 0 if none are left
+int NextMatchingFile(DIR *directory, uint8_t *pattern, uint8_t *name)
+{
+	struct dirent *entry;
+	int i;
+
+	while((entry = readdir(directory)) != NULL)
+	{
+		if(entry -> d_name[0] == '.' || !HostNameToFcb(entry -> d_name, name, 0))
+		{
+			continue;
+		}
+
+		for(i = 0; i < 11; i++)
+		{
+			if(pattern[i] != '?' && (pattern[i] & 0x7f) != name[i])
+			{
+				break;
+			}
+		}
+
+		if(i == 11)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+//Writes the next directory entry matching cpm_search_pattern to the DMA buffer (0 - found, 0xff - none left)
+uint8_t SearchNext()
+{
+	uint8_t name[11];
+
+	if(cpm_search == NULL)
+	{
+		return 0xff;
+	}
+
+	if(NextMatchingFile(cpm_search, cpm_search_pattern, name))
+	{
+		memset(memory + cpm_dma, 0, 32);
+		memcpy(memory + cpm_dma + FCB_NAME, name, 11);
+		MarkStoreRange(cpm_dma, 32);
+
+		return 0;
+	}
+
+	closedir(cpm_search);
+	cpm_search = NULL;
+
+	return 0xff;
+}
+
+uint8_t SearchFirst(uint8_t *fcb)
+{
+	if(cpm_search != NULL)
+	{
+		closedir(cpm_search);
+	}
+
+	memcpy(cpm_search_pattern, fcb + FCB_NAME, 11);
+	cpm_search = opendir(cpm_directory);
+
+	return SearchNext();
+}
+
+//Removes every file matching the FCB's name, which may hold '?'; guest memory is left alone (0 - removed, 0xff - none found)
+uint8_t DeleteFiles(uint8_t *fcb)
+{
+	DIR *directory;
+	uint8_t name[11],
+		result = 0xff;
+	char path[512];
+
+	if((directory = opendir(cpm_directory)) == NULL)
+	{
+		return 0xff;
+	}
+
+	while(NextMatchingFile(directory, fcb + FCB_NAME, name))
+	{
+		FcbToHostPath(name, path, sizeof(path));
+
+		if(remove(path) == 0)
+		{
+			result = 0;
+		}
+	}
+
+	closedir(directory);
+
+	return result;
+}
+
+uint8_t ReadConsoleCharacter()
+{
+	int character = getchar();
+
+	if(character == EOF)
+	{
+		return CPM_EOF;
+	}
+
+	return (character == '\n') ? '\r' : character;
+}
+
+//Read Console Buffer - first byte is the buffer size, second byte receives the count
+void ReadConsoleBuffer(uint16_t address)
+{
+	uint8_t size = memory[address],
+		count = 0;
+	int character;
+
+	fflush(stdout);
+
+	while(count < size && (character = getchar()) != EOF && character != '\n')
+	{
+		memory[(uint16_t)(address + 2 + count)] = character;
+		count++;
+	}
+
+	memory[(uint16_t)(address + 1)] = count;
+	MarkStoreRange(address + 1, count + 1);
+}
+
+//FCB and DMA buffers are used in place, so the functions that take them need them below the top of memory
+static inline uint8_t BdosBuffersFit(uint8_t function)
+{
+	switch(function)
+	{
+	case 15: case 16: case 19: case 22: case 23: case 35: case 36:
+		return d_pair[0] <= ADDRESSED_SPACE_SIZE - CPM_FCB_SIZE;
+	case 17: case 20: case 21: case 33: case 34: case 40:
+		return d_pair[0] <= ADDRESSED_SPACE_SIZE - CPM_FCB_SIZE && cpm_dma <= ADDRESSED_SPACE_SIZE - CPM_RECORD_SIZE;
+	case 18:
+		return cpm_dma <= ADDRESSED_SPACE_SIZE - CPM_RECORD_SIZE;
+	default:
+		return 1;
+	};
+}
+
+//Result in A and L, then back to the caller as if the BDOS executed a RET
+static inline void BdosReturn(uint8_t result, data *in)
+{
+	a[0] = result;
+	l[0] = result;
+	b[0] = 0;
+	h[0] = 0;
+
+	pc = PopWord();
+
+	time += in -> duration;
+}
+
+/*
+ * BDOS Call
+ * Function number in C, parameter in E or DE.
+ * Single-byte results are returned in A and L (with B and H cleared),
+ * and control returns to the caller as if the BDOS executed a RET.
+ */
+void BdosTrap(data *in)
+{
+	uint8_t function = c[0],
+		*fcb = memory + d_pair[0],
+		result = 0;
+	char path[512], new_path[512];
+	uint16_t string;
+	uint32_t record, length;
+	int character;
+	long size;
+	FILE *file;
+
+	device_events++;
+
+	//answered as for a missing file
+	if(!BdosBuffersFit(function))
+	{
+		BdosReturn(0xff, in);
+		return;
+	}
+
+	switch(function)
+	{
+	case 0:		//System Reset
+		halt_enable |= 0x01;
+		break;
+	case 1:		//Console Input
+		result = ReadConsoleCharacter();
+		break;
+	case 2:		//Console Output
+		putchar(e[0]);
+		break;
+	case 6:		//Direct Console I/O
+		if(e[0] == 0xff)
+		{
+			result = ReadConsoleCharacter();
+		}
+		else if(e[0] != 0xfe)
+		{
+			putchar(e[0]);
+		}
+		break;
+	case 9:		//Print String ('$'-terminated, at most all of memory)
+		for(string = d_pair[0], length = 0; length < ADDRESSED_SPACE_SIZE && memory[string] != '$'; string++, length++)
+		{
+			putchar(memory[string]);
+		}
+		break;
+	case 10:	//Read Console Buffer
+		ReadConsoleBuffer(d_pair[0]);
+		break;
+	case 11:	//Get Console Status
+		fflush(stdout);
+		if((character = getchar()) != EOF)
+		{
+			ungetc(character, stdin);
+			result = 0xff;
+		}
+		break;
+	case 12:	//Return Version Number (CP/M 2.2)
+		result = 0x22;
+		break;
+	case 13:	//Reset Disk System
+		cpm_dma = CPM_DEFAULT_DMA;
+		cpm_current_disk = 0;
+		break;
+	case 14:	//Select Disk
+		cpm_current_disk = e[0];
+		break;
+	case 15:	//Open File
+		if((size = HostFileSize(fcb)) < 0)
+		{
+			result = 0xff;
+			break;
+		}
+		//record count of the extent named in the FCB
+		record = (size + CPM_RECORD_SIZE - 1) / CPM_RECORD_SIZE;
+		record = (record > fcb[FCB_EX] * CPM_RECORD_SIZE) ? record - fcb[FCB_EX] * CPM_RECORD_SIZE : 0;
+		fcb[FCB_RC] = (record > 0x80) ? 0x80 : record;
+		fcb[FCB_CR] = 0;
+		break;
+	case 16:	//Close File
+		result = (HostFileSize(fcb) < 0) ? 0xff : 0;
+		break;
+	case 17:	//Search First
+		result = SearchFirst(fcb);
+		break;
+	case 18:	//Search Next
+		result = SearchNext();
+		break;
+	case 19:	//Delete File
+		result = DeleteFiles(fcb);
+		break;
+	case 20:	//Read Sequential
+		record = FcbSequentialRecord(fcb);
+		if((result = ReadRecord(fcb, record)) == 0)
+		{
+			FcbSetSequentialRecord(fcb, record + 1);
+		}
+		break;
+	case 21:	//Write Sequential
+		record = FcbSequentialRecord(fcb);
+		if((result = WriteRecord(fcb, record)) == 0)
+		{
+			FcbSetSequentialRecord(fcb, record + 1);
+		}
+		break;
+	case 22:	//Make File
+		FcbToHostPath(fcb + FCB_NAME, path, sizeof(path));
+		if((file = fopen(path, "wb")) == NULL)
+		{
+			result = 0xff;
+			break;
+		}
+		fclose(file);
+		fcb[FCB_EX] = 0;
+		fcb[FCB_RC] = 0;
+		fcb[FCB_CR] = 0;
+		break;
+	case 23:	//Rename File
+		FcbToHostPath(fcb + FCB_NAME, path, sizeof(path));
+		FcbToHostPath(fcb + FCB_NEW_NAME, new_path, sizeof(new_path));
+		result = (rename(path, new_path) == 0) ? 0 : 0xff;
+		break;
+	case 24:	//Return Login Vector (drive A only)
+		result = 0x01;
+		break;
+	case 25:	//Return Current Disk
+		result = cpm_current_disk;
+		break;
+	case 26:	//Set DMA Address
+		cpm_dma = d_pair[0];
+		break;
+	case 32:	//Get/Set User Code
+		result = 0;
+		break;
+	case 33:	//Read Random (1 - reading unwritten data, 4 - reading unwritten extent)
+		record = FcbRandomRecord(fcb);
+		if((result = ReadRecord(fcb, record)) == 0xff)
+		{
+			result = 4;	//no file to read the record from
+		}
+		FcbSetSequentialRecord(fcb, record);
+		break;
+	case 34:	//Write Random
+	case 40:	//Write Random with Zero Fill
+		record = FcbRandomRecord(fcb);
+		result = WriteRecord(fcb, record);
+		FcbSetSequentialRecord(fcb, record);
+		break;
+	case 35:	//Compute File Size
+		if((size = HostFileSize(fcb)) < 0)
+		{
+			result = 0xff;
+			break;
+		}
+		record = (size + CPM_RECORD_SIZE - 1) / CPM_RECORD_SIZE;
+		fcb[FCB_R0 + 0] = record & 0xff;
+		fcb[FCB_R0 + 1] = (record >> 8) & 0xff;
+		fcb[FCB_R0 + 2] = (record >> 16) & 0xff;
+		break;
+	case 36:	//Set Random Record
+		record = FcbSequentialRecord(fcb);
+		fcb[FCB_R0 + 0] = record & 0xff;
+		fcb[FCB_R0 + 1] = (record >> 8) & 0xff;
+		fcb[FCB_R0 + 2] = 0;
+		break;
+	default:
+		fprintf(stderr, "Unsupported BDOS function %d at %04x\n", function, pc);
+		result = 0xff;
+		break;
+	};
+
+	//what the call may have stored in the FCB at DE (the console and DMA buffers are marked as they are filled)
+	if(function >= 15)
+	{
+		MarkStoreRange(d_pair[0], CPM_FCB_SIZE);
+	}
+
+	BdosReturn(result, in);
+}
+
+//Builds a default FCB from a command line argument (e.g. "B:FILE.TXT")
+void ArgumentToFcb(char *argument, uint8_t *fcb)
+{
+	memset(fcb, 0, 16);
+	memset(fcb + FCB_NAME, ' ', 11);
+
+	if(argument == NULL)
+	{
+		return;
+	}
+
+	if(argument[0] != 0 && argument[1] == ':')
+	{
+		fcb[FCB_DRIVE] = toupper(argument[0]) - 'A' + 1;
+		argument += 2;
+	}
+
+	HostNameToFcb(argument, fcb + FCB_NAME, 1);
+}
+
+/*
+ * Prepares page zero and loads the program:
+ * 0x0000 - HLT, so warm boot (JMP 0 or RET from the program) stops the emulator
+ * 0x0005 - JMP CPM_BDOS_ENTRY, which holds the trap opcode
+ * 0x005c - default FCBs built from the first two arguments
+ * 0x0080 - command tail
+ */
+int LoadComProgram(char *filename, int argc, char *argv[])
+{
+	FILE *program;
+	size_t program_size;
+	int i, length = 0;
+
+	if((program = fopen(filename, "rb")) == NULL)
+	{
+		printf("Couldn't open CP/M program %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	memset(address_space, 0, ADDRESSED_SPACE_SIZE);
+
+	program_size = fread(memory + CPM_TPA_ADDRESS, 1, CPM_BDOS_ENTRY - CPM_TPA_ADDRESS, program);
+	fclose(program);
+
+	if(program_size == 0)
+	{
+		printf("CP/M program %s is empty.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	memory[0x0000] = 0x76;					//HLT
+	memory[CPM_BDOS_ADDRESS + 0] = 0xc3;			//JMP CPM_BDOS_ENTRY
+	memory[CPM_BDOS_ADDRESS + 1] = CPM_BDOS_ENTRY & 0xff;
+	memory[CPM_BDOS_ADDRESS + 2] = CPM_BDOS_ENTRY >> 8;
+	memory[CPM_BDOS_ENTRY] = BDOS_TRAP_OPCODE;
+
+	ArgumentToFcb(argc > 0 ? argv[0] : NULL, memory + CPM_FCB_1);
+	ArgumentToFcb(argc > 1 ? argv[1] : NULL, memory + CPM_FCB_2);
+
+	for(i = 0; i < argc && length < 0x7e; i++)
+	{
+		memory[CPM_DEFAULT_DMA + 1 + length++] = ' ';
+
+		strncpy((char *)memory + CPM_DEFAULT_DMA + 1 + length, argv[i], 0x7e - length);
+		length += strlen(argv[i]);
+		length = (length > 0x7e) ? 0x7e : length;
+	}
+
+	for(i = 0; i < length; i++)
+	{
+		memory[CPM_DEFAULT_DMA + 1 + i] = toupper(memory[CPM_DEFAULT_DMA + 1 + i]);
+	}
+
+	memory[CPM_DEFAULT_DMA] = length;
+
+	instruction_set[BDOS_TRAP_OPCODE] = BdosTrap;
+	cpm_mode = 1;
+	cpm_dma = CPM_DEFAULT_DMA;
+
+	//the stack starts just below the BDOS with a return address of 0x0000 (warm boot)
+	sp = CPM_BDOS_ENTRY - 2;
+	WriteWord(sp, 0x0000);
+	pc = CPM_TPA_ADDRESS;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,506 @@
+/************************************************************************
+ * 8080 Emulator Debugger						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Execution breakpoints and memory watchpoints kept in per-page	*
+ * counts and per-address bitmaps					*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define PAGES			256
+#define PAGE(address)		((address) >> 8)
+#define MAX_BREAKPOINTS		64
+
+#define WATCH_READ		0x01
+#define WATCH_WRITE		0x02
+
+/*
+ * A page whose count is 0 has nothing set in it, so the per-address bitmaps
+ * are only looked at for pages holding at least one breakpoint/watchpoint.
+ */
+uint8_t breakpoint_pages[PAGES];
+uint8_t breakpoint_map[0x10000 / BYTE];
+uint8_t watch_pages[PAGES];
+uint8_t watch_read_map[0x10000 / BYTE];
+uint8_t watch_write_map[0x10000 / BYTE];
+
+//Conditional breakpoints stop only if the register holds the value
+typedef struct breakpoint_condition
+{
+	uint16_t address;
+	uint8_t *register_8;		//8-bit register compared (or NULL)
+	uint16_t *register_16;		//register pair compared (or NULL)
+	uint16_t value;
+} condition;
+
+condition breakpoint_conditions[MAX_BREAKPOINTS];
+int breakpoint_condition_count = 0;
+
+uint8_t debugging = 0;			//set once any breakpoint or watchpoint exists
+int watch_read_count = 0;		//addresses watched for reads, which only the interpreter checks
+uint8_t single_step = 0;
+uint8_t debug_interpret = 0;		//single stepping or watching reads: the block engines leave every instruction to the interpreter
+uint8_t watch_hit = 0;			//a store hit a write watchpoint; the block engines stop after the instruction
+uint16_t watch_hit_address;
+
+static inline uint8_t BitIsSet(uint8_t *map, uint16_t address)
+{
+	return map[address >> 3] & (1 << (address & 0x07));
+}
+
+static inline void SetBit(uint8_t *map, uint16_t address)
+{
+	map[address >> 3] |= 1 << (address & 0x07);
+}
+
+static inline void ClearBit(uint8_t *map, uint16_t address)
+{
+	map[address >> 3] &= ~(1 << (address & 0x07));
+}
+
+//1 if a breakpoint lies in [start, end); the block engines flag such blocks when they decode them
+uint8_t BreakpointInRange(uint16_t start, uint32_t end)
+{
+	uint32_t address;
+
+	for(address = start; address < end; address++)
+	{
+		if(breakpoint_pages[PAGE(address)] && BitIsSet(breakpoint_map, address))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+//Blocks holding address are decoded again, and flagged if they now hold a breakpoint
+static inline void RefreshBlocks(uint16_t address)
+{
+	if(code_store_hook != NULL)
+	{
+		code_store_hook(address, 1);
+	}
+}
+
+void SetBreakpoint(uint16_t address)
+{
+	if(!BitIsSet(breakpoint_map, address))
+	{
+		SetBit(breakpoint_map, address);
+		breakpoint_pages[PAGE(address)]++;
+		RefreshBlocks(address);
+	}
+
+	debugging = 1;
+}
+
+void ClearBreakpoint(uint16_t address)
+{
+	int i;
+
+	if(BitIsSet(breakpoint_map, address))
+	{
+		ClearBit(breakpoint_map, address);
+		breakpoint_pages[PAGE(address)]--;
+		RefreshBlocks(address);
+	}
+
+	for(i = 0; i < breakpoint_condition_count; i++)
+	{
+		if(breakpoint_conditions[i].address == address)
+		{
+			breakpoint_conditions[i--] = breakpoint_conditions[--breakpoint_condition_count];
+		}
+	}
+}
+
+//Called for stores to pages holding write watchpoints (TrackedStore)
+void WatchpointStore(uint16_t address, uint32_t count)
+{
+	uint32_t byte;
+
+	for(byte = address; byte < address + count; byte++)
+	{
+		if(BitIsSet(watch_write_map, byte))
+		{
+			watch_hit = 1;
+			watch_hit_address = byte;
+			return;
+		}
+	}
+}
+
+/*
+ * Writes are caught as they are stored (WatchpointStore), on any engine; reads
+ * are only seen by DebugCheck, so the interpreter runs every instruction
+ * while any address is watched for them.
+ */
+void SetWatchpoint(uint16_t address, uint8_t access)
+{
+	if(!BitIsSet(watch_read_map, address) && !BitIsSet(watch_write_map, address))
+	{
+		watch_pages[PAGE(address)]++;
+	}
+
+	if((access & WATCH_READ) && !BitIsSet(watch_read_map, address))
+	{
+		SetBit(watch_read_map, address);
+		watch_read_count++;
+	}
+
+	if(access & WATCH_WRITE)
+	{
+		SetBit(watch_write_map, address);
+		store_pages[PAGE(address)] |= STORE_WATCH;
+		watch_store_hook = WatchpointStore;
+	}
+
+	debug_interpret = single_step || watch_read_count > 0;
+	debugging = 1;
+}
+
+//Returns a pointer to the named register (8-bit in *register_8, pairs in *register_16)
+int FindRegister(char *name, uint8_t **register_8, uint16_t **register_16)
+{
+	const char *names_8[] = {"c", "b", "e", "d", "l", "h", "a", "f"};
+	int i;
+
+	*register_8 = NULL;
+	*register_16 = NULL;
+
+	for(i = 0; i < 8; i++)
+	{
+		if(strcmp(name, names_8[i]) == 0)
+		{
+			*register_8 = register_file + i;
+			return 1;
+		}
+	}
+
+	if(strcmp(name, "bc") == 0)
+	{
+		*register_16 = b_pair;
+	}
+	else if(strcmp(name, "de") == 0)
+	{
+		*register_16 = d_pair;
+	}
+	else if(strcmp(name, "hl") == 0)
+	{
+		*register_16 = h_pair;
+	}
+	else if(strcmp(name, "sp") == 0)
+	{
+		*register_16 = &sp;
+	}
+
+	return *register_16 != NULL;
+}
+
+/*
+ * Parses a breakpoint option: <hex address>[:<register>=<hex value>]
+ * e.g. 0120 or 0120:a=05 or 0120:hl=3ff0
+ */
+int ParseBreakpointOption(char *option)
+{
+	unsigned int address, value;
+	char name[3];
+	condition *new_condition;
+
+	if(sscanf(option, "%x", &address) != 1 || address > 0xffff)
+	{
+		printf("Breakpoints are given as <hex address>[:<register>=<hex value>].\n");
+		return EXIT_FAILURE;
+	}
+
+	if(strchr(option, ':') != NULL)
+	{
+		new_condition = breakpoint_conditions + breakpoint_condition_count;
+
+		if(breakpoint_condition_count == MAX_BREAKPOINTS
+		|| sscanf(strchr(option, ':') + 1, "%2[a-z]=%x", name, &value) != 2
+		|| !FindRegister(name, &(new_condition -> register_8), &(new_condition -> register_16)))
+		{
+			printf("Invalid breakpoint condition %s.\n", option);
+			return EXIT_FAILURE;
+		}
+
+		new_condition -> address = address;
+		new_condition -> value = value;
+		breakpoint_condition_count++;
+	}
+
+	SetBreakpoint(address);
+
+	return EXIT_SUCCESS;
+}
+
+//Parses a watchpoint option: <hex address>[:r|w|rw]
+int ParseWatchpointOption(char *option)
+{
+	unsigned int address;
+	uint8_t access = WATCH_READ | WATCH_WRITE;
+	char *kind = strchr(option, ':');
+
+	if(sscanf(option, "%x", &address) != 1 || address > 0xffff)
+	{
+		printf("Watchpoints are given as <hex address>[:r|w|rw].\n");
+		return EXIT_FAILURE;
+	}
+
+	if(kind != NULL)
+	{
+		access = (strchr(kind, 'r') ? WATCH_READ : 0) | (strchr(kind, 'w') ? WATCH_WRITE : 0);
+	}
+
+	SetWatchpoint(address, access);
+
+	return EXIT_SUCCESS;
+}
+
+//Checks the conditions attached to a breakpoint address (a breakpoint without conditions always stops)
+uint8_t BreakpointConditionMet(uint16_t address)
+{
+	int i;
+	uint8_t has_condition = 0;
+	condition *check;
+
+	for(i = 0; i < breakpoint_condition_count; i++)
+	{
+		check = breakpoint_conditions + i;
+
+		if(check -> address != address)
+		{
+			continue;
+		}
+
+		has_condition = 1;
+
+		if((check -> register_8 && check -> register_8[0] == check -> value)
+		|| (check -> register_16 && check -> register_16[0] == check -> value))
+		{
+			return 1;
+		}
+	}
+
+	return !has_condition;
+}
+
+/*
+ * Memory operand of the instruction at pc (read before it executes).
+ * Returns WATCH_READ/WATCH_WRITE bits and sets the address and size of the access.
+ * Conditional calls and returns are reported whether or not they are taken.
+ */
+uint8_t MemoryOperand(uint8_t opcode, uint16_t *address, uint8_t *size)
+{
+	uint16_t immediate = (memory[(uint16_t)(pc + 2)] << 8) + memory[(uint16_t)(pc + 1)];
+
+	*size = 1;
+	*address = h_pair[0];
+
+	switch(opcode)
+	{
+	case 0x46: case 0x4e: case 0x56: case 0x5e: case 0x66: case 0x6e: case 0x7e:
+	case 0x86: case 0x8e: case 0x96: case 0x9e: case 0xa6: case 0xae: case 0xb6: case 0xbe:
+		return WATCH_READ;
+	case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x77: case 0x36:
+		return WATCH_WRITE;
+	case 0x34: case 0x35:
+		return WATCH_READ | WATCH_WRITE;
+	case 0x0a: case 0x1a:
+		*address = (opcode == 0x0a) ? b_pair[0] : d_pair[0];
+		return WATCH_READ;
+	case 0x02: case 0x12:
+		*address = (opcode == 0x02) ? b_pair[0] : d_pair[0];
+		return WATCH_WRITE;
+	case 0x3a:
+		*address = immediate;
+		return WATCH_READ;
+	case 0x32:
+		*address = immediate;
+		return WATCH_WRITE;
+	case 0x2a:
+		*address = immediate;
+		*size = 2;
+		return WATCH_READ;
+	case 0x22:
+		*address = immediate;
+		*size = 2;
+		return WATCH_WRITE;
+	case 0xe3:
+		*address = sp;
+		*size = 2;
+		return WATCH_READ | WATCH_WRITE;
+	default:
+		break;
+	};
+
+	*size = 2;
+
+	//PUSH, CALL, Ccc and RST write below sp; POP, RET and Rcc read at sp
+	if((opcode & 0xcf) == 0xc1 || (opcode & 0xc7) == 0xc0 || opcode == 0xc9)
+	{
+		*address = sp;
+		return WATCH_READ;
+	}
+
+	if((opcode & 0xcf) == 0xc5 || (opcode & 0xc7) == 0xc4 || opcode == 0xcd || (opcode & 0xc7) == 0xc7)
+	{
+		*address = sp - 2;
+		return WATCH_WRITE;
+	}
+
+	return 0;
+}
+
+uint8_t WatchpointHit(uint8_t access, uint16_t address, uint8_t size)
+{
+	uint8_t i;
+	uint16_t byte;
+
+	for(i = 0; i < size; i++)
+	{
+		byte = address + i;
+
+		if(watch_pages[PAGE(byte)]
+		&& (((access & WATCH_READ) && BitIsSet(watch_read_map, byte))
+		|| ((access & WATCH_WRITE) && BitIsSet(watch_write_map, byte))))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void PrintDebugState()
+{
+	fprintf(stderr, "PC: %04x SP: %04x A: %02x B: %02x C: %02x D: %02x E: %02x H: %02x L: %02x Flags: %02x Time: %u\n",
+		pc, sp, a[0], b[0], c[0], d[0], e[0], h[0], l[0], status[0], time);
+	fprintf(stderr, "%04x: %s\n", pc, instruction_set_data[memory[pc]].name);
+}
+
+/*
+ * Debugger prompt
+ * c - continue, s - step, q - quit
+ * b <addr> / d <addr> - set/delete breakpoint, w <addr> - watch read/write
+ * m <addr> [count] - dump memory
+ */
+void DebuggerPrompt()
+{
+	char line[64], command;
+	unsigned int address, count;
+
+	single_step = 0;
+	debug_interpret = watch_read_count > 0;
+	PrintDebugState();
+
+	while(1)
+	{
+		fprintf(stderr, "(debug) ");
+
+		if(fgets(line, sizeof(line), stdin) == NULL)
+		{
+			return;
+		}
+
+		command = line[0];
+		count = 16;
+
+		switch(command)
+		{
+		case 'c':
+			return;
+		case 's':
+			single_step = 1;
+			debug_interpret = 1;
+			return;
+		case 'q':
+			halt_enable |= 0x01;
+			return;
+		case 'b':
+			if(sscanf(line + 1, "%x", &address) == 1)
+			{
+				SetBreakpoint(address);
+			}
+			break;
+		case 'd':
+			if(sscanf(line + 1, "%x", &address) == 1)
+			{
+				ClearBreakpoint(address);
+			}
+			break;
+		case 'w':
+			if(sscanf(line + 1, "%x", &address) == 1)
+			{
+				SetWatchpoint(address, WATCH_READ | WATCH_WRITE);
+			}
+			break;
+		case 'm':
+			if(sscanf(line + 1, "%x %u", &address, &count) >= 1)
+			{
+				for(; count > 0; count--, address++)
+				{
+					fprintf(stderr, "%04x: %02x\n", address & 0xffff, memory[address & 0xffff]);
+				}
+			}
+			break;
+		case 'r':
+			PrintDebugState();
+			break;
+		default:
+			fprintf(stderr, "c - continue, s - step, q - quit, b/d <addr> - set/delete breakpoint, w <addr> - watch, m <addr> [count] - memory, r - registers\n");
+			break;
+		};
+	}
+}
+
+/*
+ * Called before each instruction the interpreter runs while debugging, and
+ * before each run of the block engines, which leave blocks holding
+ * breakpoints to the interpreter and stop after a store hits a write
+ * watchpoint. Pages without breakpoints cost one table lookup; conditions
+ * are only evaluated when the address itself is marked.
+ */
+void DebugCheck()
+{
+	uint8_t access, size;
+	uint16_t address;
+
+	if(watch_hit)
+	{
+		watch_hit = 0;
+		fprintf(stderr, "Watchpoint: write to %04x\n", watch_hit_address);
+		DebuggerPrompt();
+		return;
+	}
+
+	if(single_step)
+	{
+		DebuggerPrompt();
+		return;
+	}
+
+	if(breakpoint_pages[PAGE(pc)] && BitIsSet(breakpoint_map, pc) && BreakpointConditionMet(pc))
+	{
+		fprintf(stderr, "Breakpoint at %04x\n", pc);
+		DebuggerPrompt();
+		return;
+	}
+
+	if(watch_read_count && ((access = MemoryOperand(memory[pc], &address, &size)) & WATCH_READ) && WatchpointHit(WATCH_READ, address, size))
+	{
+		fprintf(stderr, "Watchpoint: read of %04x\n", address);
+		DebuggerPrompt();
+	}
+}
@@ -0,0 +1,272 @@
+/************************************************************************
+ * 8080 Emulator Decode Cache						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Basic blocks decoded once into handler/data pairs, built lazily or	*
+ * ahead of time from a block map written by the analyzer, and run	*
+ * one after another until a halt, interrupt or debugger stop		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define MAX_BLOCK_INSTRUCTIONS	32
+#define BLOCK_MAP_LINE_SIZE	80
+
+typedef struct decoded_instruction
+{
+	instruction execute;
+	data *operands;
+	uint8_t opcode;
+	uint8_t size;
+} decoded;
+
+typedef struct decoded_block
+{
+	uint16_t start;
+	uint8_t count;				//0 once a store rewrote the block's code
+	uint8_t breakpoint;			//holds a breakpoint, so the interpreter runs it
+	uint32_t end;				//exclusive, so a block can end at 0x10000
+	decoded instructions[MAX_BLOCK_INSTRUCTIONS];
+} block;
+
+//Blocks by start address; a block is only reached through its first instruction
+block *block_cache[0x10000];
+
+//Bytes covered by decoded blocks, one bit each; stores to them drop the blocks (InvalidateCode)
+uint8_t code_map[0x10000 / BYTE];
+
+uint8_t decode_cache_enabled = 0;
+char *block_map_file = NULL;
+
+uint32_t blocks_preloaded = 0;
+
+/*
+ * Called for stores to pages holding decoded code (TrackedStore). Every block
+ * covering a stored byte is emptied, so it is decoded again when next reached
+ * and, if it is running, stops after the storing instruction.
+ */
+void InvalidateCode(uint16_t address, uint32_t count)
+{
+	uint32_t byte, start, first;
+
+	for(byte = address; byte < address + count; byte++)
+	{
+		if(!(code_map[byte / BYTE] & (1 << (byte % BYTE))))
+		{
+			continue;
+		}
+
+		code_map[byte / BYTE] &= ~(1 << (byte % BYTE));
+		first = (byte >= MAX_BLOCK_INSTRUCTIONS * 3) ? byte - MAX_BLOCK_INSTRUCTIONS * 3 + 1 : 0;
+
+		for(start = first; start <= byte; start++)
+		{
+			if(block_cache[start] != NULL && block_cache[start] -> end > byte)
+			{
+				block_cache[start] -> count = 0;
+			}
+		}
+	}
+}
+
+/*
+ * Decodes the block at start, stopping at a control transfer, at end or
+ * before memory-mapped io. Returns NULL if not even one instruction fits.
+ */
+block *DecodeBlock(uint16_t start, uint32_t end)
+{
+	block *decoding = block_cache[start];
+	uint32_t address = start;
+	uint8_t opcode;
+
+	if(end > ADDRESSED_SPACE_SIZE)
+	{
+		end = ADDRESSED_SPACE_SIZE;
+	}
+
+	if(decoding == NULL && (decoding = malloc(sizeof(block))) == NULL)
+	{
+		return NULL;
+	}
+
+	decoding -> start = start;
+	decoding -> count = 0;
+
+	while(decoding -> count < MAX_BLOCK_INSTRUCTIONS && address < end)
+	{
+		opcode = memory[address];
+
+		if(address + instruction_set_data[opcode].size > end
+		|| (address + instruction_set_data[opcode].size > MMIO_START_ADDRESS && address < MMIO_END_ADDRESS))
+		{
+			break;
+		}
+
+		decoding -> instructions[decoding -> count].execute = instruction_set[opcode];
+		decoding -> instructions[decoding -> count].operands = &instruction_set_data[opcode];
+		decoding -> instructions[decoding -> count].opcode = opcode;
+		decoding -> instructions[decoding -> count].size = instruction_set_data[opcode].size;
+		decoding -> count++;
+
+		address += instruction_set_data[opcode].size;
+
+		//the CP/M BDOS trap returns to the caller of the BDOS
+		if(EndsBlock(opcode) || opcode == BDOS_TRAP_OPCODE)
+		{
+			break;
+		}
+	}
+
+	decoding -> end = address;
+	decoding -> breakpoint = debugging && BreakpointInRange(start, address);
+
+	if(decoding -> count == 0)
+	{
+		free(decoding);
+		decoding = NULL;
+	}
+
+	block_cache[start] = decoding;
+
+	//stores to the block's bytes now go through InvalidateCode
+	for(address = start; decoding != NULL && address < decoding -> end; address++)
+	{
+		code_map[address / BYTE] |= 1 << (address % BYTE);
+		store_pages[address >> 8] |= STORE_CODE;
+	}
+
+	//the recompiled code's hook passes stores on to InvalidateCode when both run
+	if(code_store_hook == NULL)
+	{
+		code_store_hook = InvalidateCode;
+	}
+
+	return decoding;
+}
+
+/*
+ * Runs the block at pc and the blocks it leads to, until a halt, a pending
+ * interrupt, code the cache can't hold (memory-mapped io) or, while debugging,
+ * a block holding a breakpoint or a store hitting a write watchpoint. Returns
+ * 0 if no block ran, leaving the instruction to the interpreter.
+ *
+ * Handlers and operand data are looked up once, when the block is decoded;
+ * operands themselves are read from memory as each instruction runs, as in the
+ * interpreter. Only a block's last instruction can transfer control, so pc is
+ * not checked in between. Stores to decoded code empty the blocks holding it
+ * (InvalidateCode), which ends the loop over a running block's instructions.
+ */
+int RunCachedBlock()
+{
+	block *current;
+	decoded *next;
+	uint16_t instruction_address;
+	int i, ran = 0;
+
+	while(!halt_enable && !(interrupt_request && interrupt_enable))
+	{
+		current = block_cache[pc];
+
+		if(current != NULL && current -> count > 0)
+		{
+			decode_cache_hits++;
+		}
+		else
+		{
+			decode_cache_misses++;
+
+			if((current = DecodeBlock(pc, ADDRESSED_SPACE_SIZE)) == NULL)
+			{
+				break;
+			}
+		}
+
+		//breakpoints and single steps are the interpreter's, checked once per block
+		if(current -> breakpoint || debug_interpret)
+		{
+			break;
+		}
+
+		for(i = 0; i < current -> count; i++)
+		{
+			next = current -> instructions + i;
+			instruction_address = pc;
+			instruction_register = next -> opcode;
+			pc++;
+
+			next -> execute(next -> operands);
+
+			InstructionComplete(instruction_address);
+
+			if(halt_enable || (interrupt_request && interrupt_enable) || watch_hit)
+			{
+				return 1;
+			}
+		}
+
+		ran = 1;
+	}
+
+	return ran;
+}
+
+/*
+ * Decodes every block listed in a block map before the program starts.
+ * Only "block <start> <end>" lines are used; the analyzer's other lines
+ * (call targets, jump tables) and comments are skipped.
+ */
+int LoadBlockMap(char *filename)
+{
+	FILE *file;
+	char line[BLOCK_MAP_LINE_SIZE];
+	unsigned int start, end;
+
+	if((file = fopen(filename, "r")) == NULL)
+	{
+		printf("Couldn't open block map %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		if(sscanf(line, "block %x %x", &start, &end) == 2 && start < end && start < 0x10000)
+		{
+			if(DecodeBlock(start, end) != NULL)
+			{
+				blocks_preloaded++;
+			}
+		}
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+void FreeDecodeCache()
+{
+	int i;
+
+	code_store_hook = NULL;
+
+	for(i = 0; i < 0x10000; i++)
+	{
+		free(block_cache[i]);
+		block_cache[i] = NULL;
+	}
+
+	for(i = 0; i < 256; i++)
+	{
+		store_pages[i] &= ~STORE_CODE;
+	}
+
+	memset(code_map, 0, sizeof(code_map));
+}
@@ -1,8 +1,9 @@
 /************************************************************************
- * 8080 Emulator Display Peripheral v0.0.0				*
+ * 8080 Emulator Display Peripheral v0.1.0				*
  * Pramuka Perera							*
  * June 23, 2017							*
- * VT100 Monitor						 	*
+ * X11 window showing the gray frames rendered from video memory	*
+ * (video.h); built in with -DVIDEO_X11 and linked with -lX11		*
  ************************************************************************/
 
 #ifndef INCLUDE
@@ -17,54 +18,67 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
-//#include <X11/Xos.h> 
+//#include <X11/Xos.h>
 
 #define ORIGIN_X 0
 #define ORIGIN_Y 0
 
-#define WIDTH 400
-#define HEIGHT 400
+#define DISPLAY_SCALE 2		//window pixels per frame pixel, each way
 
 //gcc -I /usr/X11/include -L /usr/X11/lib -o x1 x1.cc -lX11
 Display *v100;
 Window  win;
 XEvent evt;
 GC gc;
+XImage *display_image = NULL;
+uint32_t display_width,
+	 display_height;
 
-void StartMonitor()
+int OpenDisplayWindow(uint32_t width, uint32_t height)
 {
 	int screen;
 	unsigned long 	white,
 			black;
-	long eventMask;
-	
+	Visual *visual;
+	char *pixels;
 
 	//define window variables
 	v100 = XOpenDisplay(NULL);
 	if(v100 == NULL)
 	{
 		printf("Display failed to start\n");
-		exit(EXIT_FAILURE);
+		return EXIT_FAILURE;
 	}
 
 	screen = DefaultScreen(v100);
 	white = WhitePixel(v100, screen);
 	black = BlackPixel(v100, screen);
+	visual = DefaultVisual(v100, screen);
+
+	//gray levels are written straight into the image as 8-bit channels
+	if(visual -> class != TrueColor || DefaultDepth(v100, screen) < 24)
+	{
+		printf("Display needs a 24-bit TrueColor screen\n");
+		XCloseDisplay(v100);
+		return EXIT_FAILURE;
+	}
+
+	display_width = width * DISPLAY_SCALE;
+	display_height = height * DISPLAY_SCALE;
 
 	//create window in memory
-	win = XCreateSimpleWindow(	v100, 
+	win = XCreateSimpleWindow(	v100,
 					DefaultRootWindow(v100),
 					ORIGIN_X, ORIGIN_Y,		//location of top-left corner of window
-					WIDTH, HEIGHT,			//size of window
+					display_width, display_height,	//size of window
 					0, white,			//border
 					black);				//background
 
-	//show window on physical monitor
-	XMapWindow(v100, win);	
+	//tell x-server to notify client when mapping procedure has completed successfully, and when the window needs redrawing
+	XSelectInput(v100, win, StructureNotifyMask | ExposureMask);
 
-	//tell x-server to notify client when mapping procedure has completed successfully	
-	eventMask = StructureNotifyMask;
-	XSelectInput(v100, win, eventMask);
+	//show window on physical monitor
+	XMapWindow(v100, win);
 
 	//wait until mapping procedure is complete
 	do
@@ -73,32 +87,79 @@ void StartMonitor()
 	}
 	while(evt.type != MapNotify);
 
-	//draw in window
 	gc = XCreateGC( 	v100, win,
 				0,
 				NULL);
-	XSetForeground( v100, gc, white);	
 
-		
-	eventMask = ButtonPressMask|ButtonReleaseMask;
-	XSelectInput(v100,win,eventMask); // override prev
- 
-  	do
+	//the client-side copy of the window's contents (XDestroyImage frees pixels)
+	if((pixels = calloc(display_width * display_height, sizeof(uint32_t))) == NULL
+	|| (display_image = XCreateImage(v100, visual, DefaultDepth(v100, screen), ZPixmap, 0, pixels,
+				display_width, display_height, 32, 0)) == NULL)
+	{
+		printf("Display failed to start\n");
+		free(pixels);
+		XCloseDisplay(v100);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//Copies rows first to last of a frame of gray levels (one byte per pixel) to the window
+void DrawDisplayRows(uint8_t *frame, uint32_t first, uint32_t last)
+{
+	uint32_t *pixels = (uint32_t *)display_image -> data,
+		 frame_width = display_width / DISPLAY_SCALE,
+		 row, column, i, pixel,
+		 *line;
+
+	for(row = first; row <= last; row++)
 	{
-    		XNextEvent(v100, &evt);   // calls XFlush()
-  	}
-	while( evt.type != ButtonRelease );
-	
+		line = pixels + row * DISPLAY_SCALE * display_width;
+
+		for(column = 0; column < frame_width; column++)
+		{
+			pixel = frame[row * frame_width + column] * 0x010101u;
+
+			for(i = 0; i < DISPLAY_SCALE; i++)
+			{
+				line[column * DISPLAY_SCALE + i] = pixel;
+			}
+		}
+
+		for(i = 1; i < DISPLAY_SCALE; i++)
+		{
+			memcpy(line + i * display_width, line, display_width * sizeof(uint32_t));
+		}
+	}
+
+	XPutImage(v100, win, gc, display_image, 0, first * DISPLAY_SCALE, 0, first * DISPLAY_SCALE,
+		display_width, (last - first + 1) * DISPLAY_SCALE);
+	XFlush(v100);
 }
 
-void DrawLines()
-{	
-	XDrawLine(v100, win, gc, 10, 10,190,190); //from-to
-	XDrawLine(v100, win, gc, 10,190,190, 10); //from-to
+//Handles waiting window events without blocking; returns 1 if the window has to be redrawn
+int PollDisplayWindow()
+{
+	int exposed = 0;
+
+	while(XPending(v100))
+	{
+		XNextEvent(v100, &evt);
+
+		if(evt.type == Expose)
+		{
+			exposed = 1;
+		}
+	}
+
+	return exposed;
 }
 
-void CloseMonitor()
+void CloseDisplayWindow()
 {
+	XDestroyImage(display_image);
+	display_image = NULL;
 	XFreeGC( v100, gc);
  	XDestroyWindow(v100, win);
   	XCloseDisplay(v100);
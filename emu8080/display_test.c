@@ -1,10 +1,36 @@
 #include "display.h"
 
+//gcc display_test.c -o display_test -lX11; shows four bands of gray until the window is clicked
 int main()
 {
-	StartMonitor();
-//	DrawLines();
-	CloseMonitor();	
+	uint8_t frame[256 * 256];
+	int i;
+
+	for(i = 0; i < 256 * 256; i++)
+	{
+		frame[i] = (i % 256) / 64 * 0x55;
+	}
+
+	if(OpenDisplayWindow(256, 256) != EXIT_SUCCESS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	DrawDisplayRows(frame, 0, 255);
+
+	XSelectInput(v100, win, ExposureMask | ButtonReleaseMask);
+
+  	do
+	{
+    		XNextEvent(v100, &evt);   // calls XFlush()
+
+		if(evt.type == Expose)
+		{
+			DrawDisplayRows(frame, 0, 255);
+		}
+  	}
+	while( evt.type != ButtonRelease );
+
+	CloseDisplayWindow();
 	return 0;
 }
-
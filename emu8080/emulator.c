@@ -21,154 +21,39 @@
 	#define INCLUDE
 #endif
 
+#include "machine.h"
 #include "instruction_set.h"
 #include "storage.h"
 #include "vt100.h"
-
-//HARDWARE---
-uint8_t	*address_space,
-	*hard_disk,
-	*memory,
-	*video_memory,
-	*io;
-
-uint8_t register_file[10];
-
-/*
- * General Purpose Registers
- * x86 stores data using little endian format.
- *
- * These registers are accessed as register pairs (where B, D, and H hold the higher order byte) 
- * using  a uint16_t pointer in various instructions.
- *
- * As a result of these two facts, the registers are described in an order where the low order 
- * register is assigned a lower address than it's higher order counterpart.
- */
-uint8_t *const c = register_file + C;
-uint8_t *const b = register_file + B;
-uint8_t *const e = register_file + E;
-uint8_t *const d = register_file + D;
-uint8_t *const l = register_file + L;
-uint8_t *const h = register_file + H;
-
-//Accumulator
-uint8_t *const a = register_file + A;
-
-/*
- * Status Byte
- * FLAGS - Carry | Aux Carry | Sign | Zero | Even Parity
- * BIT   - 0     | 1         | 2    | 3    | 4 
- */
-uint8_t *const status = register_file + STATUS;
-
-//Registers Z and W can only be used for instruction execution
-//These registers are not directly accessible to the programmer
-//static uint8_t *const z = register_file + Z;
-//static uint8_t *const w = register_file + W;
-
-//Register Pairs
-//B+C
-uint16_t *const b_pair = (uint16_t*)(register_file + B_PAIR);
-//D+E
-uint16_t *const d_pair = (uint16_t*)(register_file + D_PAIR);
-//H+L
-uint16_t *const h_pair = (uint16_t*)(register_file + H_PAIR);
-//A+status
-uint16_t *const psw = (uint16_t*)(register_file + PSW);
-
-/*
- * The pc and sp contain the emulated address and not the host address.
- * The emulated address is in fact an index for the emulated memory,
- * which is a dynamically-allocated array.
- */
-uint16_t pc;
-uint16_t sp;
-
-//Instruction Register
-uint8_t instruction_register;
-
-//Processor Time
-uint32_t time;
-//---
-
-/*
- * I/O---
- * Control I/O Signals of 8080
- * SIGNALS - WR'(0) | DBIN(O) | INTE(O) | INT(I) | HOLD ACK(O) | HOLD(I) | WAIT (0) | READY(I) | SYNC(O) | RESET(I) 
- * BIT     - 0      | 1       | 2       | 3      | 4           | 5       | 6        | 7        | 8       | 9
- */
-uint16_t control;
-uint8_t interrupt_enable;
-uint8_t halt_enable;
-uint8_t interrupt_request;
-uint8_t priority;
-//---
-
-/*
- * USER INTERFACE---
- * Signals presented on the 8800 front panel
- * SIGNALS - INTE | PROT | MEMR | INP | M1 | OUT | HLTA | STACK | WO'  | INT(A) | WAIT | HLDA | RESET
- * BIT     - 0    | 1    | 2    | 3   | 4  | 5   | 6    | 7     | 8    | 9      | 10   | 11   | 12
- */
-uint16_t indicator;
-//---
-//---
-
-/*
- * Memory-mapped Nonvolatile Memory Registers
- * 0x3ffc - Storage Control Register
- * BITS:	3			2			1		0		
- * VALUE:	Write-Request Flag	Read-Request Flag	Ready Flag	Interrupt-Enable
- * 0x3ffd - Data Register
- * 0x3ffe/f - Address Registers 
- */
-
-/* Memory-mapped Keyboard Registers
- * 0x3ff9 - Keyboard Control Register
- * BITS:	1		0
- * VALUE:	Ready Flag	Interrupt-Enable
- * 0x3ffa - Data Register
- */
-
-/* Memory-mapped Display Registers
- *
- */ 
-
-interrupt_device interrupt_vector;
-
-void InterruptCheckAndInstructionFetch()
-{
-	if (interrupt_request && interrupt_enable)
-	{
-		interrupt_request = 0;
-
-		switch (interrupt_vector){
-		case STORAGE_READ:
-			instruction_register = 0xd7;	//RST 02
-			return;
-		case STORAGE_WRITE:
-			instruction_register = 0xdf;	//RST 03
-			return;
-		case KEYBOARD:
-			instruction_register = 0xe7;	//RST 04
-			return;
-		case DISPLAY:
-			instruction_register = 0xef;	//RST 05
-			return;
-		case NO_INTERRUPT: 
-		default:
-			break;
-		};		
-	}
-
-	//printf("Current pc: %2x\n", pc);
-	instruction_register = memory[pc];
-	pc++;
-}
+#include "cpm.h"
+#include "native.h"
+#include "idiom.h"
+#include "debug.h"
+#include "coverage.h"
+#include "profile.h"
+#include "trace.h"
+#include "sampler.h"
+#include "shared.h"
+#include "snapshot.h"
+#include "compress.h"
+#include "checkpoint.h"
+#include "fuzz.h"
+#include "decode.h"
+#include "stats.h"
+#include "lockstep.h"
+#include "recompiled.h"
+#include "program.h"
+#include "batch.h"
+#include "video.h"
+#include "ui.h"
+#include "core.h"
+#include "reference.h"
+#include "splitmix.h"
+#include "exercise.h"
 
 void GetProgram()
 {
-	char buffer[8] = {0}; 		//stores string version of instruction
+	char buffer[9] = {0}; 		//stores string version of instruction (8 chars + terminator)
 
 	char* ptr = NULL; 		//parameter for strtol
 
@@ -283,15 +168,349 @@ void DisplayState()
 	printf("CTRL: %02x DATA: %02x ADDR:%02x%02x\n", memory[NV_MEM_CTRL_REG], memory[NV_MEM_DATA_REG], memory[NV_MEM_ADDR_HIGH], memory[NV_MEM_ADDR_LOW]);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	char *cpm_program = NULL;
+	int i, cpm_argc = 0;
+	lockstep_engine engine;
+
 	time = 0;
 	halt_enable = 0;
 	interrupt_request = 0;
 	priority = 8;
 
-	hard_disk = malloc(HARD_DISK_SIZE * sizeof(uint8_t));
-	address_space = malloc(ADDRESSED_SPACE_SIZE * sizeof(uint8_t));
+	/*
+	 * Options:
+	 * -cpmdir <directory>		- host directory used as the CP/M disk (default: current directory)
+	 * -native <routine>@<address>	- run a CALL to <address> as the native routine (memcpy, memset, strlen)
+	 * -idioms			- run recognized copy/fill loops as host block operations
+	 * -break <address>[:<reg>=<value>]	- stop at <address> (optionally only when the register holds <value>)
+	 * -watch <address>[:r|w|rw]	- stop before an instruction that reads <address>, or after one that writes it
+	 * -blocks			- run from a cache of decoded basic blocks
+	 * -blockmap <file>		- decode the blocks listed by the analyzer before starting (implies -blocks)
+	 * -recompiled			- run the image built in with -DRECOMPILED_SOURCE (see recompiler.c); -cycles and the devices are checked where its blocks are left
+	 * -lockstep <engine>:<engine>	- run two of interpreter, blocks and recompiled side by side and report where they diverge
+	 * -lockstep-every <count>	- compare every <count> instructions (default: after every taken jump, call, return or interrupt)
+	 * -lockstep-window <count>	- instructions printed from each engine before a divergence (32)
+	 * -coverage <file>		- record executed addresses and branch directions (text if <file> ends in .txt)
+	 * -merge-coverage <output> <inputs>	- OR coverage files from many runs together and exit
+	 * -profile <file>		- write executions and cycles per opcode and per address, most cycles first
+	 * -heatmap <file>		- write executions and cycles for all 64K addresses (text if <file> ends in .txt)
+	 * -trace <file>		- write a binary record of every instruction (decode with tracer)
+	 * -trace-last <count>		- decode the last <count> instructions to <file>.last when the run ends (64)
+	 * -sample <file>		- sample pc and write flat and cumulative samples per routine
+	 * -symbols <file>		- routine names for -sample (the .sym file written by the assembler)
+	 * -sample-cycles <count>	- cycles between samples (10000)
+	 * -stats-socket <path>		- answer connections to a Unix-domain socket with a line of run statistics
+	 * -stats-log <file>		- append a line of run statistics to <file> periodically
+	 * -stats-interval <ms>		- time between -stats-log lines (1000)
+	 * -image <file>			- map a raw memory image at 0x0000 (shared copy-on-write) instead of reading a program
+	 * -disk <file>			- map a raw disk image (shared copy-on-write) instead of storage; writes aren't saved
+	 * -checkpoint <directory>	- write a snapshot every -checkpoint-cycles (deltas against the first)
+	 * -checkpoint-cycles <count>	- cycles between checkpoints (default 10 ms)
+	 * -restore <file>		- start from a snapshot file instead of loading a program
+	 * -fuzz <pc>[:keyboard|storage]	- snapshot at <pc>, then fuzz the keyboard (default) or storage input
+	 * -fuzz-runs <count>		- number of fuzzing runs (default 100000)
+	 * -fuzz-cycles <count>		- cycle limit of one run before it counts as a hang (default 1 s)
+	 * -fuzz-out <directory>		- where interesting inputs, crashes and hangs are written
+	 * -fuzz-seed <number>		- random seed for the mutations
+	 * -exercise			- check every opcode against the reference model, time them and exit
+	 * -exercise-cases <count>	- cases per opcode (default 2^18)
+	 * -exercise-jobs <count>	- processes sharing the opcodes (default one per processor)
+	 * -headless			- no terminal or monitor; end with a JSON dump and exit 0 (halted), 2 (cycle limit) or 3 (fault)
+	 * -program <file>		- load an assembled program (.list) instead of reading one from the terminal
+	 * -input <file>		- keyboard input, a byte each time the program reads a key
+	 * -cycles <count>		- stop the run after <count> cycles
+	 * -dump <file>			- where -headless writes its JSON dump (default: standard output)
+	 * -dump-memory <start>:<end>	- add memory from <start> up to <end> (hex) to the dump; may be repeated
+	 * -frames <file>		- capture video memory frames: a .y4m stream, a .ppm file of changed frames, or a directory of them
+	 * -window			- show video memory in an X11 window (built with -DVIDEO_X11 and -lX11)
+	 * -ui				- read keys and draw the status panel and window in a process of their own
+	 * -cpm <program.com> [args]	- run a CP/M program; the remaining arguments are its command tail
+	 */
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-cpmdir") == 0 && i + 1 < argc)
+		{
+			cpm_directory = argv[++i];
+		}
+		else if(strcmp(argv[i], "-native") == 0 && i + 1 < argc)
+		{
+			if(ParseNativeRoutineOption(argv[++i]) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if(strcmp(argv[i], "-break") == 0 && i + 1 < argc)
+		{
+			if(ParseBreakpointOption(argv[++i]) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+
+			//the debugger prompts on the terminal
+			monitor_enabled = 0;
+		}
+		else if(strcmp(argv[i], "-watch") == 0 && i + 1 < argc)
+		{
+			if(ParseWatchpointOption(argv[++i]) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+
+			//the debugger prompts on the terminal
+			monitor_enabled = 0;
+		}
+		else if(strcmp(argv[i], "-idioms") == 0)
+		{
+			EnableLoopIdioms();
+		}
+		else if(strcmp(argv[i], "-blocks") == 0)
+		{
+			decode_cache_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-blockmap") == 0 && i + 1 < argc)
+		{
+			block_map_file = argv[++i];
+			decode_cache_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-recompiled") == 0)
+		{
+			if(!recompiled_code_available)
+			{
+				printf("This emulator was built without recompiled code (-DRECOMPILED_SOURCE).\n");
+				exit(EXIT_FAILURE);
+			}
+
+			recompiled_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-lockstep") == 0 && i + 1 < argc)
+		{
+			if(ParseLockstepOption(argv[++i]) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+
+			if(LockstepUses(LOCKSTEP_RECOMPILED) && !recompiled_code_available)
+			{
+				printf("This emulator was built without recompiled code (-DRECOMPILED_SOURCE).\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if(strcmp(argv[i], "-lockstep-every") == 0 && i + 1 < argc)
+		{
+			lockstep_every = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-lockstep-window") == 0 && i + 1 < argc)
+		{
+			lockstep_window = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-headless") == 0)
+		{
+			headless = 1;
+			monitor_enabled = 0;
+			stats_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-program") == 0 && i + 1 < argc)
+		{
+			program_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-input") == 0 && i + 1 < argc)
+		{
+			if((batch_input = fopen(argv[++i], "rb")) == NULL)
+			{
+				printf("Couldn't open input %s.\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+
+			keyboard_source = BatchKeyboardByte;
+			keyboard_attached = 1;
+		}
+		else if(strcmp(argv[i], "-cycles") == 0 && i + 1 < argc)
+		{
+			batch_cycle_limit = strtoull(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-dump") == 0 && i + 1 < argc)
+		{
+			dump_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-dump-memory") == 0 && i + 1 < argc)
+		{
+			if(ParseDumpRange(argv[++i]) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if(strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+		{
+			frame_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-window") == 0)
+		{
+			video_window = 1;
+		}
+		else if(strcmp(argv[i], "-ui") == 0)
+		{
+			ui_process = 1;
+		}
+		else if(strcmp(argv[i], "-coverage") == 0 && i + 1 < argc)
+		{
+			coverage_file = argv[++i];
+			coverage_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-merge-coverage") == 0 && i + 2 < argc)
+		{
+			return MergeCoverageFiles(argv[i + 1], argc - i - 2, argv + i + 2);
+		}
+		else if(strcmp(argv[i], "-profile") == 0 && i + 1 < argc)
+		{
+			profile_report_file = argv[++i];
+			profile_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-heatmap") == 0 && i + 1 < argc)
+		{
+			profile_heatmap_file = argv[++i];
+			profile_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+		{
+			trace_file = argv[++i];
+			trace_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-trace-last") == 0 && i + 1 < argc)
+		{
+			trace_last = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-sample") == 0 && i + 1 < argc)
+		{
+			sample_file = argv[++i];
+			sample_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-symbols") == 0 && i + 1 < argc)
+		{
+			symbol_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-sample-cycles") == 0 && i + 1 < argc)
+		{
+			sample_cycles = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-stats-socket") == 0 && i + 1 < argc)
+		{
+			stats_socket_file = argv[++i];
+			stats_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-stats-log") == 0 && i + 1 < argc)
+		{
+			stats_log_file = argv[++i];
+			stats_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-stats-interval") == 0 && i + 1 < argc)
+		{
+			stats_interval = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-image") == 0 && i + 1 < argc)
+		{
+			shared_image_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-disk") == 0 && i + 1 < argc)
+		{
+			shared_disk_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-checkpoint") == 0 && i + 1 < argc)
+		{
+			checkpoint_directory = argv[++i];
+		}
+		else if(strcmp(argv[i], "-checkpoint-cycles") == 0 && i + 1 < argc)
+		{
+			checkpoint_cycles = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-restore") == 0 && i + 1 < argc)
+		{
+			restore_file = argv[++i];
+		}
+		else if(strcmp(argv[i], "-fuzz") == 0 && i + 1 < argc)
+		{
+			if(ParseFuzzOption(argv[++i]) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if(strcmp(argv[i], "-fuzz-runs") == 0 && i + 1 < argc)
+		{
+			fuzz_runs = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-fuzz-cycles") == 0 && i + 1 < argc)
+		{
+			fuzz_cycles = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-fuzz-out") == 0 && i + 1 < argc)
+		{
+			fuzz_output = argv[++i];
+		}
+		else if(strcmp(argv[i], "-fuzz-seed") == 0 && i + 1 < argc)
+		{
+			fuzz_seed = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-exercise") == 0)
+		{
+			exercise_enabled = 1;
+		}
+		else if(strcmp(argv[i], "-exercise-cases") == 0 && i + 1 < argc)
+		{
+			exercise_cases = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-exercise-jobs") == 0 && i + 1 < argc)
+		{
+			exercise_jobs = strtoul(argv[++i], NULL, 0);
+		}
+		else if(strcmp(argv[i], "-cpm") == 0 && i + 1 < argc)
+		{
+			cpm_program = argv[++i];
+			cpm_argc = argc - i - 1;
+			break;
+		}
+		else
+		{
+			printf("Usage: %s [-cpmdir <directory>] [-native <routine>@<address>] [-idioms] [-break <address>[:<reg>=<value>]] [-watch <address>[:r|w|rw]] [-blocks] [-blockmap <file>] [-recompiled] [-lockstep <engine>:<engine>] [-lockstep-every <count>] [-lockstep-window <count>] [-coverage <file>] [-merge-coverage <output> <inputs>] [-profile <file>] [-heatmap <file>] [-trace <file>] [-trace-last <count>] [-sample <file>] [-symbols <file>] [-sample-cycles <count>] [-stats-socket <path>] [-stats-log <file>] [-stats-interval <ms>] [-image <file>] [-disk <file>] [-checkpoint <directory>] [-checkpoint-cycles <count>] [-restore <file>] [-fuzz <pc>[:keyboard|storage]] [-fuzz-runs <count>] [-fuzz-cycles <count>] [-fuzz-out <directory>] [-fuzz-seed <number>] [-exercise] [-exercise-cases <count>] [-exercise-jobs <count>] [-headless] [-program <file>] [-input <file>] [-cycles <count>] [-dump <file>] [-dump-memory <start>:<end>] [-frames <file>] [-window] [-ui] [-cpm <program.com> [args]]\n", argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if(exercise_enabled)
+	{
+		return RunExerciser();
+	}
+
+	//the UI process owns the terminal the debugger would prompt on
+	if(debugging && ui_process)
+	{
+		printf("Breakpoints and watchpoints can't be used with -ui.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if(shared_disk_file != NULL)
+	{
+		hard_disk = shared_hard_disk = MapSharedImage(shared_disk_file);
+	}
+	else
+	{
+		hard_disk = malloc(HARD_DISK_SIZE * sizeof(uint8_t));
+	}
+
+	if(shared_image_file != NULL)
+	{
+		address_space = shared_address_space = MapSharedImage(shared_image_file);
+	}
+	else
+	{
+		address_space = malloc(ADDRESSED_SPACE_SIZE * sizeof(uint8_t));
+	}
+
+	if(hard_disk == NULL || address_space == NULL)
+	{
+		exit(EXIT_FAILURE);
+	}
+
 	memory = address_space + MEMORY_START_ADDRESS;
 	video_memory = address_space + VIDEO_MEM_START_ADDRESS;
 	io = malloc(PORTS * sizeof(uint8_t));
@@ -301,42 +520,248 @@ int main()
 	interrupt_vector = NO_INTERRUPT;
 
 	//atexit(DisplayState);
-	
-	LoadNonVolatileMemory(hard_disk);
 
-	GetProgram();
+	if(cpm_program != NULL)
+	{
+		if(LoadComProgram(cpm_program, cpm_argc, argv + argc - cpm_argc) != EXIT_SUCCESS)
+		{
+			exit(EXIT_FAILURE);
+		}
+	}
+	else if(restore_file != NULL)
+	{
+		if(RestoreSnapshotFile() != EXIT_SUCCESS)
+		{
+			exit(EXIT_FAILURE);
+		}
+
+		if(fuzz_enabled)
+		{
+			return RunFuzzer();
+		}
+	}
+	else
+	{
+		if(shared_disk_file == NULL && LoadNonVolatileMemory(hard_disk) != EXIT_SUCCESS)
+		{
+			exit(EXIT_FAILURE);
+		}
 
-	//StartMonitor();
-	
-	memory[NV_MEM_CTRL_REG] = 0x02;
+		if(program_file != NULL)
+		{
+			if(LoadProgramFile(program_file) != EXIT_SUCCESS)
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if(shared_image_file == NULL)
+		{
+			GetProgram();
+		}
 
+		memory[NV_MEM_CTRL_REG] = 0x02;
+
+		if(fuzz_enabled)
+		{
+			return RunFuzzer();
+		}
+	}
 	
-	
+	if((recompiled_enabled || LockstepUses(LOCKSTEP_RECOMPILED)) && !RecompiledCodeMatches())
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if(block_map_file != NULL && LoadBlockMap(block_map_file) != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	//each engine runs the rest of the program in its own process, and the parent exits once they're compared
+	if(lockstep_enabled)
+	{
+		engine = StartLockstep();
+		decode_cache_enabled = (engine == LOCKSTEP_BLOCKS);
+		recompiled_enabled = (engine == LOCKSTEP_RECOMPILED);
+		monitor_enabled = 0;
+	}
+
+	if(recompiled_enabled)
+	{
+		StartRecompiledCode();
+	}
+
+	if(profile_enabled)
+	{
+		StartProfile();
+	}
+
+	if(trace_enabled && StartTrace() != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if(sample_enabled && StartSampling() != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if(stats_enabled && StartStats() != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if(headless || batch_cycle_limit)
+	{
+		StartBatch();
+	}
+
+	//CP/M programs use the console directly, and each lockstep engine would want its own UI
+	if(ui_process && !cpm_mode && !lockstep_enabled)
+	{
+		ui_monitor = monitor_enabled && isatty(STDOUT_FILENO);
+
+		if(StartUi() != EXIT_SUCCESS)
+		{
+			exit(EXIT_FAILURE);
+		}
+
+		monitor_enabled = 0;
+
+		//keys come from the UI unless the keyboard already has a source (-input)
+		if(!keyboard_attached)
+		{
+			keyboard_source = UiKeyboardByte;
+			keyboard_attached = 1;
+		}
+	}
+
+	if((frame_file != NULL || video_window || ui_window) && StartVideo() != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	//the status panel, when there is a terminal to show it on
+	if(monitor_enabled && !cpm_mode && isatty(STDOUT_FILENO))
+	{
+		StartMonitor();
+	}
+
 	while(!halt_enable)
 	{
-		//fetches interrupt vector or next-instruction-in-program to instruction register
-		InterruptCheckAndInstructionFetch();
+		//breakpoints and watchpoints
+		if(debugging)
+		{
+			DebugCheck();
+
+			if(halt_enable)
+			{
+				break;
+			}
+		}
+
+		//recompiled code or whole decoded blocks (while debugging, they leave blocks holding breakpoints to the interpreter)
+		if(recompiled_enabled && RunRecompiledCode())
+		{
+			continue;
+		}
+
+		if(decode_cache_enabled && RunCachedBlock())
+		{
+			continue;
+		}
+
+		ExecuteInstruction();
+	}
+
+	//a signal ended the run rather than the program
+	if(stop_signal && batch_outcome == BATCH_HALTED)
+	{
+		batch_outcome = BATCH_INTERRUPTED;
+	}
+
+	if(lockstep_enabled)
+	{
+		StopLockstep();
+	}
+
+	if(coverage_enabled)
+	{
+		WriteCoverage(coverage_file, &coverage);
+	}
+
+	if(profile_enabled)
+	{
+		WriteProfile();
+	}
+
+	if(trace_enabled)
+	{
+		StopTrace();
+	}
+
+	if(sample_enabled)
+	{
+		WriteSampleReport(sample_file);
+	}
+
+	if(stats_enabled)
+	{
+		StopStats();
+	}
+
+	if(video_enabled)
+	{
+		StopVideo();
+	}
 
-		//decode - execute - store
-		instruction_set[instruction_register]			//calls the instruction-emulating function
-			(&instruction_set_data[instruction_register]);	//passes references to data needed to carry out instruction
+	if(ui_enabled)
+	{
+		StopUi();
+	}
 
-		//printf("Control Register: %x\n", memory[NV_MEM_CTRL_REG]);
-		PrintMachineState();
-		NonVolatileMemoryOperation();		 	
+	if(decode_cache_enabled)
+	{
+		FreeDecodeCache();
 	}
+
+	free(checkpoint_base);
+	free(checkpoint_current);
 	
-	StoreNonVolatileMemory(hard_disk);
+	if(cpm_mode)
+	{
+		fflush(stdout);
+	}
+	else
+	{
+		//writes to a shared disk image stay private to this run
+		if(shared_disk_file == NULL)
+		{
+			StoreNonVolatileMemory(hard_disk);
+		}
 
-	StopMonitor();		
-	DisplayState();
+		//a headless run never touched the terminal
+		if(!headless)
+		{
+			StopMonitor();
+			DisplayState();
+		}
+	}
+
+	if(headless && WriteBatchDump() != EXIT_SUCCESS)
+	{
+		batch_outcome = EXIT_FAILURE;
+	}
 
-	free(memory);			
+	ReleaseMemory(address_space);
+	address_space = NULL;
 	memory = NULL;
 	
-	free(hard_disk);
+	ReleaseMemory(hard_disk);
 	hard_disk = NULL;
 
-	return EXIT_SUCCESS;
-}
+	free(io);
+	io = NULL;
 
+	return batch_outcome;
+}
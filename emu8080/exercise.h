@@ -0,0 +1,506 @@
+/************************************************************************
+ * 8080 Opcode Exerciser						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Runs every opcode over a sweep of operands and flags, folding the	*
+ * resulting machine state into a CRC per opcode that is compared	*
+ * with the reference model's. Timed, so it also serves as a		*
+ * benchmark of the instruction-emulating functions			*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define EXERCISE_PROBES		10
+#define EXERCISE_SLACK		0x10		//bytes either side of the exercised memory, for addresses that don't wrap
+#define EXERCISE_MAX_JOBS	64
+#define EXERCISE_NO_DIFFERENCE	0xffffffff
+#define EXERCISE_MAX_PC		0xfffc		//instructions don't run off the end of memory
+
+/*
+ * Case n of an opcode sweeps
+ * bits 0 to 7	- the operand: the source register, the byte at HL, and the immediate byte
+ * bits 8 to 15	- the accumulator
+ * bits 16, 17	- CY and AC
+ * The other registers and flags, pc, sp, the second immediate byte and the
+ * bytes around HL, BC, DE, sp and the immediate address are pseudo-random.
+ * The default 2^18 cases cover every accumulator, operand, CY and AC.
+ */
+typedef struct exercise_case_data
+{
+	uint8_t registers[8];
+	uint16_t pc;
+	uint16_t sp;
+	uint8_t interrupt_enable;
+	uint8_t port_value;
+	uint8_t instruction[3];
+	uint16_t probe_addresses[EXERCISE_PROBES];
+	uint8_t probe_values[EXERCISE_PROBES];
+} exercise_case;
+
+//State after one case, folded into the opcode's CRC
+typedef struct exercise_state_data
+{
+	uint8_t registers[8];
+	uint16_t pc;
+	uint16_t sp;
+	uint32_t cycles;
+	uint8_t interrupt_enable;
+	uint8_t halt_enable;
+	uint8_t port_value;
+	uint8_t probes[EXERCISE_PROBES];
+} exercise_state;
+
+typedef struct exercise_result_data
+{
+	uint8_t opcode;
+	uint32_t expected;
+	uint32_t actual;
+	uint32_t first_difference;	//case index, or EXERCISE_NO_DIFFERENCE
+	double seconds;			//spent in the instruction-emulating function
+} exercise_result;
+
+//options
+uint8_t exercise_enabled = 0;
+uint32_t exercise_cases = 1 << 18;
+int exercise_jobs = 0;			//0 for one per processor
+
+uint32_t crc_table[256];
+uint32_t exercise_setup_crc;		//kept so the set-up pass isn't optimized away
+uint8_t *exercise_region = NULL;
+
+void InitializeCrcTable()
+{
+	uint32_t crc;
+	int i, bit;
+
+	for(i = 0; i < 256; i++)
+	{
+		crc = i;
+
+		for(bit = 0; bit < BYTE; bit++)
+		{
+			crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+		}
+
+		crc_table[i] = crc;
+	}
+}
+
+//CRC-32 (as used by zip); start with 0xffffffff and invert the final value
+static inline uint32_t Crc32(uint32_t crc, const void *bytes, size_t length)
+{
+	const uint8_t *byte = bytes;
+
+	while(length-- > 0)
+	{
+		crc = crc_table[(crc ^ *byte++) & 0xff] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+//Case index of opcode; depends on nothing else, so any job can generate any case
+void GenerateExerciseCase(uint8_t opcode, uint32_t index, exercise_case *test)
+{
+	uint64_t seed = ((uint64_t)opcode << 32) + index,
+		 random = SplitMix64(&seed),
+		 bytes = SplitMix64(&seed);
+	uint8_t operand = index & 0xff,
+		source = opcode & 0x07,
+		destination = (opcode >> 3) & 0x07;
+	uint16_t hl, bc, de, immediate;
+	int i;
+
+	for(i = 0; i < A; i++)
+	{
+		test -> registers[i] = random >> (i * BYTE);
+	}
+
+	test -> registers[A] = index >> 8;
+	test -> registers[STATUS] = ((index >> 16) & (CY + AC)) + (((index >> 16) ^ (random >> 48)) & (S + Z + EP));
+
+	//the operand goes in the register the instruction reads
+	if((opcode & 0xc0) == 0x40 || (opcode & 0xc0) == 0x80)
+	{
+		if(source != REFERENCE_M && source != 7)
+		{
+			test -> registers[reference_register_index[source]] = operand;
+		}
+	}
+	else if((opcode & 0xc0) == 0x00 && ((opcode & 0x07) == 0x04 || (opcode & 0x07) == 0x05))
+	{
+		if(destination != REFERENCE_M && destination != 7)
+		{
+			test -> registers[reference_register_index[destination]] = operand;
+		}
+	}
+
+	test -> pc = (uint16_t)(random >> 48) % (EXERCISE_MAX_PC + 1);
+	test -> sp = bytes >> 48;
+	test -> interrupt_enable = (random >> 56) & 0x01;
+	test -> port_value = bytes >> 40;
+
+	test -> instruction[0] = opcode;
+	test -> instruction[1] = operand;
+	test -> instruction[2] = bytes >> 32;
+
+	hl = (test -> registers[H] << 8) + test -> registers[L];
+	bc = (test -> registers[B] << 8) + test -> registers[C];
+	de = (test -> registers[D] << 8) + test -> registers[E];
+	immediate = (test -> instruction[2] << 8) + test -> instruction[1];
+
+	test -> probe_addresses[0] = hl + 1;
+	test -> probe_addresses[1] = bc;
+	test -> probe_addresses[2] = de;
+	test -> probe_addresses[3] = test -> sp - 2;
+	test -> probe_addresses[4] = test -> sp - 1;
+	test -> probe_addresses[5] = test -> sp;
+	test -> probe_addresses[6] = test -> sp + 1;
+	test -> probe_addresses[7] = immediate;
+	test -> probe_addresses[8] = immediate + 1;
+	test -> probe_addresses[9] = hl;		//last, so the byte at HL is the operand
+
+	for(i = 0; i < EXERCISE_PROBES - 1; i++)
+	{
+		test -> probe_values[i] = bytes >> ((i % 4) * BYTE) ^ (random >> (i * 5));
+	}
+
+	test -> probe_values[EXERCISE_PROBES - 1] = operand;
+}
+
+static inline void LoadExerciseMemory(uint8_t *target, exercise_case *test)
+{
+	int i;
+
+	for(i = 0; i < EXERCISE_PROBES; i++)
+	{
+		target[test -> probe_addresses[i]] = test -> probe_values[i];
+	}
+
+	target[test -> pc + 0] = test -> instruction[0];
+	target[test -> pc + 1] = test -> instruction[1];
+	target[test -> pc + 2] = test -> instruction[2];
+}
+
+static inline void CaptureExerciseProbes(uint8_t *source, exercise_case *test, exercise_state *state)
+{
+	int i;
+
+	for(i = 0; i < EXERCISE_PROBES; i++)
+	{
+		state -> probes[i] = source[test -> probe_addresses[i]];
+	}
+}
+
+void ExerciseReference(exercise_case *test, exercise_state *state)
+{
+	reference_cpu cpu;
+
+	LoadExerciseMemory(reference_memory, test);
+	memcpy(cpu.registers, test -> registers, sizeof(cpu.registers));
+	cpu.pc = test -> pc;
+	cpu.sp = test -> sp;
+	cpu.time = 0;
+	cpu.interrupt_enable = test -> interrupt_enable;
+	cpu.halt_enable = 0;
+	reference_io[test -> instruction[1]] = test -> port_value;
+
+	ReferenceStep(&cpu);
+
+	memset(state, 0, sizeof(exercise_state));
+	memcpy(state -> registers, cpu.registers, sizeof(state -> registers));
+	state -> pc = cpu.pc;
+	state -> sp = cpu.sp;
+	state -> cycles = cpu.time;
+	state -> interrupt_enable = cpu.interrupt_enable;
+	state -> halt_enable = cpu.halt_enable;
+	state -> port_value = reference_io[test -> instruction[1]];
+	CaptureExerciseProbes(reference_memory, test, state);
+}
+
+//Runs the case through the instruction set (as fetched), or only sets it up if execute is 0
+void ExerciseInterpreter(exercise_case *test, exercise_state *state, uint8_t execute)
+{
+	LoadExerciseMemory(memory, test);
+	memcpy(register_file, test -> registers, sizeof(test -> registers));
+	instruction_register = test -> instruction[0];
+	pc = test -> pc + 1;
+	sp = test -> sp;
+	time = 0;
+	interrupt_enable = test -> interrupt_enable;
+	halt_enable = 0;
+	io[test -> instruction[1]] = test -> port_value;
+
+	if(execute)
+	{
+		instruction_set[instruction_register](&instruction_set_data[instruction_register]);
+	}
+
+	memset(state, 0, sizeof(exercise_state));
+	memcpy(state -> registers, register_file, sizeof(state -> registers));
+	state -> pc = pc;
+	state -> sp = sp;
+	state -> cycles = time;
+	state -> interrupt_enable = interrupt_enable;
+	state -> halt_enable = halt_enable;
+	state -> port_value = io[test -> instruction[1]];
+	CaptureExerciseProbes(memory, test, state);
+}
+
+static inline double Seconds(struct timeval *start, struct timeval *end)
+{
+	return (end -> tv_sec - start -> tv_sec) + (end -> tv_usec - start -> tv_usec) / 1000000.0;
+}
+
+/*
+ * Folds every case of opcode through the reference model and the instruction set.
+ * The instruction set is run twice, once without executing, so the time spent
+ * setting up cases can be taken out of the benchmark.
+ */
+void ExerciseOpcode(uint8_t opcode, exercise_result *result)
+{
+	exercise_case test;
+	exercise_state expected, actual;
+	struct timeval start, end;
+	uint32_t index;
+	double setup_seconds;
+
+	result -> opcode = opcode;
+	result -> expected = 0xffffffff;
+	result -> actual = 0xffffffff;
+	result -> first_difference = EXERCISE_NO_DIFFERENCE;
+
+	for(index = 0; index < exercise_cases; index++)
+	{
+		GenerateExerciseCase(opcode, index, &test);
+		ExerciseReference(&test, &expected);
+		result -> expected = Crc32(result -> expected, &expected, sizeof(exercise_state));
+	}
+
+	exercise_setup_crc = 0xffffffff;
+	gettimeofday(&start, NULL);
+
+	for(index = 0; index < exercise_cases; index++)
+	{
+		GenerateExerciseCase(opcode, index, &test);
+		ExerciseInterpreter(&test, &actual, 0);
+		exercise_setup_crc = Crc32(exercise_setup_crc, &actual, sizeof(exercise_state));
+	}
+
+	gettimeofday(&end, NULL);
+	setup_seconds = Seconds(&start, &end);
+	gettimeofday(&start, NULL);
+
+	for(index = 0; index < exercise_cases; index++)
+	{
+		GenerateExerciseCase(opcode, index, &test);
+		ExerciseInterpreter(&test, &actual, 1);
+		result -> actual = Crc32(result -> actual, &actual, sizeof(exercise_state));
+	}
+
+	gettimeofday(&end, NULL);
+	result -> seconds = Seconds(&start, &end) - setup_seconds;
+	result -> seconds = (result -> seconds > 0) ? result -> seconds : 0;
+
+	result -> expected = ~result -> expected;
+	result -> actual = ~result -> actual;
+
+	if(result -> expected == result -> actual)
+	{
+		return;
+	}
+
+	for(index = 0; index < exercise_cases; index++)
+	{
+		GenerateExerciseCase(opcode, index, &test);
+		ExerciseReference(&test, &expected);
+		ExerciseInterpreter(&test, &actual, 1);
+
+		if(memcmp(&expected, &actual, sizeof(exercise_state)) != 0)
+		{
+			result -> first_difference = index;
+			break;
+		}
+	}
+}
+
+void PrintExerciseState(char *label, exercise_state *state, exercise_state *other, exercise_case *test)
+{
+	int i;
+
+	printf("\t%-9s B=%02x C=%02x D=%02x E=%02x H=%02x L=%02x A=%02x F=%02x PC=%04x SP=%04x cycles=%u IE=%u HLT=%u port=%02x",
+		label, state -> registers[B], state -> registers[C], state -> registers[D], state -> registers[E],
+		state -> registers[H], state -> registers[L], state -> registers[A], state -> registers[STATUS],
+		state -> pc, state -> sp, state -> cycles, state -> interrupt_enable, state -> halt_enable, state -> port_value);
+
+	//only the bytes of memory that differ
+	for(i = 0; i < EXERCISE_PROBES; i++)
+	{
+		if(state -> probes[i] != other -> probes[i])
+		{
+			printf(" [%04x]=%02x", test -> probe_addresses[i], state -> probes[i]);
+		}
+	}
+
+	printf("\n");
+}
+
+//Reruns a differing case here, to show the machine before and after
+void PrintExerciseDifference(exercise_result *result)
+{
+	exercise_case test;
+	exercise_state expected, actual;
+
+	GenerateExerciseCase(result -> opcode, result -> first_difference, &test);
+	ExerciseReference(&test, &expected);
+	ExerciseInterpreter(&test, &actual, 1);
+
+	printf("\tcase %u: B=%02x C=%02x D=%02x E=%02x H=%02x L=%02x A=%02x F=%02x PC=%04x SP=%04x bytes %02x %02x %02x\n",
+		result -> first_difference, test.registers[B], test.registers[C], test.registers[D], test.registers[E],
+		test.registers[H], test.registers[L], test.registers[A], test.registers[STATUS],
+		test.pc, test.sp, test.instruction[0], test.instruction[1], test.instruction[2]);
+	PrintExerciseState("expected", &expected, &actual, &test);
+	PrintExerciseState("got", &actual, &expected, &test);
+}
+
+static inline uint8_t IsArithmeticOpcode(uint8_t opcode)
+{
+	return (opcode & 0xc0) == 0x80 || (opcode & 0xc7) == 0xc6;
+}
+
+/*
+ * Exercises all opcodes, split across jobs forked with their own copy of the
+ * machine, and reports the ones that differ from the reference model.
+ * The functions in instruction_set are the ones exercised, so options that
+ * replace them (-idioms, -native) are exercised too.
+ * Returns EXIT_FAILURE if any opcode differs.
+ */
+int RunExerciser()
+{
+	exercise_result results[INSTRUCTION_SET_SIZE], result;
+	struct timeval start, end;
+	double arithmetic_seconds = 0, all_seconds = 0;
+	uint32_t arithmetic_opcodes = 0, failures = 0;
+	int jobs = (exercise_jobs > 0) ? exercise_jobs : sysconf(_SC_NPROCESSORS_ONLN),
+	    channel[2], job, opcode, received = 0;
+	pid_t pid;
+
+	jobs = (jobs < 1) ? 1 : (jobs > EXERCISE_MAX_JOBS) ? EXERCISE_MAX_JOBS : jobs;
+
+	exercise_region = calloc(REFERENCE_MEMORY_SIZE + 2 * EXERCISE_SLACK, sizeof(uint8_t));
+	reference_memory = calloc(REFERENCE_MEMORY_SIZE, sizeof(uint8_t));
+	io = calloc(PORTS, sizeof(uint8_t));
+
+	if(exercise_region == NULL || reference_memory == NULL || io == NULL || pipe(channel) != 0)
+	{
+		printf("Couldn't set up the exerciser.\n");
+		return EXIT_FAILURE;
+	}
+
+	address_space = memory = exercise_region + EXERCISE_SLACK;
+	InitializeCrcTable();
+
+	printf("Exercising %d opcodes with %u cases each on %d jobs\n", INSTRUCTION_SET_SIZE, exercise_cases, jobs);
+	fflush(stdout);
+
+	gettimeofday(&start, NULL);
+
+	for(job = 0; job < jobs; job++)
+	{
+		if((pid = fork()) < 0)
+		{
+			printf("Couldn't start exerciser job %d.\n", job);
+			return EXIT_FAILURE;
+		}
+
+		if(pid == 0)
+		{
+			close(channel[0]);
+
+			for(opcode = job; opcode < INSTRUCTION_SET_SIZE; opcode += jobs)
+			{
+				ExerciseOpcode(opcode, &result);
+
+				if(write(channel[1], &result, sizeof(result)) != sizeof(result))
+				{
+					_exit(EXIT_FAILURE);
+				}
+			}
+
+			_exit(EXIT_SUCCESS);
+		}
+	}
+
+	close(channel[1]);
+
+	while(received < INSTRUCTION_SET_SIZE && read(channel[0], &result, sizeof(result)) == sizeof(result))
+	{
+		results[result.opcode] = result;
+		received++;
+	}
+
+	close(channel[0]);
+
+	while(wait(NULL) > 0)
+	{
+		;
+	}
+
+	gettimeofday(&end, NULL);
+
+	if(received < INSTRUCTION_SET_SIZE)
+	{
+		printf("Only %d of %d opcodes were exercised.\n", received, INSTRUCTION_SET_SIZE);
+		return EXIT_FAILURE;
+	}
+
+	for(opcode = 0; opcode < INSTRUCTION_SET_SIZE; opcode++)
+	{
+		all_seconds += results[opcode].seconds;
+
+		if(IsArithmeticOpcode(opcode))
+		{
+			arithmetic_seconds += results[opcode].seconds;
+			arithmetic_opcodes++;
+		}
+
+		if(results[opcode].expected == results[opcode].actual)
+		{
+			continue;
+		}
+
+		failures++;
+		printf("%02x %-11s expected %08x, got %08x\n", opcode, instruction_set_data[opcode].name, results[opcode].expected, results[opcode].actual);
+
+		if(results[opcode].first_difference != EXERCISE_NO_DIFFERENCE)
+		{
+			PrintExerciseDifference(results + opcode);
+		}
+	}
+
+	printf("%u of %d opcodes differ from the reference model (%.2f s)\n", failures, INSTRUCTION_SET_SIZE, Seconds(&start, &end));
+	printf("Arithmetic and logic: %.2f ns per instruction (%.1f million per second)\n",
+		arithmetic_seconds * 1e9 / ((double)arithmetic_opcodes * exercise_cases),
+		arithmetic_seconds > 0 ? arithmetic_opcodes * (double)exercise_cases / arithmetic_seconds / 1e6 : 0);
+	printf("All opcodes: %.2f ns per instruction (%.1f million per second)\n",
+		all_seconds * 1e9 / ((double)INSTRUCTION_SET_SIZE * exercise_cases),
+		all_seconds > 0 ? INSTRUCTION_SET_SIZE * (double)exercise_cases / all_seconds / 1e6 : 0);
+
+	free(exercise_region);
+	free(reference_memory);
+	free(io);
+
+	return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,399 @@
+/************************************************************************
+ * 8080 Emulator Fuzzer							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Runs a program to a chosen pc, snapshots it, then repeatedly	*
+ * restores the snapshot and feeds it mutated keyboard or storage	*
+ * input, keeping inputs that reach new edges				*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <sys/time.h>
+
+#define FUZZ_MAX_INPUT		256
+#define FUZZ_MAX_CORPUS		4096
+#define FUZZ_MAX_SAVED		100		//crashes and hangs written to the output directory
+#define FUZZ_SETUP_CYCLES	(CLOCK_RATE * 60)	//cycles allowed to reach the snapshot pc
+#define FUZZ_SHADOW_STACK	256
+#define EDGE_MAP_SIZE		0x10000
+
+typedef enum fuzz_target_input
+{
+	FUZZ_KEYBOARD,
+	FUZZ_STORAGE
+} fuzz_target;
+
+typedef enum fuzz_run_result
+{
+	FUZZ_OK,
+	FUZZ_HANG,
+	FUZZ_WILD_JUMP,
+	FUZZ_STACK_CORRUPTION
+} fuzz_result;
+
+const char *fuzz_result_names[] = {"ok", "hang", "wild-jump", "stack-corruption"};
+
+typedef struct fuzz_input_data
+{
+	uint16_t length;
+	uint8_t bytes[FUZZ_MAX_INPUT];
+} fuzz_input;
+
+//options
+uint8_t fuzz_enabled = 0;
+uint16_t fuzz_pc = 0;
+fuzz_target fuzz_target_input = FUZZ_KEYBOARD;
+uint32_t fuzz_runs = 100000;
+uint32_t fuzz_cycles = CLOCK_RATE;		//cycle limit of one run (1 emulated second)
+char *fuzz_output = NULL;
+unsigned int fuzz_seed = 8080;
+
+//state of the current run
+fuzz_input *fuzz_current;
+uint16_t fuzz_input_position;
+uint8_t fuzz_input_exhausted;
+
+uint8_t edge_map[EDGE_MAP_SIZE];		//hit counts of this run
+uint8_t virgin_map[EDGE_MAP_SIZE];		//count buckets seen in any run
+uint8_t count_bucket[256];
+
+uint16_t shadow_stack[FUZZ_SHADOW_STACK];
+int shadow_depth;
+
+fuzz_input fuzz_corpus[FUZZ_MAX_CORPUS];
+int fuzz_corpus_size = 0;
+
+//Keyboard source that hands the program the fuzz input one key at a time
+int FuzzKeyboardByte()
+{
+	if(fuzz_input_position >= fuzz_current -> length)
+	{
+		fuzz_input_exhausted = 1;
+		return ERR;
+	}
+
+	return fuzz_current -> bytes[fuzz_input_position++];
+}
+
+int NoKeyboardInput()
+{
+	return ERR;
+}
+
+//Hit counts are compared in buckets (1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+) so loop counts don't swamp the corpus
+void InitializeCountBuckets()
+{
+	int i;
+
+	for(i = 0; i < 256; i++)
+	{
+		count_bucket[i] = (i == 0) ? 0 : (i == 1) ? 1 : (i == 2) ? 2 : (i == 3) ? 4 :
+				  (i < 8) ? 8 : (i < 16) ? 16 : (i < 32) ? 32 : (i < 128) ? 64 : 128;
+	}
+}
+
+//Returns 1 if this run hit an edge, or an edge count bucket, no earlier run did
+uint8_t HasNewCoverage()
+{
+	uint64_t *edges = (uint64_t *)edge_map;
+	uint8_t new_coverage = 0, bucket;
+	int i, j;
+
+	for(i = 0; i < EDGE_MAP_SIZE / 8; i++)
+	{
+		if(edges[i] == 0)
+		{
+			continue;
+		}
+
+		for(j = i * 8; j < i * 8 + 8; j++)
+		{
+			bucket = count_bucket[edge_map[j]];
+
+			if(bucket & ~virgin_map[j])
+			{
+				virgin_map[j] |= bucket;
+				new_coverage = 1;
+			}
+		}
+	}
+
+	return new_coverage;
+}
+
+//Runs one input from the snapshot
+fuzz_result FuzzExecute(snapshot *base, fuzz_input *input)
+{
+	uint16_t instruction_address, previous_sp;
+	uint32_t start_time;
+	uint8_t *edge_count;
+
+	RestoreDirtyPages(base);
+	memset(edge_map, 0, EDGE_MAP_SIZE);
+
+	fuzz_current = input;
+	fuzz_input_position = 0;
+	fuzz_input_exhausted = 0;
+	shadow_depth = 0;
+
+	if(fuzz_target_input == FUZZ_STORAGE)
+	{
+		memcpy(hard_disk, input -> bytes, input -> length);
+	}
+
+	start_time = time;
+
+	while(!halt_enable && !fuzz_input_exhausted)
+	{
+		if(time - start_time > fuzz_cycles)
+		{
+			return FUZZ_HANG;
+		}
+
+		//code lives in volatile memory; anything above it is registers, video memory or unmapped
+		if(pc >= MEMORY_SIZE)
+		{
+			return FUZZ_WILD_JUMP;
+		}
+
+		instruction_address = pc;
+		previous_sp = sp;
+
+		InterruptCheckAndInstructionFetch();
+		instruction_set[instruction_register](&instruction_set_data[instruction_register]);
+
+		if(IsControlTransfer(instruction_register))
+		{
+			edge_count = edge_map + (((instruction_address * 0x9e37) >> 1) ^ pc) % EDGE_MAP_SIZE;
+			*edge_count += (*edge_count != 0xff);
+
+			//every return has to go back to where the matching call pushed
+			if(IsCallInstruction(instruction_register) && sp == (uint16_t)(previous_sp - 2))
+			{
+				if(shadow_depth == FUZZ_SHADOW_STACK)
+				{
+					return FUZZ_STACK_CORRUPTION;
+				}
+
+				shadow_stack[shadow_depth++] = ReadWord(sp);
+			}
+			else if(IsReturnInstruction(instruction_register) && sp == (uint16_t)(previous_sp + 2) && shadow_depth > 0)
+			{
+				if(shadow_stack[--shadow_depth] != pc)
+				{
+					return FUZZ_STACK_CORRUPTION;
+				}
+			}
+		}
+
+		NonVolatileMemoryOperation();
+		ReadKeyboardInput();
+	}
+
+	return FUZZ_OK;
+}
+
+void MutateInput(fuzz_input *parent, fuzz_input *child)
+{
+	const uint8_t interesting[] = {0x00, 0x01, 0x0a, 0x0d, 0x1b, 0x20, 0x7f, 0x80, 0xff};
+	int mutations = 1 + rand() % 4,
+	    position;
+
+	*child = *parent;
+
+	while(mutations--)
+	{
+		position = (child -> length > 0) ? rand() % child -> length : 0;
+
+		switch(rand() % 6)
+		{
+		case 0:		//flip a bit
+			if(child -> length > 0)
+			{
+				child -> bytes[position] ^= 1 << (rand() % 8);
+			}
+			break;
+		case 1:		//random byte
+			if(child -> length > 0)
+			{
+				child -> bytes[position] = rand();
+			}
+			break;
+		case 2:		//small add/subtract
+			if(child -> length > 0)
+			{
+				child -> bytes[position] += (rand() % 17) - 8;
+			}
+			break;
+		case 3:		//interesting value
+			if(child -> length > 0)
+			{
+				child -> bytes[position] = interesting[rand() % sizeof(interesting)];
+			}
+			break;
+		case 4:		//insert a byte
+			if(child -> length < FUZZ_MAX_INPUT)
+			{
+				memmove(child -> bytes + position + 1, child -> bytes + position, child -> length - position);
+				child -> bytes[position] = (rand() % 2) ? rand() : interesting[rand() % sizeof(interesting)];
+				child -> length++;
+			}
+			break;
+		case 5:		//delete a byte
+			if(child -> length > 1)
+			{
+				memmove(child -> bytes + position, child -> bytes + position + 1, child -> length - position - 1);
+				child -> length--;
+			}
+			break;
+		};
+	}
+}
+
+void SaveFuzzInput(const char *kind, int number, fuzz_input *input)
+{
+	char path[512];
+	FILE *file;
+
+	if(fuzz_output == NULL)
+	{
+		return;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s-%06d", fuzz_output, kind, number);
+
+	if((file = fopen(path, "wb")) != NULL)
+	{
+		fwrite(input -> bytes, 1, input -> length, file);
+		fclose(file);
+	}
+}
+
+//Runs the program (without a monitor) until pc reaches fuzz_pc
+int RunToFuzzStart()
+{
+	keyboard_source = NoKeyboardInput;
+
+	while(!halt_enable && pc != fuzz_pc && time < FUZZ_SETUP_CYCLES)
+	{
+		InterruptCheckAndInstructionFetch();
+		instruction_set[instruction_register](&instruction_set_data[instruction_register]);
+
+		NonVolatileMemoryOperation();
+		ReadKeyboardInput();
+	}
+
+	if(pc != fuzz_pc)
+	{
+		printf("The program never reached %04x.\n", fuzz_pc);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int RunFuzzer()
+{
+	snapshot *base;
+	fuzz_input child;
+	fuzz_result result;
+	uint32_t run, results[4] = {0};
+	struct timeval start, end;
+	double seconds;
+	int edges = 0, i;
+
+	if(RunToFuzzStart() != EXIT_SUCCESS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	if((base = malloc(sizeof(snapshot))) == NULL)
+	{
+		printf("Couldn't allocate the fuzzing snapshot.\n");
+		return EXIT_FAILURE;
+	}
+
+	SaveMachineState(base);
+	StartDirtyTracking();
+
+	InitializeCountBuckets();
+	srand(fuzz_seed);
+	keyboard_source = FuzzKeyboardByte;
+
+	//seed corpus: a single carriage return
+	fuzz_corpus[0].length = 1;
+	fuzz_corpus[0].bytes[0] = '\r';
+	fuzz_corpus_size = 1;
+	FuzzExecute(base, fuzz_corpus);
+	HasNewCoverage();
+
+	gettimeofday(&start, NULL);
+
+	for(run = 0; run < fuzz_runs; run++)
+	{
+		MutateInput(fuzz_corpus + rand() % fuzz_corpus_size, &child);
+
+		result = FuzzExecute(base, &child);
+		results[result]++;
+
+		if(HasNewCoverage() && fuzz_corpus_size < FUZZ_MAX_CORPUS)
+		{
+			fuzz_corpus[fuzz_corpus_size] = child;
+			SaveFuzzInput("queue", fuzz_corpus_size, &child);
+			fuzz_corpus_size++;
+		}
+
+		if(result != FUZZ_OK && results[result] <= FUZZ_MAX_SAVED)
+		{
+			SaveFuzzInput(fuzz_result_names[result], results[result], &child);
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+
+	for(i = 0; i < EDGE_MAP_SIZE; i++)
+	{
+		edges += (virgin_map[i] != 0);
+	}
+
+	printf("Fuzzing from %04x: %u runs in %.2f s (%.0f runs/s)\n", fuzz_pc, fuzz_runs, seconds, seconds > 0 ? fuzz_runs / seconds : 0);
+	printf("Corpus: %d inputs, %d edges\n", fuzz_corpus_size, edges);
+	printf("Hangs: %u Wild jumps: %u Stack corruption: %u\n", results[FUZZ_HANG], results[FUZZ_WILD_JUMP], results[FUZZ_STACK_CORRUPTION]);
+
+	free(base);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Parses a fuzzing option: <hex pc>[:keyboard|storage]
+ * pc is where the snapshot is taken; the target is the input that gets mutated
+ */
+int ParseFuzzOption(char *option)
+{
+	unsigned int address;
+	char *target = strchr(option, ':');
+
+	if(sscanf(option, "%x", &address) != 1 || address > 0xffff
+	|| (target != NULL && strcmp(target, ":keyboard") != 0 && strcmp(target, ":storage") != 0))
+	{
+		printf("Fuzzing is given as <hex pc>[:keyboard|storage].\n");
+		return EXIT_FAILURE;
+	}
+
+	fuzz_pc = address;
+	fuzz_target_input = (target != NULL && strcmp(target, ":storage") == 0) ? FUZZ_STORAGE : FUZZ_KEYBOARD;
+	fuzz_enabled = 1;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/************************************************************************
+ * 8080 Emulator Loop Idioms						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Recognizes counted copy and fill loops when their JNZ is taken	*
+ * and runs the remaining iterations as one host block operation	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define JNZ_OPCODE		0xc2
+#define MAX_IDIOM_LENGTH	8
+
+#define MMIO_START_ADDRESS	0x3000		//memory-mapped io (0x3000 to 0x3fff)
+#define MMIO_END_ADDRESS	0x4000
+
+typedef enum loop_idiom_kind
+{
+	COPY_LOOP,
+	FILL_LOOP
+} idiom_kind;
+
+/*
+ * Loop bodies, from the loop label up to (not including) the JNZ back to it.
+ * COPY_LOOP:	MOV A, M / STAX D / INX H / INX D / DCR r / JNZ
+ * FILL_LOOP:	MOV M, A / INX H / DCR r / JNZ
+ */
+typedef struct loop_idiom
+{
+	const uint8_t body[MAX_IDIOM_LENGTH];
+	const uint8_t length;
+	const idiom_kind kind;
+	uint8_t *const counter;
+} idiom;
+
+idiom loop_idioms[] =
+{
+	{{0x7e, 0x12, 0x23, 0x13, 0x0d}, 5, COPY_LOOP, register_file + C},
+	{{0x7e, 0x12, 0x23, 0x13, 0x05}, 5, COPY_LOOP, register_file + B},
+	{{0x77, 0x23, 0x0d}, 3, FILL_LOOP, register_file + C},
+	{{0x77, 0x23, 0x05}, 3, FILL_LOOP, register_file + B}
+};
+
+#define LOOP_IDIOMS	(sizeof(loop_idioms) / sizeof(idiom))
+
+//Block operations touching memory-mapped registers (or wrapping) have to run one iteration at a time
+static inline uint8_t IsPlainMemory(uint16_t address, uint16_t count)
+{
+	return address + count <= ADDRESSED_SPACE_SIZE
+		&& (address + count <= MMIO_START_ADDRESS || address >= MMIO_END_ADDRESS);
+}
+
+/*
+ * Taken JNZ that closes a recognized loop.
+ * Of the r iterations left, the first r - 1 run as one block operation and the
+ * counter is left at 1, so the interpreter runs the last iteration itself and
+ * produces the exact final registers and flags.
+ */
+void JnzIdiom(data *in)
+{
+	uint16_t address = ReadWord(pc),
+		 body_length = pc - 1 - address,
+		 iterations;
+	uint32_t iteration_duration;
+	idiom *loop;
+	uint32_t i, j;
+
+	if((status[0] & 0x08) || body_length > MAX_IDIOM_LENGTH)
+	{
+		JumpConditional(in);
+		return;
+	}
+
+	for(i = 0; i < LOOP_IDIOMS; i++)
+	{
+		loop = loop_idioms + i;
+
+		if(loop -> length == body_length && memcmp(memory + address, loop -> body, body_length) == 0)
+		{
+			break;
+		}
+	}
+
+	if(i == LOOP_IDIOMS || loop -> counter[0] < 2)
+	{
+		JumpConditional(in);
+		return;
+	}
+
+	iterations = loop -> counter[0] - 1;
+
+	switch(loop -> kind)
+	{
+	case COPY_LOOP:
+		if(!IsPlainMemory(h_pair[0], iterations) || !IsPlainMemory(d_pair[0], iterations))
+		{
+			JumpConditional(in);
+			return;
+		}
+
+		NativeCopy(d_pair[0], h_pair[0], iterations);
+		a[0] = memory[h_pair[0] + iterations - 1];
+		d_pair[0] += iterations;
+		break;
+	case FILL_LOOP:
+		if(!IsPlainMemory(h_pair[0], iterations))
+		{
+			JumpConditional(in);
+			return;
+		}
+
+		memset(memory + h_pair[0], a[0], iterations);
+		MarkStoreRange(h_pair[0], iterations);
+		break;
+	};
+
+	h_pair[0] += iterations;
+	loop -> counter[0] = 1;
+
+	iteration_duration = in -> duration;
+	for(j = 0; j < body_length; j++)
+	{
+		iteration_duration += instruction_set_data[loop -> body[j]].duration;
+	}
+
+	pc = address;
+	time += in -> duration + iterations * iteration_duration;
+}
+
+void EnableLoopIdioms()
+{
+	instruction_set[JNZ_OPCODE] = JnzIdiom;
+}
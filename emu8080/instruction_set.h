@@ -5,9 +5,9 @@
  * Array of the 8080 instruction set, including a function pointer	*
  * to the function that emulates the function				*
  * Contents:								*
- * 27 	- instruction_set_data array					*
- * 288 	- Instruction-Emulating Functions 				*
- * 1653	- instruction_set array 					*
+ * 29 	- instruction_set_data array					*
+ * 317 	- Instruction-Emulating Functions 				*
+ * 1266	- instruction_set array 					*
  ************************************************************************/
 
 #ifndef INCLUDE
@@ -286,6 +286,34 @@ data instruction_set_data[INSTRUCTION_SET_SIZE] =
 		{NULL, NULL, NULL, "RST 7", 1, NONE, 11}	
 };
 
+//Opcode Classes (used by the decode cache, the image analysis and the fuzzer)
+//CALL, Ccc and RST: push a return address
+static inline uint8_t IsCallInstruction(uint8_t opcode)
+{
+	return opcode == 0xcd || (opcode & 0xc7) == 0xc4 || (opcode & 0xc7) == 0xc7;
+}
+
+//RET and Rcc
+static inline uint8_t IsReturnInstruction(uint8_t opcode)
+{
+	return opcode == 0xc9 || (opcode & 0xc7) == 0xc0;
+}
+
+//Instructions that may leave pc other than at the next instruction: JMP, Jcc, PCHL, calls and returns
+static inline uint8_t IsControlTransfer(uint8_t opcode)
+{
+	return opcode == 0xc3 || opcode == 0xe9 || (opcode & 0xc7) == 0xc2 || IsCallInstruction(opcode) || IsReturnInstruction(opcode);
+}
+
+/*
+ * Last instruction of a basic block: a control transfer, or HLT, EI or DI,
+ * after which a halt or an interrupt may have to be taken before going on
+ */
+static inline uint8_t EndsBlock(uint8_t opcode)
+{
+	return IsControlTransfer(opcode) || opcode == 0x76 || opcode == 0xfb || opcode == 0xf3;
+}
+
 //Instruction-Emulating Functions
 
 //Special Emulator Functions
@@ -373,55 +401,203 @@ static inline void ModifyFlags(uint8_t bit_4_sum, uint16_t result, uint8_t flags
 	}
 }
 
-//Data Transfer
-//Move contents of source register to destination register (0x40 to 0x7F excluding 0x46, 0x4E, 0x56, 0x5E, 0x66, 0x6E, 0x70-0x77)
-void MovRegister(data *in)
+//Memory Stores
+/*
+ * Stores to pages marked in store_pages are passed on: video memory marks the
+ * rows the renderer (video.h) converts at the next frame, decoded code is
+ * dropped from the decode cache (decode.h) and write watchpoints stop the run
+ * for the debugger (debug.h). Other pages cost one table lookup.
+ */
+void TrackedStore(uint16_t address, uint32_t count)		//count bytes, all in address's page
 {
-	uint8_t *destination_register = in -> register_2, 
-		*source_register = in -> register_1;
-		
-	*destination_register = *source_register;		
+	uint8_t page = store_pages[address >> 8];
+	uint16_t offset = address - VIDEO_MEM_START_ADDRESS;
+	uint32_t row;
 
-	time += in -> duration;
+	if(page & STORE_VIDEO)
+	{
+		for(row = offset / VIDEO_ROW_BYTES; row <= (offset + count - 1) / VIDEO_ROW_BYTES; row++)
+		{
+			video_dirty_rows[row] = 1;
+		}
+	}
+
+	if((page & STORE_CODE) && code_store_hook != NULL)
+	{
+		code_store_hook(address, count);
+	}
+
+	if((page & STORE_WATCH) && watch_store_hook != NULL)
+	{
+		watch_store_hook(address, count);
+	}
 }
 
-//Move to memory (0x70-0x77 excluding 0x76)
-void MovToMemory(data *in)
+static inline void MarkStore(uint16_t address)
 {
-	uint8_t *source = in -> register_1;
-	uint16_t address = h_pair[0];		
-	
-	memory[address] = source[0];
+	if(store_pages[address >> 8])
+	{
+		TrackedStore(address, 1);
+	}
+}
 
-	time += in -> duration;
+//For block stores of count bytes from address (which may wrap)
+static inline void MarkStoreRange(uint16_t address, uint32_t count)
+{
+	uint32_t step;
+
+	while(count > 0)
+	{
+		step = 0x100 - (address & 0xff);
+		step = step < count ? step : count;
+
+		if(store_pages[address >> 8])
+		{
+			TrackedStore(address, step);
+		}
+
+		address += step;
+		count -= step;
+	}
 }
 
-//Move from memory (0x46, 0x4E, 0x56, 0x5E, 0x66, 0x6E, 0x7E)
-void MovFromMemory(data *in)
-{ 
-	uint8_t *destination = in -> register_2;
-	uint16_t address = h_pair[0];
-	
-	destination[0] = memory[address];	
+static inline void WriteByte(uint16_t address, uint8_t value)
+{
+	memory[address] = value;
+	MarkStore(address);
+}
 
-	time += in -> duration;
+//16-bit Memory Access
+/*
+ * Words are stored low byte first, like the host's, so a word is moved with a
+ * single host access unless it wraps past 0xffff or touches the page of
+ * memory-mapped device registers, where it is split into bytes (low byte first)
+ */
+static inline uint8_t IsSplitWord(uint16_t address)
+{
+	return address == 0xffff || (address >> 8) == DEVICE_REGISTER_PAGE || ((address + 1) >> 8) == DEVICE_REGISTER_PAGE;
 }
 
-//Move immediate value to register or memory (0x06, 0x0E, 0x16, 0x1E, 0x26, 0x2E, 0x36, 0x3E) 
-void Mvi(data *in)
+static inline uint16_t ReadWord(uint16_t address)
 {
-	uint8_t *destination_is_register = in -> register_2;	
-	uint16_t address = h_pair[0];
+	uint16_t value;
+
+	if(IsSplitWord(address))
+	{
+		return memory[address] + (memory[(uint16_t)(address + 1)] << 8);
+	}
 
-	if(destination_is_register)
+	memcpy(&value, memory + address, sizeof(value));
+
+	return value;
+}
+
+static inline void WriteWord(uint16_t address, uint16_t value)
+{
+	MarkStore(address);
+	MarkStore(address + 1);
+
+	if(IsSplitWord(address))
 	{
-		destination_is_register[0] = memory[pc];
-		pc += 1;
-		
-		return;	
+		memory[address] = value & 0xff;
+		memory[(uint16_t)(address + 1)] = value >> 8;
+		return;
 	}
 
-	memory[address] = memory[pc];
+	memcpy(memory + address, &value, sizeof(value));
+}
+
+static inline void PushWord(uint16_t value)
+{
+	sp -= 2;
+	WriteWord(sp, value);
+}
+
+static inline uint16_t PopWord()
+{
+	uint16_t value = ReadWord(sp);
+
+	sp += 2;
+
+	return value;
+}
+
+//Register Operands
+/*
+ * Handlers for the register forms of MOV, MVI, INR, DCR and the accumulator
+ * operations are generated once per register from the macros below, so each
+ * opcode gets its own handler with the register index fixed at compile time.
+ * Registers are named by the lowercase tokens b, c, d, e, h, l and a, in the
+ * order of the opcode's register field, with M (field 6) handled separately.
+ */
+#define REGISTER_INDEX_b	B
+#define REGISTER_INDEX_c	C
+#define REGISTER_INDEX_d	D
+#define REGISTER_INDEX_e	E
+#define REGISTER_INDEX_h	H
+#define REGISTER_INDEX_l	L
+#define REGISTER_INDEX_a	A
+
+#define REGISTER(r)		register_file[REGISTER_INDEX_##r]
+
+#define FOR_EACH_REGISTER(GENERATE)	\
+	GENERATE(b) GENERATE(c) GENERATE(d) GENERATE(e) GENERATE(h) GENERATE(l) GENERATE(a)
+
+//Data Transfer
+//Move contents of source register to destination register (0x40 to 0x7F excluding 0x46, 0x4E, 0x56, 0x5E, 0x66, 0x6E, 0x70-0x77)
+#define GENERATE_MOV(destination, source)	\
+void Mov_##destination##_##source(data *in)	\
+{						\
+	REGISTER(destination) = REGISTER(source);	\
+						\
+	time += in -> duration;			\
+}
+
+#define GENERATE_MOV_TO(destination)						\
+	GENERATE_MOV(destination, b) GENERATE_MOV(destination, c) GENERATE_MOV(destination, d)	\
+	GENERATE_MOV(destination, e) GENERATE_MOV(destination, h) GENERATE_MOV(destination, l)	\
+	GENERATE_MOV(destination, a)
+
+FOR_EACH_REGISTER(GENERATE_MOV_TO)
+
+//Move to memory (0x70-0x77 excluding 0x76)
+#define GENERATE_MOV_TO_MEMORY(source)		\
+void MovToMemory_##source(data *in)		\
+{						\
+	WriteByte(h_pair[0], REGISTER(source));	\
+						\
+	time += in -> duration;			\
+}
+
+FOR_EACH_REGISTER(GENERATE_MOV_TO_MEMORY)
+
+//Move from memory (0x46, 0x4E, 0x56, 0x5E, 0x66, 0x6E, 0x7E)
+#define GENERATE_MOV_FROM_MEMORY(destination)	\
+void MovFromMemory_##destination(data *in)	\
+{						\
+	REGISTER(destination) = memory[h_pair[0]];	\
+						\
+	time += in -> duration;			\
+}
+
+FOR_EACH_REGISTER(GENERATE_MOV_FROM_MEMORY)
+
+//Move immediate value to register (0x06, 0x0E, 0x16, 0x1E, 0x26, 0x2E, 0x3E)
+#define GENERATE_MVI(destination)		\
+void Mvi_##destination(data *in)		\
+{						\
+	REGISTER(destination) = memory[pc];	\
+	pc += 1;				\
+						\
+	time += in -> duration;			\
+}
+
+FOR_EACH_REGISTER(GENERATE_MVI)
+
+//Move immediate value to memory (0x36)
+void MviMemory(data *in)
+{
+	WriteByte(h_pair[0], memory[pc]);
 	pc += 1;
 
 	time += in -> duration;
@@ -430,30 +606,21 @@ void Mvi(data *in)
 //Load immediate value to register pair (0x01, 0x11, 0x21, 0x31)
 void Lxi(data *in)
 {
-	uint8_t high_byte, low_byte;
 	uint16_t *destination_register_pair = in -> register_pair;
 
-	low_byte = memory[pc + 0];
-	high_byte = memory[pc + 1];
+	destination_register_pair[0] = ReadWord(pc);
 	pc += 2;
 
-	destination_register_pair[0] = (high_byte << 8) + low_byte;
-
 	time += in -> duration;
 }
 
 //Load Accumulator directly (0x3A)
 void Lda(data *in)
 {
-	uint8_t high_byte, low_byte;
-	uint16_t address;
-	
-	low_byte = memory[pc + 0];
-	high_byte = memory[pc + 1];
-	pc += 2;	
+	uint16_t address = ReadWord(pc);
+
+	pc += 2;
 
-	address = (high_byte << 8) + low_byte;
-	
 	a[0] = memory[address];
 
 	time += in -> duration;
@@ -462,16 +629,11 @@ void Lda(data *in)
 //Load Accumulator directly (0x32)
 void Sta(data *in)
 {
-	uint8_t high_byte, low_byte;
-	uint16_t address;
-	
-	low_byte = memory[pc + 0];
-	high_byte = memory[pc + 1];
-	pc += 2;	
+	uint16_t address = ReadWord(pc);
 
-	address = (high_byte << 8) + low_byte;
-	
-	memory[address] = a[0];
+	pc += 2;
+
+	WriteByte(address, a[0]);
 
 	time += in -> duration;
 }
@@ -479,17 +641,11 @@ void Sta(data *in)
 //Load register pair H directly (0x2A)
 void Lhld(data *in)
 {
-	uint8_t high_byte, low_byte;
-	uint16_t address;
-	
-	low_byte = memory[pc + 0];
-	high_byte = memory[pc + 1];
+	uint16_t address = ReadWord(pc);
+
 	pc += 2;
-	
-	address = (high_byte << 8) + low_byte;
-	
-	l[0] = memory[address + 0];
-	h[0] = memory[address + 1];
+
+	h_pair[0] = ReadWord(address);
 
 	time += in -> duration;
 }
@@ -497,17 +653,11 @@ void Lhld(data *in)
 //Store register pair H directly (0x22)
 void Shld(data *in)
 {
-	uint8_t high_byte, low_byte;
-	uint16_t address;
-	
-	low_byte = memory[pc + 0];
-	high_byte = memory[pc + 1];
+	uint16_t address = ReadWord(pc);
+
 	pc += 2;
-	
-	address = (high_byte << 8) + low_byte;
-	
-	memory[address + 0] = l[0];
-	memory[address + 1] = h[0];
+
+	WriteWord(address, h_pair[0]);
 
 	time += in -> duration;
 }
@@ -528,7 +678,7 @@ void Stax(data *in)
 {
 	uint16_t address = (in -> register_pair)[0];
 	
-	memory[address] = a[0];
+	WriteByte(address, a[0]);
 
 	time += in -> duration;
 }
@@ -545,256 +695,153 @@ void Xchg(data *in)
 }
 
 //Arithmetic
-//Add contents of register to accumulator
-void AddRegister(data *in)
+//Zero, Sign and Parity flags of a result
+static inline uint8_t ZeroSignParity(uint8_t result)
 {
-	uint8_t addend = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result; 
+	uint8_t parity = result ^ (result >> 4);
 
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((addend & MASK4) >> 4);
-	result = a[0] + addend;
+	parity ^= parity >> 2;
+	parity ^= parity >> 1;
 
-	a[0] += addend;
-
-	ModifyFlags(bit_4_sum, result, in -> flags); 
-
-	time += in -> duration;
+	return ((result == 0) << 3) + ((result & 0x80) >> 5) + ((~parity & 0x01) << 4);
 }
 
-//Subtract contents of register from accumulator
-void SubRegister(data *in)
+/*
+ * Accumulator operations shared by the register, memory and immediate forms.
+ * Subtraction adds the complement of the subtrahend with the borrow inverted,
+ * as the 8080 does, so Aux Carry is the carry out of bit 3 of that sum and
+ * Carry is set on a borrow.
+ */
+static inline uint8_t AddWithCarry(uint8_t addend, uint8_t carry)
 {
-	uint8_t subtrahend = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((subtrahend & MASK4) >> 4);
-	result = a[0] - subtrahend;
+	uint16_t sum = a[0] + addend + carry;
 
-	a[0] -= subtrahend;
+	status[0] = (status[0] & ~ALL) + ZeroSignParity(sum)
+		+ ((((a[0] & 0x0f) + (addend & 0x0f) + carry) & 0x10) >> 3) + (sum >> 8);
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+	return sum;
 }
 
-//Add contents of memory to accumulator
-void AddMemory(data *in)
+static inline uint8_t SubtractWithBorrow(uint8_t subtrahend, uint8_t borrow)
 {
-	uint8_t addend = memory[h_pair[0]],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((addend & MASK4) >> 4);
-	result = a[0] + addend;
-
-	a[0] += addend;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
-}
-
-//Subtract contents of memory from accumulator
-void SubMemory(data *in)
-{	
-	uint8_t subtrahend = memory[h_pair[0]],	
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((subtrahend & MASK4) >> 4);
-	result = a[0] - subtrahend;
+	uint8_t result = AddWithCarry(~subtrahend, !borrow);
 
-	a[0] -= subtrahend;
+	status[0] ^= CY;
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+	return result;
 }
 
-//Add immediate
-void Adi(data *in)
+static inline void Add(uint8_t value)
 {
-	uint8_t addend = memory[pc + 0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((addend & MASK4) >> 4);
-	result = a[0] + addend;
-
-	a[0] += addend;
-	pc += 1;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+	a[0] = AddWithCarry(value, 0);
 }
 
-//Subtract immediate
-void Sui(data *in)
+static inline void Adc(uint8_t value)
 {
-	uint8_t subtrahend = memory[pc+0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((subtrahend & MASK4) >> 4);
-	result = a[0] - subtrahend;
-
-	a[0] -= subtrahend;
-	pc += 1;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+	a[0] = AddWithCarry(value, status[0] & CY);
 }
 
-//Add register with carry
-void AdcRegister(data *in)
+static inline void Sub(uint8_t value)
 {
-	uint8_t addend = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((addend & MASK4) >> 4);
-	result = a[0] + addend;
-
-	a[0] += addend + (status[0] & 0x01);	//status bit 0 is the carry/borrow flag	pc += 1;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+	a[0] = SubtractWithBorrow(value, 0);
 }
 
-//Subtract register with borrow
-void SbbRegister(data *in)
+static inline void Sbb(uint8_t value)
 {
-	uint8_t subtrahend = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((subtrahend & MASK4) >> 4);
-	result = a[0] - subtrahend;
-
-	a[0] -= (subtrahend + (status[0] & 0x01));
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+	a[0] = SubtractWithBorrow(value, status[0] & CY);
 }
 
-//Add memory with carry
-void AdcMemory(data *in)
-{
-	uint8_t addend = memory[h_pair[0]],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((addend & MASK4) >> 4);
-	result = a[0] + addend;
-
-	a[0] += addend + (status[0] & 0x01);	//status bit 0 is the carry/borrow flag	pc += 1;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+//Register and memory forms of an accumulator operation (0x80 to 0xBF)
+#define GENERATE_ACCUMULATOR_REGISTER(operation, source)	\
+void operation##_##source(data *in)				\
+{								\
+	operation(REGISTER(source));				\
+								\
+	time += in -> duration;					\
 }
 
-
-//Subtract memory with borrow
-void SbbMemory(data *in)
-{
-	uint8_t subtrahend = memory[h_pair[0]],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((subtrahend & MASK4) >> 4);
-	result = a[0] - subtrahend;
-
-	a[0] -= (subtrahend + (status[0] & 0x01));
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+#define GENERATE_ACCUMULATOR(operation)						\
+	GENERATE_ACCUMULATOR_REGISTER(operation, b) GENERATE_ACCUMULATOR_REGISTER(operation, c)	\
+	GENERATE_ACCUMULATOR_REGISTER(operation, d) GENERATE_ACCUMULATOR_REGISTER(operation, e)	\
+	GENERATE_ACCUMULATOR_REGISTER(operation, h) GENERATE_ACCUMULATOR_REGISTER(operation, l)	\
+	GENERATE_ACCUMULATOR_REGISTER(operation, a)						\
+												\
+void operation##Memory(data *in)								\
+{												\
+	operation(memory[h_pair[0]]);								\
+												\
+	time += in -> duration;									\
 }
 
-//Add immediate with carry
-void Aci(data *in)
-{
-	uint8_t addend = memory[pc + 0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((addend & MASK4) >> 4);
-	result = a[0] + addend;
-
-	a[0] += addend + (status[0] & 0x01);
-	pc += 1;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	time += in -> duration;
+//Immediate form of an accumulator operation
+#define GENERATE_ACCUMULATOR_IMMEDIATE(name, operation)	\
+void name(data *in)					\
+{							\
+	operation(memory[pc]);				\
+	pc += 1;					\
+							\
+	time += in -> duration;				\
 }
 
-//Subtract immediate with borrow
-void Sbi(data *in)
-{
-	uint8_t subtrahend = memory[pc + 0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((subtrahend & MASK4) >> 4);
-	result = a[0] - subtrahend;
-
-	a[0] -= (subtrahend + (status[0] & 0x01));
-	pc += 1;
+//Add register or memory to accumulator, with and without carry
+GENERATE_ACCUMULATOR(Add)
+GENERATE_ACCUMULATOR(Adc)
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
+//Subtract register or memory from accumulator, with and without borrow
+GENERATE_ACCUMULATOR(Sub)
+GENERATE_ACCUMULATOR(Sbb)
 
-	time += in -> duration;
-}
+//Add immediate, with and without carry; subtract immediate, with and without borrow
+GENERATE_ACCUMULATOR_IMMEDIATE(Adi, Add)
+GENERATE_ACCUMULATOR_IMMEDIATE(Aci, Adc)
+GENERATE_ACCUMULATOR_IMMEDIATE(Sui, Sub)
+GENERATE_ACCUMULATOR_IMMEDIATE(Sbi, Sbb)
 
-//Increment register
-void InrRegister(data *in)
+//Increment and decrement leave Carry alone
+static inline uint8_t Increment(uint8_t value)
 {
-	uint8_t *increment_register = (in -> register_1),
-		bit_4;
-
-	bit_4 = (increment_register[0] & MASK4) >> 4;
-
-	increment_register[0] += 1;
+	value += 1;
+	status[0] = (status[0] & (~ALL | CY)) + ZeroSignParity(value) + (((value & 0x0f) == 0x00) << 1);
 
-	ModifyFlags(bit_4, (uint16_t)increment_register[0], in -> flags);
-
-	time += in -> duration;
+	return value;
 }
 
-//Decrement register
-void DcrRegister(data *in)
+static inline uint8_t Decrement(uint8_t value)
 {
-	uint8_t *decrement_register = (in -> register_1),
-		bit_4;
+	value -= 1;
+	status[0] = (status[0] & (~ALL | CY)) + ZeroSignParity(value) + (((value & 0x0f) != 0x0f) << 1);
 
-	bit_4 = (decrement_register[0] & MASK4) >> 4;	
+	return value;
+}
 
-	decrement_register[0] -= 1;
+//Increment register (0x04, 0x0C, 0x14, 0x1C, 0x24, 0x2C, 0x3C)
+#define GENERATE_INR(r)			\
+void Inr_##r(data *in)			\
+{					\
+	REGISTER(r) = Increment(REGISTER(r));	\
+					\
+	time += in -> duration;		\
+}
 
-	ModifyFlags(bit_4, (uint16_t)decrement_register[0], in -> flags);
+FOR_EACH_REGISTER(GENERATE_INR)
 
-	time += in -> duration;
+//Decrement register (0x05, 0x0D, 0x15, 0x1D, 0x25, 0x2D, 0x3D)
+#define GENERATE_DCR(r)			\
+void Dcr_##r(data *in)			\
+{					\
+	REGISTER(r) = Decrement(REGISTER(r));	\
+					\
+	time += in -> duration;		\
 }
 
+FOR_EACH_REGISTER(GENERATE_DCR)
+
 //Increment memory
 void InrMemory(data *in)
 {
-	uint8_t bit_4;
 	uint16_t address = h_pair[0];
 
-	bit_4 = (memory[address] & MASK4) >> 4;
-
-	memory[address] += 1;
-
-	ModifyFlags(bit_4, (uint16_t)memory[address], in -> flags);
+	WriteByte(address, Increment(memory[address]));
 
 	time += in -> duration;
 }
@@ -802,14 +849,9 @@ void InrMemory(data *in)
 //Decrement memory
 void DcrMemory(data *in)
 {
-	uint8_t bit_4;
 	uint16_t address = h_pair[0];
 
-	bit_4 = (memory[address] & MASK4) >> 4;
-
-	memory[address] -= 1;
-
-	ModifyFlags(bit_4, (uint16_t)memory[address], in -> flags);
+	WriteByte(address, Decrement(memory[address]));
 
 	time += in -> duration;
 }
@@ -834,366 +876,136 @@ void Dcx(data *in)
 	time += in -> duration;
 }
 
-//Add register pair to register pair H
+//Add register pair to register pair H (only Carry, from bit 16 of the sum)
 void Dad(data *in)
 {
-	uint16_t addend = (in -> register_pair)[0],
-		 result;
-
-	result = h_pair[0] + addend;
-
-	h_pair[0] += addend;
+	uint32_t result = h_pair[0] + (in -> register_pair)[0];
 
-	ModifyFlags(0, result, in -> flags);
+	h_pair[0] = result;
+	status[0] = (status[0] & ~CY) + (result >> 16);
 
 	time += in -> duration;
 }
 
 //Decimal Adjust Accumulator
-void Daa(data *in)
+static inline void DecimalAdjust()
 {
-	uint8_t bit_4;
-	uint16_t result = a[0];
-
-	bit_4 = ((a[0] & MASK4) >> 4);
+	uint8_t correction = 0,
+		carry = status[0] & CY;
 
-	if((a[0] & 0x0F) > 9 || (status[0] & 0x02))		//status bit 1 is the auxiliary carry flag
+	if((a[0] & 0x0F) > 9 || (status[0] & AC))
 	{
-		result = a[0] + 0x06;
-		a[0] += 0x06;
-	} 
+		correction += 0x06;
+	}
 
-	if(((a[0] & 0xF0) >> 4) > 9 || (status[0] & 0x01))	//status bit 0 is the carry flag
+	if(a[0] > 0x99 || carry)
 	{
-		result = a[0] +  0x60;
-		a[0] += 0x60;
-	} 
-
-	ModifyFlags(bit_4, result, in -> flags);
+		correction += 0x60;
+		carry = 1;
+	}
 
-	time += in -> duration;
+	status[0] = (status[0] & ~ALL) + ZeroSignParity(a[0] + correction)
+		+ ((((a[0] & 0x0F) + (correction & 0x0F)) > 0x0F) << 1) + carry;
+	a[0] += correction;
 }
 
-//Logic
-//AND register
-void AnaRegister(data *in)
+void Daa(data *in)
 {
-	uint8_t and_value = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((and_value & MASK4) >> 4);
-	result = a[0] & and_value;
-
-	a[0] &= and_value;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x01;
+	DecimalAdjust();
 
 	time += in -> duration;
 }
 
-//AND memory
-void AnaMemory(data *in)
+//Logic
+//AND sets Aux Carry from bit 3 of either operand; all of them clear Carry
+static inline void Ana(uint8_t value)
 {
-	uint8_t bit_4_sum;
-	uint16_t address = h_pair[0],
-		 result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((memory[address] & MASK4) >> 4);
-	result = a[0] & memory[address];
-
-	a[0] &= memory[address];
+	status[0] = (status[0] & ~ALL) + ZeroSignParity(a[0] & value) + (((a[0] | value) & 0x08) >> 2);
+	a[0] &= value;
+}
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x01;
+static inline void Xra(uint8_t value)
+{
+	a[0] ^= value;
+	status[0] = (status[0] & ~ALL) + ZeroSignParity(a[0]);
+}
 
-	time += in -> duration;
+static inline void Ora(uint8_t value)
+{
+	a[0] |= value;
+	status[0] = (status[0] & ~ALL) + ZeroSignParity(a[0]);
 }
 
-//AND immediate
-void Ani(data *in)
+//Compare sets the flags of a subtraction without changing the accumulator
+static inline void Cmp(uint8_t value)
 {
-	uint8_t and_value = memory[pc + 0], 
-		bit_4_sum;
-	uint16_t result;
+	SubtractWithBorrow(value, 0);
+}
 
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((and_value & MASK4) >> 4);	
+//AND, XOR, OR and compare register or memory
+GENERATE_ACCUMULATOR(Ana)
+GENERATE_ACCUMULATOR(Xra)
+GENERATE_ACCUMULATOR(Ora)
+GENERATE_ACCUMULATOR(Cmp)
 
-	result = a[0] & and_value;
+//AND, XOR, OR and compare immediate
+GENERATE_ACCUMULATOR_IMMEDIATE(Ani, Ana)
+GENERATE_ACCUMULATOR_IMMEDIATE(Xri, Xra)
+GENERATE_ACCUMULATOR_IMMEDIATE(Ori, Ora)
+GENERATE_ACCUMULATOR_IMMEDIATE(Cpi, Cmp)
 
-	a[0] &= and_value;
-	pc += 1;
+//Rotate left
+void Rlc(data *in)
+{
+	uint8_t bit_7 = (a[0] & 0x80) >> 7;
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
+	a[0] = (a[0] << 1) + bit_7;
+	
+	status[0] &= ~CY;
+	status[0] += bit_7;
 
 	time += in -> duration;
 }
 
-//XOR register
-void XraRegister(data *in)
+//Rotate right
+void Rrc(data *in)
 {
-	uint8_t xor_value = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((xor_value & MASK4) >> 4);
-
-	result = a[0] ^ xor_value;
+	uint8_t bit_0 = a[0] & 0x01;
 
-	a[0] ^= xor_value;
+	a[0] = (a[0] >> 1) + (bit_0 << 7);
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
+	status[0] &= ~CY;
+	status[0] += bit_0;
 
 	time += in -> duration;
 }
 
-//XOR memory
-void XraMemory(data *in)
+//Rotate left through carry
+void Ral(data *in)
 {
-	uint8_t bit_4_sum;
-	uint16_t address = h_pair[0],
-		 result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((memory[address] & MASK4) >> 4);
+	uint8_t new_value_of_carry = (a[0] & 0x80) >> 7;
 
-	result = a[0] ^ memory[address];
-
-	a[0] ^= memory[address];
-	
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
+	a[0] = (a[0] << 1) + (status[0] & 0x01);			//pass current carry flag value to bit 0 of accumulator
+	status[0] = (status[0] & ~CY) + new_value_of_carry;		//pass bit 7 of accumulator to carry flag
 
 	time += in -> duration;
 }
 
-//XOR immediate
-void Xri(data *in)
+//Rotate right through carry
+void Rar(data *in)
 {
-	uint8_t xor_value = memory[pc + 0],
-  		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((xor_value & MASK4) >> 4);
-
-	result = a[0] ^ xor_value;
-
-	a[0] ^= xor_value;
-	pc += 1;
+	uint8_t new_value_of_carry = a[0] & 0x01;
 
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
+	a[0] = (a[0] >> 1) + ((status[0] & 0x01) << 7);
+	status[0] = (status[0] & ~CY) + new_value_of_carry;
 
 	time += in -> duration;
 }
 
-//OR register
-void OraRegister(data *in)
+//Complement accumulator
+void Cma(data *in)
 {
-	uint8_t or_value = (in -> register_1)[0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((or_value & MASK4) >> 4);
-
-	result = a[0] | or_value;
-
-	a[0] |= or_value;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
-
-	time += in -> duration;
-}
-
-//OR memory
-void OraMemory(data *in)
-{
-	uint8_t bit_4_sum;
-	uint16_t address = h_pair[0],
-		 result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((memory[address] & MASK4) >> 4);
-
-	result = a[0] | memory[address];
-
-	a[0] |= memory[address];
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
-
-	time += in -> duration;
-}
-
-//OR immediate
-void Ori(data *in)
-{
-	uint8_t or_value = memory[pc + 0],
-		bit_4_sum;
-	uint16_t result;
-
-	bit_4_sum = ((a[0] & MASK4) >> 4) + ((or_value & MASK4) >> 4);
-
-	result = a[0] | or_value;
-
-	a[0] |= or_value;
-	pc += 1;
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-	status[0] &= ~0x03;
-
-	time += in -> duration;
-}
-
-//Compare register
-void CmpRegister(data *in)
-{
-	uint8_t compare_value = (in -> register_1)[0],
-		bit_4_sum = ((a[0] & MASK4) >> 4) + ((compare_value & MASK4) >> 4),
-		_status = status[0];
-	uint16_t result = a[0] - compare_value;
-	
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	/*
-	 *restore the original values of Z and CY because 
-	 *ModifyFlags changes them improperly and 
-	 *the compare instruction is not guaranteed to change them
-	 */
-	status[0] &= ~(Z + CY);
-	status[0] += _status & (Z + CY);
-
-	if(a[0] == compare_value)
-	{
-		status[0] |= 0x08;	
-	}
-
-	if(a[0] < compare_value)
-	{
-		status[0] |= 0x01;
-	}
-
-	time += in -> duration;
-}
-
-//Compare memory
-void CmpMemory(data *in)
-{
-	uint16_t address = h_pair[0],
-		 result = a[0] - memory[address];
-	uint8_t bit_4_sum = ((a[0] & MASK4) >> 4) + ((memory[address] & MASK4) >> 4),
-		_status = status[0];
-
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	/*
-	 *restore the original values of Z and CY because 
-	 *ModifyFlags changes them improperly and 
-	 *the compare instruction is not guaranteed to change them
-	 */
-	status[0] &= ~(Z + CY);
-	status[0] += _status & (Z + CY);
-
-	if(a[0] == memory[address])
-	{
-		status[0] |= 0x08;	
-	}
-
-	if(a[0] < memory[address])
-	{
-		status[0] |= 0x01;
-	}
-
-	time += in -> duration;
-}
-
-//Compare immediate
-void Cpi(data *in)
-{
-	uint8_t compare_value = memory[pc + 0],
-		bit_4_sum = ((a[0] & MASK4) >> 4) + ((compare_value & MASK4) >> 4),
-		_status = status[0];
-	uint16_t result = a[0] - compare_value;
-	
-	ModifyFlags(bit_4_sum, result, in -> flags);
-
-	/*
-	 *restore the original values of Z and CY because 
-	 *ModifyFlags changes them improperly and 
-	 *the compare instruction is not guaranteed to change them
-	 */
-	status[0] &= ~(Z + CY);
-	status[0] += _status & (Z + CY);
-
-	if(a[0] == compare_value)
-	{
-		status[0] |= 0x08;	
-	}
-
-	if(a[0] < compare_value)
-	{
-		status[0] |= 0x01;
-	}
-	
-	pc += 1;
-
-	time += in -> duration;
-}
-
-//Rotate left
-void Rlc(data *in)
-{
-	uint8_t bit_7 = (a[0] & 0x80) >> 7;
-
-	a[0] = (a[0] << 1) + bit_7;
-	
-	status[0] &= ~CY;
-	status[0] += bit_7;
-
-	time += in -> duration;
-}
-
-//Rotate right
-void Rrc(data *in)
-{
-	uint8_t bit_0 = a[0] & 0x01;
-
-	a[0] = (a[0] >> 1) + (bit_0 << 7);
-
-	status[0] &= ~CY;
-	status[0] += bit_0;
-
-	time += in -> duration;
-}
-
-//Rotate left through carry
-void Ral(data *in)
-{
-	uint8_t new_value_of_carry = (a[0] * 0x80) >> 7;
-
-	a[0] = (a[0] << 1) + (status[0] & 0x01);			//pass current carry flag value to bit 0 of accumulator
-	status[0] = (status[0] & ~CY) + new_value_of_carry;		//pass bit 7 of accumulator to carry flag
-
-	time += in -> duration;
-}
-
-//Rotate right through carry
-void Rar(data *in)
-{
-	uint8_t new_value_of_carry = a[0] & 0x01;
-
-	a[0] = (a[0] >> 1) + ((status[0] & 0x01) << 7);
-	status[0] = (status[0] & ~CY) + new_value_of_carry;
-
-	time += in -> duration;
-}
-
-//Complement accumulator
-void Cma(data *in)
-{
-	a[0] = ~a[0];
+	a[0] = ~a[0];
 
 	time += in -> duration;
 }
@@ -1217,157 +1029,35 @@ void Stc(data *in)
 //Unconditional jump
 void Jmp(data *in)
 {
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-	
-	uint16_t address = (high_byte << 8) + low_byte;
+	uint16_t address = ReadWord(pc);
 
 	pc = address;
 
 	time += in -> duration;
 }
 
-//Conditional jumps
-void Jnz(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-	
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(!(status[0] & 0x08))
-	{
-		pc = address;
-		return;
-	}
-
-	pc += 2;
-
-	time += in -> duration;
-}
-
-void Jz(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-	
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(status[0] & 0x08)
-	{
-		pc = address;
-		return;
-	}
-
-	pc += 2;
-
-	time += in -> duration;
-}
-
-void Jnc(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-	
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(!(status[0] & 0x01))
-	{
-		pc = address;
-		return;
-	}
-
-	pc += 2;
-
-	time += in -> duration;
-}
-
-void Jc(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-	
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(status[0] & 0x01)
-	{
-		pc = address;
-		return;
-	}
-
-	pc += 2;
-
-	time += in -> duration;
-}
-
-void Jpo(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(!(status[0] & 0x10))
-	{
-		pc = address;
-		return;
-	}
-
-	pc += 2;
-
-	time += in -> duration;
-}
+/*
+ * Condition codes, bits 3 to 5 of Jcc, Ccc and Rcc: NZ, Z, NC, C, PO, PE, P, M
+ * Even codes are true when their flag is clear, odd codes when it is set.
+ */
+const uint8_t condition_flags[8] = {Z, Z, CY, CY, EP, EP, S, S};
 
-void Jpe(data *in)
+//1 if the condition in opcode holds, 0 if it doesn't
+static inline uint8_t ConditionTrue(uint8_t opcode)
 {
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(status[0] & 0x10)
-	{
-		pc = address;
-		return;
-	}
-
-	pc += 2;
+	uint8_t code = (opcode >> 3) & 0x07;
 
-	time += in -> duration;
+	return !(status[0] & condition_flags[code]) ^ (code & 0x01);
 }
 
-void Jp(data *in)
+//Conditional jumps (0xC2, 0xCA, 0xD2, 0xDA, 0xE2, 0xEA, 0xF2, 0xFA)
+void JumpConditional(data *in)
 {
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-
-	if(!(status[0] & 0x04))
-	{
-		pc = address;
-		return;
-	}
+	uint16_t address = ReadWord(pc),
+		 taken = -ConditionTrue(instruction_register);
 
 	pc += 2;
-
-	time += in -> duration;
-}
-
-void Jm(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-	
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x04)
-	{
-		pc = address;
-		return;
-	}
-	
-	pc += 2;
+	pc ^= (pc ^ address) & taken;
 
 	time += in -> duration;
 }
@@ -1375,366 +1065,63 @@ void Jm(data *in)
 //Unconditional call
 void Call(data *in)
 {
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
+	uint16_t address = ReadWord(pc);
 	
-	pc += 2;	
-	sp -= 2;		
-	memory[sp] = pc;
+	pc += 2;
+	PushWord(pc);
 	pc = address;
 
 	time += in -> duration;
 }
 
-//Conditional calls
-void Cnz(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x08))
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-		
-		time += 17;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Cz(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x08)
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Cnc(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x01))
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Cc(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x01)
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Cpo(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x10))
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Cpe(data *in)
+/*
+ * Conditional calls (0xC4, 0xCC, 0xD4, 0xDC, 0xE4, 0xEC, 0xF4, 0xFC); duration is the not-taken count
+ * Only the push waits on the condition, as a call not taken must leave memory alone.
+ */
+void CallConditional(data *in)
 {
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
+	uint16_t address = ReadWord(pc),
+		 taken = -ConditionTrue(instruction_register);
 
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x10)
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Cp(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
+	pc += 2;
 
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x04))
+	if(taken)
 	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
+		PushWord(pc);
 	}
 
-	time += in -> duration;
-}
-
-void Cm(data *in)
-{
-	uint8_t high_byte = memory[pc + 1],
-		low_byte = memory[pc + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x04)
-	{
-		pc += 2;	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-
-		time += 17;
-		return;
-	}
+	pc ^= (pc ^ address) & taken;
 
-	time += in -> duration;
+	time += in -> duration + (6 & taken);
 }
 
 //Unconditional return
 void Ret(data *in)
 {
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	sp += 2;
-	pc = address;
-
-	time += in -> duration;
-}
-
-//Conditional returns
-void Rnz(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x08))
-	{
-		sp += 2;
-		pc = address;
-
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Rz(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x08)
-	{
-		sp += 2;
-		pc = address;
-
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Rnc(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x01))
-	{
-		sp += 2;
-		pc = address;	
-
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Rc(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x01)
-	{
-		sp += 2;
-		pc = address;
-
-		time += 11;
-		return;
-	}
+	pc = PopWord();
 
 	time += in -> duration;
 }
 
-void Rpo(data *in)
+//Conditional returns (0xC0, 0xC8, 0xD0, 0xD8, 0xE0, 0xE8, 0xF0, 0xF8); duration is the not-taken count
+void ReturnConditional(data *in)
 {
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
+	uint16_t address = ReadWord(sp),
+		 taken = -ConditionTrue(instruction_register);
 
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x10))
-	{
-		sp += 2;
-		pc = address;
+	pc ^= (pc ^ address) & taken;
+	sp += 2 & taken;
 
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Rpe(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x10)
-	{
-		sp += 2;
-		pc = address;
-
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Rp(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(!(status[0] & 0x04))
-	{
-		sp += 2;
-		pc = address;
-
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
-}
-
-void Rm(data *in)
-{
-	uint8_t high_byte = memory[sp + 1],
-		low_byte = memory[sp + 0];
-
-	uint16_t address = (high_byte << 8) + low_byte;
-	
-	if(status[0] & 0x04)
-	{
-		sp += 2;
-		pc = address;
-
-		time += 11;
-		return;
-	}
-
-	time += in -> duration;
+	time += in -> duration + (6 & taken);
 }
 
 //Restart
 void Rst(data *in)
 {
-	uint16_t address = ((instruction_register & 0x38) >> 3) * 8;
-	
-	if(status[0] & 0x04)
-	{	
-		sp -= 2;		
-		memory[sp] = pc;
-		pc = address;
-	}
+	uint16_t address = instruction_register & 0x38;
+
+	PushWord(pc);
+	pc = address;
 
 	time += in -> duration;
 }
@@ -1751,28 +1138,35 @@ void Pchl(data *in)
 //Push register
 void PushRp(data *in)
 {
-	uint16_t pushed_value = (in -> register_pair)[0];
-
-	sp -= 2;
-	memory[sp] = pushed_value;
+	PushWord((in -> register_pair)[0]);
 
 	time += in -> duration;
 }
 
-//Push psw
-void PushPsw(data *in)
+//The status byte as PUSH PSW stores it: S Z 0 AC 0 P 1 CY
+static inline uint8_t PackedStatus()
 {
-	uint8_t pushed_status = 0;
+	return 	((status[0] & 0x10) >> 2) + 
+		((status[0] & 0x08) << 3) + 
+		((status[0] & 0x04) << 5) +
+		((status[0] & 0x02) << 3) +
+		(status[0] & 0x01) + 0x02;
+}
 
-	pushed_status = ((status[0] & 0x10) >> 2) + 
-			((status[0] & 0x08) << 3) + 
-			((status[0] & 0x04) << 5) +
-			((status[0] & 0x02) << 3);	
+//The status byte from the one POP PSW loads
+static inline uint8_t UnpackedStatus(uint8_t popped_status)
+{
+	return 	((popped_status & 0x80) >> 5) +
+		((popped_status & 0x40) >> 3) +
+		((popped_status & 0x10) >> 3) +
+		((popped_status & 0x04) << 2) +
+		(popped_status & 0x01);
+}
 
-	memory[sp - 1] = a[0];
-	memory[sp - 2] = pushed_status;
-	
-	sp -= 2;
+//Push psw
+void PushPsw(data *in)
+{
+	PushWord((a[0] << 8) + PackedStatus());
 
 	time += in -> duration;
 }
@@ -1781,10 +1175,8 @@ void PushPsw(data *in)
 void PopRp(data *in)
 {
 	uint16_t *destination_register_pair = (in -> register_pair);
-	
-	destination_register_pair[0] = (uint16_t)memory[sp];
-	
-	sp += 2;
+
+	destination_register_pair[0] = PopWord();
 
 	time += in -> duration;
 }
@@ -1792,16 +1184,10 @@ void PopRp(data *in)
 //Pop psw
 void PopPsw(data *in)
 {
-	uint8_t popped_status = memory[sp + 0];
-
-	status[0] = 	((popped_status & 0x80) >> 5) +
-			((popped_status & 0x40) >> 3) +
-			((popped_status & 0x10) >> 3) +
-			((popped_status & 0x04) << 2);
-
-	a[0] = memory[sp + 1];
+	uint16_t popped_value = PopWord();
 
-	sp += 2;
+	status[0] = UnpackedStatus(popped_value & 0xff);
+	a[0] = popped_value >> 8;
 
 	time += in -> duration;
 }
@@ -1809,13 +1195,10 @@ void PopPsw(data *in)
 //Exchange top two bytes on stack with register pair H
 void Xthl(data *in)
 {
-	uint8_t temporary_h_register = h[0],
-		temporary_l_register = l[0];
+	uint16_t temporary_register_pair = h_pair[0];
 
-	h_pair[0] = (uint16_t)memory[sp];
-	
-	memory[sp + 0] = temporary_l_register;
-	memory[sp + 1] = temporary_h_register;
+	h_pair[0] = ReadWord(sp);
+	WriteWord(sp, temporary_register_pair);
 
 	time += in -> duration;
 }
@@ -1886,49 +1269,49 @@ instruction instruction_set[INSTRUCTION_SET_SIZE] =
 		Lxi,	
 	/*02*/	Stax,
 		Inx,
-	/*04*/	InrRegister,
-		DcrRegister,
-	/*06*/	Mvi,
+	/*04*/	Inr_b,
+		Dcr_b,
+	/*06*/	Mvi_b,
 		Rlc,
 	/*08*/	Nop,
 		Dad,
 	/*0A*/	Ldax,
 		Dcx,
-	/*0C*/	InrRegister,
-		DcrRegister,
-	/*0E*/	Mvi,
+	/*0C*/	Inr_c,
+		Dcr_c,
+	/*0E*/	Mvi_c,
 		Rrc,
 	/*10*/	Nop,
 		Lxi,
 	/*12*/	Stax,
 		Inx,
-	/*14*/	InrRegister,
-		DcrRegister,
-	/*16*/	Mvi,
+	/*14*/	Inr_d,
+		Dcr_d,
+	/*16*/	Mvi_d,
 		Ral,
 	/*18*/	Nop,
 		Dad,
 	/*1A*/	Ldax,
 		Dcx,
-	/*1C*/	InrRegister,
-		DcrRegister,
-	/*1E*/	Mvi,
+	/*1C*/	Inr_e,
+		Dcr_e,
+	/*1E*/	Mvi_e,
 		Rar,
 	/*20*/	Nop,
 		Lxi,	
 	/*22*/	Shld,
 		Inx,
-	/*24*/	InrRegister,
-		DcrRegister,
-	/*26*/	Mvi,
+	/*24*/	Inr_h,
+		Dcr_h,
+	/*26*/	Mvi_h,
 		Daa,
 	/*28*/	Nop,
 		Dad,
 	/*2A*/	Lhld,
 		Dcx,
-	/*2C*/	InrRegister,
-		DcrRegister,
-	/*2E*/	Mvi,
+	/*2C*/	Inr_l,
+		Dcr_l,
+	/*2E*/	Mvi_l,
 		Cma,
 	/*30*/	Nop,
 		Lxi,	
@@ -1936,205 +1319,205 @@ instruction instruction_set[INSTRUCTION_SET_SIZE] =
 		Inx,
 	/*34*/	InrMemory,
 		DcrMemory,
-	/*36*/	Mvi,
+	/*36*/	MviMemory,
 		Stc,
 	/*38*/	Nop,
 		Dad,
 	/*3A*/	Lda,
 		Dcx,
-	/*3C*/	InrRegister,
-		DcrRegister,
-	/*3E*/	Mvi,
+	/*3C*/	Inr_a,
+		Dcr_a,
+	/*3E*/	Mvi_a,
 		Cmc,
-	/*40*/	MovRegister,
-		MovRegister,
-	/*42*/	MovRegister,
-		MovRegister,
-	/*44*/	MovRegister,
-		MovRegister,
-	/*46*/	MovFromMemory,
-		MovRegister,
-	/*48*/	MovRegister,
-		MovRegister,
-	/*4A*/	MovRegister,
-		MovRegister,
-	/*4C*/	MovRegister,
-		MovRegister,
-	/*4E*/	MovFromMemory,
-		MovRegister,
-	/*50*/	MovRegister,
-		MovRegister,
-	/*52*/	MovRegister,
-		MovRegister,
-	/*54*/	MovRegister,
-		MovRegister,
-	/*56*/	MovFromMemory,
-		MovRegister,
-	/*58*/	MovRegister,
-		MovRegister,
-	/*5A*/	MovRegister,
-		MovRegister,
-	/*5C*/	MovRegister,
-		MovRegister,
-	/*5E*/	MovFromMemory,
-		MovRegister,
-	/*60*/	MovRegister,
-		MovRegister,
-	/*62*/	MovRegister,
-		MovRegister,
-	/*64*/	MovRegister,
-		MovRegister,
-	/*66*/	MovFromMemory,
-		MovRegister,
-	/*68*/	MovRegister,
-		MovRegister,
-	/*6A*/	MovRegister,
-		MovRegister,
-	/*6C*/	MovRegister,
-		MovRegister,
-	/*6E*/	MovFromMemory,
-		MovRegister,
-	/*70*/	MovToMemory,
-		MovToMemory,
-	/*72*/	MovToMemory,
-		MovToMemory,
-	/*74*/	MovToMemory,
-		MovToMemory,
+	/*40*/	Mov_b_b,
+		Mov_b_c,
+	/*42*/	Mov_b_d,
+		Mov_b_e,
+	/*44*/	Mov_b_h,
+		Mov_b_l,
+	/*46*/	MovFromMemory_b,
+		Mov_b_a,
+	/*48*/	Mov_c_b,
+		Mov_c_c,
+	/*4A*/	Mov_c_d,
+		Mov_c_e,
+	/*4C*/	Mov_c_h,
+		Mov_c_l,
+	/*4E*/	MovFromMemory_c,
+		Mov_c_a,
+	/*50*/	Mov_d_b,
+		Mov_d_c,
+	/*52*/	Mov_d_d,
+		Mov_d_e,
+	/*54*/	Mov_d_h,
+		Mov_d_l,
+	/*56*/	MovFromMemory_d,
+		Mov_d_a,
+	/*58*/	Mov_e_b,
+		Mov_e_c,
+	/*5A*/	Mov_e_d,
+		Mov_e_e,
+	/*5C*/	Mov_e_h,
+		Mov_e_l,
+	/*5E*/	MovFromMemory_e,
+		Mov_e_a,
+	/*60*/	Mov_h_b,
+		Mov_h_c,
+	/*62*/	Mov_h_d,
+		Mov_h_e,
+	/*64*/	Mov_h_h,
+		Mov_h_l,
+	/*66*/	MovFromMemory_h,
+		Mov_h_a,
+	/*68*/	Mov_l_b,
+		Mov_l_c,
+	/*6A*/	Mov_l_d,
+		Mov_l_e,
+	/*6C*/	Mov_l_h,
+		Mov_l_l,
+	/*6E*/	MovFromMemory_l,
+		Mov_l_a,
+	/*70*/	MovToMemory_b,
+		MovToMemory_c,
+	/*72*/	MovToMemory_d,
+		MovToMemory_e,
+	/*74*/	MovToMemory_h,
+		MovToMemory_l,
 	/*76*/	Hlt,
-		MovRegister,
-	/*78*/	MovRegister,
-		MovRegister,
-	/*7A*/	MovRegister,
-		MovRegister,
-	/*7C*/	MovRegister,
-		MovRegister,
-	/*7E*/	MovFromMemory,
-		MovRegister,
-	/*80*/	AddRegister,
-		AddRegister,
-	/*82*/	AddRegister,
-		AddRegister,
-	/*84*/	AddRegister,
-		AddRegister,
+		MovToMemory_a,
+	/*78*/	Mov_a_b,
+		Mov_a_c,
+	/*7A*/	Mov_a_d,
+		Mov_a_e,
+	/*7C*/	Mov_a_h,
+		Mov_a_l,
+	/*7E*/	MovFromMemory_a,
+		Mov_a_a,
+	/*80*/	Add_b,
+		Add_c,
+	/*82*/	Add_d,
+		Add_e,
+	/*84*/	Add_h,
+		Add_l,
 	/*86*/	AddMemory,
-		AddRegister,
-	/*88*/	AdcRegister,
-		AdcRegister,
-	/*8A*/	AdcRegister,
-		AdcRegister,
-	/*8C*/	AdcRegister,
-		AdcRegister,
+		Add_a,
+	/*88*/	Adc_b,
+		Adc_c,
+	/*8A*/	Adc_d,
+		Adc_e,
+	/*8C*/	Adc_h,
+		Adc_l,
 	/*8E*/	AdcMemory,
-		AdcRegister,
-	/*90*/	SubRegister,
-		SubRegister,
-	/*92*/	SubRegister,
-		SubRegister,
-	/*94*/	SubRegister,
-		SubRegister,
+		Adc_a,
+	/*90*/	Sub_b,
+		Sub_c,
+	/*92*/	Sub_d,
+		Sub_e,
+	/*94*/	Sub_h,
+		Sub_l,
 	/*96*/	SubMemory,
-		SubRegister,
-	/*98*/	SbbRegister,
-		SbbRegister,
-	/*9A*/	SbbRegister,
-		SbbRegister,
-	/*9C*/	SbbRegister,
-		SbbRegister,
+		Sub_a,
+	/*98*/	Sbb_b,
+		Sbb_c,
+	/*9A*/	Sbb_d,
+		Sbb_e,
+	/*9C*/	Sbb_h,
+		Sbb_l,
 	/*9E*/	SbbMemory,
-		SbbRegister,
-	/*A0*/	AnaRegister,
-		AnaRegister,
-	/*A2*/	AnaRegister,
-		AnaRegister,
-	/*A4*/	AnaRegister,
-		AnaRegister,
+		Sbb_a,
+	/*A0*/	Ana_b,
+		Ana_c,
+	/*A2*/	Ana_d,
+		Ana_e,
+	/*A4*/	Ana_h,
+		Ana_l,
 	/*A6*/	AnaMemory,
-		AnaRegister,
-	/*A8*/	XraRegister,
-		XraRegister,
-	/*AA*/	XraRegister,
-		XraRegister,
-	/*AC*/	XraRegister,
-		XraRegister,
+		Ana_a,
+	/*A8*/	Xra_b,
+		Xra_c,
+	/*AA*/	Xra_d,
+		Xra_e,
+	/*AC*/	Xra_h,
+		Xra_l,
 	/*AE*/	XraMemory,
-		XraRegister,
-	/*B0*/	OraRegister,
-		OraRegister,
-	/*B2*/	OraRegister,
-		OraRegister,
-	/*B4*/	OraRegister,
-		OraRegister,
+		Xra_a,
+	/*B0*/	Ora_b,
+		Ora_c,
+	/*B2*/	Ora_d,
+		Ora_e,
+	/*B4*/	Ora_h,
+		Ora_l,
 	/*B6*/	OraMemory,
-		OraRegister,
-	/*B8*/	CmpRegister,
-		CmpRegister,
-	/*BA*/	CmpRegister,
-		CmpRegister,
-	/*BC*/	CmpRegister,
-		CmpRegister,
+		Ora_a,
+	/*B8*/	Cmp_b,
+		Cmp_c,
+	/*BA*/	Cmp_d,
+		Cmp_e,
+	/*BC*/	Cmp_h,
+		Cmp_l,
 	/*BE*/	CmpMemory,
-		CmpRegister,
-	/*C0*/	Rnz,
+		Cmp_a,
+	/*C0*/	ReturnConditional,
 		PopRp,
-	/*C2*/	Jnz,
+	/*C2*/	JumpConditional,
 		Jmp,
-	/*C4*/	Cnz,
+	/*C4*/	CallConditional,
 		PushRp,
 	/*C6*/	Adi,
 		Rst,
-	/*C8*/	Rz,
+	/*C8*/	ReturnConditional,
 		Ret,
-	/*CA*/	Jz,
+	/*CA*/	JumpConditional,
 		Nop,
-	/*CC*/	Cz,
+	/*CC*/	CallConditional,
 		Call,
 	/*CE*/	Aci,
 		Rst,
-	/*D0*/	Rnc,
+	/*D0*/	ReturnConditional,
 		PopRp,
-	/*D2*/	Jnc,
+	/*D2*/	JumpConditional,
 		Out,
-	/*D4*/	Cnc,
+	/*D4*/	CallConditional,
 		PushRp,
 	/*D6*/	Sui,
 		Rst,
-	/*D8*/	Rc,
+	/*D8*/	ReturnConditional,
 		Nop,
-	/*DA*/	Jc,
+	/*DA*/	JumpConditional,
 		In,
-	/*DC*/	Cc,
+	/*DC*/	CallConditional,
 		Nop,
 	/*DE*/	Sbi,
 		Rst,
-	/*E0*/	Rpo,
+	/*E0*/	ReturnConditional,
 		PopRp,
-	/*E2*/	Jpo,
+	/*E2*/	JumpConditional,
 		Xthl,
-	/*E4*/	Cpo,
+	/*E4*/	CallConditional,
 		PushRp,
 	/*E6*/	Ani,
 		Rst,
-	/*E8*/	Rpe,
+	/*E8*/	ReturnConditional,
 		Pchl,
-	/*EA*/	Jpe,
+	/*EA*/	JumpConditional,
 		Xchg,
-	/*EC*/	Cpe,
+	/*EC*/	CallConditional,
 		Nop,
 	/*EE*/	Xri,
 		Rst,
-	/*F0*/	Rp,
+	/*F0*/	ReturnConditional,
 		PopPsw,
-	/*F2*/	Jp,
+	/*F2*/	JumpConditional,
 		Di,
-	/*F4*/	Cp,
+	/*F4*/	CallConditional,
 		PushPsw,
 	/*F6*/	Ori,
 		Rst,
-	/*F8*/	Rm,
+	/*F8*/	ReturnConditional,
 		Sphl,
-	/*FA*/	Jm,
+	/*FA*/	JumpConditional,
 		Ei,
-	/*FC*/	Cm,
+	/*FC*/	CallConditional,
 		Nop,
 	/*FE*/	Cpi,
 		Rst
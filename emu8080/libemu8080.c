@@ -0,0 +1,550 @@
+/************************************************************************
+ * libemu8080								*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Library build of the emulator (see libemu8080.h). Each machine	*
+ * keeps its own registers, memory, disk and devices, and is switched	*
+ * into the emulator's globals when a call is made on it		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include "machine.h"
+#include "instruction_set.h"
+#include "storage.h"
+#include "vt100.h"
+#include "cpm.h"
+#include "coverage.h"
+#include "profile.h"
+#include "trace.h"
+#include "sampler.h"
+#include "shared.h"
+#include "snapshot.h"
+#include "compress.h"
+#include "checkpoint.h"
+#include "stats.h"
+#include "lockstep.h"
+#include "program.h"
+#include "batch.h"
+#include "video.h"
+#include "ui.h"
+#include "core.h"
+#include "libemu8080.h"
+
+#define IN_OPCODE		0xdb
+#define OUT_OPCODE		0xd3
+#define CALL_OPCODE		0xcd
+
+typedef struct port_device_entry
+{
+	emu8080_port_read read;
+	emu8080_port_write write;
+	void *context;
+} port_device;
+
+typedef struct native_device_entry
+{
+	emu8080_native routine;
+	void *context;
+} native_device;
+
+struct emu8080_machine
+{
+	//processor
+	uint8_t register_file[10];
+	uint16_t pc;
+	uint16_t sp;
+	uint8_t instruction_register;
+	uint32_t time;
+	uint16_t control;
+	uint8_t interrupt_enable;
+	uint8_t halt_enable;
+	uint8_t interrupt_request;
+	interrupt_device interrupt_vector;
+
+	//devices
+	uint32_t storage_op_completion_time;
+	io_state storage_state;
+	uint32_t kb_op_completion_time;
+	io_state kb_state;
+	uint8_t storage_attached;
+	uint8_t keyboard_attached;
+	emu8080_key_source key_source;
+	void *key_context;
+	port_device ports[PORTS];
+	native_device *natives;		//by guest address, allocated when the first routine is registered
+
+	//CP/M
+	uint8_t cpm_mode;
+	uint8_t cpm_current_disk;
+	uint16_t cpm_dma;
+
+	uint8_t *address_space;
+	uint8_t *hard_disk;
+	uint8_t *io;
+};
+
+//Machine whose state is in the globals
+emu8080 *current_machine = NULL;
+
+void SaveGlobals(emu8080 *machine)
+{
+	memcpy(machine -> register_file, register_file, sizeof(register_file));
+	machine -> pc = pc;
+	machine -> sp = sp;
+	machine -> instruction_register = instruction_register;
+	machine -> time = time;
+	machine -> control = control;
+	machine -> interrupt_enable = interrupt_enable;
+	machine -> halt_enable = halt_enable;
+	machine -> interrupt_request = interrupt_request;
+	machine -> interrupt_vector = interrupt_vector;
+
+	machine -> storage_op_completion_time = storage_op_completion_time;
+	machine -> storage_state = storage_state;
+	machine -> kb_op_completion_time = kb_op_completion_time;
+	machine -> kb_state = kb_state;
+	machine -> storage_attached = storage_attached;
+	machine -> keyboard_attached = keyboard_attached;
+
+	machine -> cpm_mode = cpm_mode;
+	machine -> cpm_current_disk = cpm_current_disk;
+	machine -> cpm_dma = cpm_dma;
+}
+
+void LoadGlobals(emu8080 *machine)
+{
+	memcpy(register_file, machine -> register_file, sizeof(register_file));
+	pc = machine -> pc;
+	sp = machine -> sp;
+	instruction_register = machine -> instruction_register;
+	time = machine -> time;
+	control = machine -> control;
+	interrupt_enable = machine -> interrupt_enable;
+	halt_enable = machine -> halt_enable;
+	interrupt_request = machine -> interrupt_request;
+	interrupt_vector = machine -> interrupt_vector;
+
+	storage_op_completion_time = machine -> storage_op_completion_time;
+	storage_state = machine -> storage_state;
+	kb_op_completion_time = machine -> kb_op_completion_time;
+	kb_state = machine -> kb_state;
+	storage_attached = machine -> storage_attached;
+	keyboard_attached = machine -> keyboard_attached;
+
+	cpm_mode = machine -> cpm_mode;
+	cpm_current_disk = machine -> cpm_current_disk;
+	cpm_dma = machine -> cpm_dma;
+
+	address_space = machine -> address_space;
+	memory = address_space + MEMORY_START_ADDRESS;
+	video_memory = address_space + VIDEO_MEM_START_ADDRESS;
+	hard_disk = machine -> hard_disk;
+	io = machine -> io;
+}
+
+void SwitchToMachine(emu8080 *machine)
+{
+	if(current_machine == machine)
+	{
+		return;
+	}
+
+	if(current_machine != NULL)
+	{
+		SaveGlobals(current_machine);
+	}
+
+	LoadGlobals(machine);
+	current_machine = machine;
+}
+
+//Keyboard source for the keyboard controller, asking the current machine's attached keyboard
+int LibraryKeySource()
+{
+	int key = current_machine -> key_source(current_machine -> key_context);
+
+	return (key < 0) ? ERR : key;
+}
+
+//Input from an attached port device, or the port latch if there is none
+void LibraryIn(data *in)
+{
+	uint8_t port = memory[pc + 0];
+	port_device *device = current_machine -> ports + port;
+	pc += 1;
+
+	a[0] = (device -> read != NULL) ? device -> read(device -> context, port) : io[port];
+
+	time += in -> duration;
+}
+
+//Output to an attached port device as well as the port latch
+void LibraryOut(data *in)
+{
+	uint8_t port = memory[pc + 0];
+	port_device *device = current_machine -> ports + port;
+	pc += 1;
+
+	io[port] = a[0];
+
+	if(device -> write != NULL)
+	{
+		device -> write(device -> context, port, a[0]);
+	}
+
+	time += in -> duration;
+}
+
+//CALL that runs the current machine's native routine at its target instead of the guest subroutine
+void LibraryCall(data *in)
+{
+	native_device *native = (current_machine -> natives != NULL) ? current_machine -> natives + ReadWord(pc) : NULL;
+	uint16_t return_address = pc + 2;
+
+	if(native == NULL || native -> routine == NULL)
+	{
+		Call(in);
+		return;
+	}
+
+	//the return address is left below sp, as the guest CALL and RET would leave it
+	WriteWord(sp - 2, return_address);
+	pc = return_address;
+
+	time += in -> duration + native -> routine(current_machine, native -> context);
+}
+
+int Emu8080ApiVersion()
+{
+	return EMU8080_API_VERSION;
+}
+
+emu8080 *Emu8080Create()
+{
+	emu8080 *machine = calloc(1, sizeof(emu8080));
+
+	if(machine == NULL)
+	{
+		return NULL;
+	}
+
+	machine -> address_space = calloc(ADDRESSED_SPACE_SIZE, sizeof(uint8_t));
+	machine -> hard_disk = calloc(HARD_DISK_SIZE, sizeof(uint8_t));
+	machine -> io = calloc(PORTS, sizeof(uint8_t));
+
+	if(machine -> address_space == NULL || machine -> hard_disk == NULL || machine -> io == NULL)
+	{
+		Emu8080Destroy(machine);
+		return NULL;
+	}
+
+	machine -> interrupt_vector = NO_INTERRUPT;
+	machine -> storage_op_completion_time = INT_MAX;
+	machine -> storage_state = READY;
+	machine -> kb_op_completion_time = INT_MAX;
+	machine -> kb_state = READY;
+	machine -> cpm_dma = CPM_DEFAULT_DMA;
+
+	//embedded machines have no terminal monitor, and port devices are looked up per machine
+	monitor_enabled = 0;
+	keyboard_source = LibraryKeySource;
+	instruction_set[IN_OPCODE] = LibraryIn;
+	instruction_set[OUT_OPCODE] = LibraryOut;
+
+	return machine;
+}
+
+void Emu8080Destroy(emu8080 *machine)
+{
+	if(machine == NULL)
+	{
+		return;
+	}
+
+	if(current_machine == machine)
+	{
+		current_machine = NULL;
+	}
+
+	free(machine -> address_space);
+	free(machine -> hard_disk);
+	free(machine -> io);
+	free(machine -> natives);
+	free(machine);
+}
+
+int Emu8080Load(emu8080 *machine, uint16_t address, const uint8_t *bytes, uint32_t length)
+{
+	if(address + length > ADDRESSED_SPACE_SIZE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	SwitchToMachine(machine);
+	memcpy(address_space + address, bytes, length);
+	MarkStoreRange(address, length);
+
+	return EXIT_SUCCESS;
+}
+
+int Emu8080LoadCom(emu8080 *machine, const char *filename, int argc, char *argv[])
+{
+	SwitchToMachine(machine);
+
+	return LoadComProgram((char *)filename, argc, argv);
+}
+
+emu8080_result Emu8080Run(emu8080 *machine, uint32_t cycles)
+{
+	uint32_t start;
+
+	SwitchToMachine(machine);
+	start = time;
+
+	while(!halt_enable && time - start < cycles)
+	{
+		ExecuteInstruction();
+	}
+
+	return halt_enable ? EMU8080_HALTED : EMU8080_RUNNING;
+}
+
+emu8080_result Emu8080Step(emu8080 *machine)
+{
+	SwitchToMachine(machine);
+
+	if(!halt_enable)
+	{
+		ExecuteInstruction();
+	}
+
+	return halt_enable ? EMU8080_HALTED : EMU8080_RUNNING;
+}
+
+uint32_t Emu8080Cycles(emu8080 *machine)
+{
+	SwitchToMachine(machine);
+
+	return time;
+}
+
+uint16_t Emu8080GetRegister(emu8080 *machine, emu8080_register name)
+{
+	SwitchToMachine(machine);
+
+	switch(name)
+	{
+	case EMU8080_B:		return b[0];
+	case EMU8080_C:		return c[0];
+	case EMU8080_D:		return d[0];
+	case EMU8080_E:		return e[0];
+	case EMU8080_H:		return h[0];
+	case EMU8080_L:		return l[0];
+	case EMU8080_A:		return a[0];
+	case EMU8080_FLAGS:	return status[0];
+	case EMU8080_PC:	return pc;
+	case EMU8080_SP:	return sp;
+	default:		return 0;
+	};
+}
+
+void Emu8080SetRegister(emu8080 *machine, emu8080_register name, uint16_t value)
+{
+	SwitchToMachine(machine);
+
+	switch(name)
+	{
+	case EMU8080_B:		b[0] = value;		break;
+	case EMU8080_C:		c[0] = value;		break;
+	case EMU8080_D:		d[0] = value;		break;
+	case EMU8080_E:		e[0] = value;		break;
+	case EMU8080_H:		h[0] = value;		break;
+	case EMU8080_L:		l[0] = value;		break;
+	case EMU8080_A:		a[0] = value;		break;
+	case EMU8080_FLAGS:	status[0] = value;	break;
+	case EMU8080_PC:	pc = value;		break;
+	case EMU8080_SP:	sp = value;		break;
+	default:					break;
+	};
+}
+
+int Emu8080ReadMemory(emu8080 *machine, uint16_t address, uint8_t *buffer, uint32_t length)
+{
+	if(address + length > ADDRESSED_SPACE_SIZE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	SwitchToMachine(machine);
+	memcpy(buffer, address_space + address, length);
+
+	return EXIT_SUCCESS;
+}
+
+int Emu8080WriteMemory(emu8080 *machine, uint16_t address, const uint8_t *buffer, uint32_t length)
+{
+	return Emu8080Load(machine, address, buffer, length);
+}
+
+int Emu8080SaveSnapshot(emu8080 *machine, const char *filename)
+{
+	snapshot *save = calloc(1, sizeof(snapshot));
+	int result;
+
+	if(save == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	SwitchToMachine(machine);
+	SaveMachineState(save);
+	result = WriteSnapshotFile((char *)filename, save, NULL, NULL);
+
+	free(save);
+
+	return result;
+}
+
+int Emu8080RestoreSnapshot(emu8080 *machine, const char *filename)
+{
+	snapshot *save = malloc(sizeof(snapshot));
+	int result = EXIT_FAILURE;
+
+	SwitchToMachine(machine);
+
+	if(save != NULL && (result = ReadSnapshotFile((char *)filename, save)) == EXIT_SUCCESS)
+	{
+		RestoreMachineState(save);
+	}
+
+	free(save);
+
+	return result;
+}
+
+//Loads disk (zero-filled past length) and starts polling the storage controller
+int Emu8080AttachStorage(emu8080 *machine, const uint8_t *disk, uint32_t length)
+{
+	if(length > HARD_DISK_SIZE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	SwitchToMachine(machine);
+
+	memset(hard_disk, 0, HARD_DISK_SIZE);
+	memcpy(hard_disk, disk, length);
+
+	storage_attached = 1;
+	storage_state = READY;
+	storage_op_completion_time = INT_MAX;
+	memory[NV_MEM_CTRL_REG] = RDY;
+
+	return EXIT_SUCCESS;
+}
+
+int Emu8080ReadStorage(emu8080 *machine, uint8_t *disk, uint32_t length)
+{
+	if(length > HARD_DISK_SIZE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	SwitchToMachine(machine);
+	memcpy(disk, hard_disk, length);
+
+	return EXIT_SUCCESS;
+}
+
+void Emu8080DetachStorage(emu8080 *machine)
+{
+	SwitchToMachine(machine);
+
+	storage_attached = 0;
+	memory[NV_MEM_CTRL_REG] &= ~RDY;
+}
+
+void Emu8080AttachKeyboard(emu8080 *machine, emu8080_key_source source, void *context)
+{
+	SwitchToMachine(machine);
+
+	machine -> key_source = source;
+	machine -> key_context = context;
+
+	keyboard_attached = (source != NULL);
+	kb_state = READY;
+	kb_op_completion_time = INT_MAX;
+	memory[KB_CTRL_REG] |= RDY;
+}
+
+void Emu8080DetachKeyboard(emu8080 *machine)
+{
+	SwitchToMachine(machine);
+
+	keyboard_attached = 0;
+	memory[KB_CTRL_REG] &= ~RDY;
+}
+
+int Emu8080AttachPorts(emu8080 *machine, uint8_t first_port, uint16_t count,
+			emu8080_port_read read, emu8080_port_write write, void *context)
+{
+	uint16_t port;
+
+	if(first_port + count > PORTS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	for(port = first_port; port < first_port + count; port++)
+	{
+		machine -> ports[port].read = read;
+		machine -> ports[port].write = write;
+		machine -> ports[port].context = context;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+void Emu8080DetachPorts(emu8080 *machine, uint8_t first_port, uint16_t count)
+{
+	Emu8080AttachPorts(machine, first_port, (first_port + count > PORTS) ? PORTS - first_port : count, NULL, NULL, NULL);
+}
+
+int Emu8080RegisterNative(emu8080 *machine, uint16_t address, emu8080_native routine, void *context)
+{
+	if(routine == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	if(machine -> natives == NULL && (machine -> natives = calloc(ADDRESSED_SPACE_SIZE, sizeof(native_device))) == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	machine -> natives[address].routine = routine;
+	machine -> natives[address].context = context;
+
+	//machines without native routines keep the plain Call until one is registered
+	instruction_set[CALL_OPCODE] = LibraryCall;
+
+	return EXIT_SUCCESS;
+}
+
+void Emu8080UnregisterNative(emu8080 *machine, uint16_t address)
+{
+	if(machine -> natives != NULL)
+	{
+		machine -> natives[address].routine = NULL;
+		machine -> natives[address].context = NULL;
+	}
+}
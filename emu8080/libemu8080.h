@@ -0,0 +1,101 @@
+/************************************************************************
+ * libemu8080								*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * C interface for embedding the 8080 emulator. Only this header is	*
+ * installed; the machine layout stays private to the library.		*
+ * Machines share the emulator's global state, which is switched to	*
+ * whichever machine a call is made on, so calls must not be made	*
+ * from more than one thread at a time.				*
+ ************************************************************************/
+
+#ifndef LIBEMU8080_H
+#define LIBEMU8080_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMU8080_API_VERSION	2
+
+#define EMU8080_API		__attribute__ ((visibility ("default")))
+
+typedef struct emu8080_machine emu8080;
+
+typedef enum emu8080_register_name
+{
+	EMU8080_B,
+	EMU8080_C,
+	EMU8080_D,
+	EMU8080_E,
+	EMU8080_H,
+	EMU8080_L,
+	EMU8080_A,
+	EMU8080_FLAGS,		//Carry | Aux Carry | Sign | Zero | Even Parity in bits 0 to 4
+	EMU8080_PC,
+	EMU8080_SP
+} emu8080_register;
+
+typedef enum emu8080_run_result
+{
+	EMU8080_RUNNING,	//the cycle budget ran out
+	EMU8080_HALTED,		//the program executed HLT
+	EMU8080_ERROR		//bad argument
+} emu8080_result;
+
+//Devices
+typedef int (*emu8080_key_source)(void *context);		//next key, or -1 if none is available
+typedef uint8_t (*emu8080_port_read)(void *context, uint8_t port);
+typedef void (*emu8080_port_write)(void *context, uint8_t port, uint8_t value);
+
+/*
+ * Native routines run in place of a guest subroutine when a CALL reaches its
+ * address. One does the subroutine's work (including its RET) through the
+ * State calls, leaving registers, flags and memory as the guest code would,
+ * and returns the clock cycles the guest code would have taken.
+ */
+typedef uint32_t (*emu8080_native)(emu8080 *machine, void *context);
+
+//Lifetime
+EMU8080_API int Emu8080ApiVersion(void);
+EMU8080_API emu8080 *Emu8080Create(void);
+EMU8080_API void Emu8080Destroy(emu8080 *machine);
+
+//Programs
+EMU8080_API int Emu8080Load(emu8080 *machine, uint16_t address, const uint8_t *bytes, uint32_t length);
+EMU8080_API int Emu8080LoadCom(emu8080 *machine, const char *filename, int argc, char *argv[]);
+
+//Execution
+EMU8080_API emu8080_result Emu8080Run(emu8080 *machine, uint32_t cycles);
+EMU8080_API emu8080_result Emu8080Step(emu8080 *machine);
+EMU8080_API uint32_t Emu8080Cycles(emu8080 *machine);
+
+//State
+EMU8080_API uint16_t Emu8080GetRegister(emu8080 *machine, emu8080_register name);
+EMU8080_API void Emu8080SetRegister(emu8080 *machine, emu8080_register name, uint16_t value);
+EMU8080_API int Emu8080ReadMemory(emu8080 *machine, uint16_t address, uint8_t *buffer, uint32_t length);
+EMU8080_API int Emu8080WriteMemory(emu8080 *machine, uint16_t address, const uint8_t *buffer, uint32_t length);
+EMU8080_API int Emu8080SaveSnapshot(emu8080 *machine, const char *filename);
+EMU8080_API int Emu8080RestoreSnapshot(emu8080 *machine, const char *filename);
+
+//Devices
+EMU8080_API int Emu8080AttachStorage(emu8080 *machine, const uint8_t *disk, uint32_t length);
+EMU8080_API int Emu8080ReadStorage(emu8080 *machine, uint8_t *disk, uint32_t length);
+EMU8080_API void Emu8080DetachStorage(emu8080 *machine);
+EMU8080_API void Emu8080AttachKeyboard(emu8080 *machine, emu8080_key_source source, void *context);
+EMU8080_API void Emu8080DetachKeyboard(emu8080 *machine);
+EMU8080_API int Emu8080AttachPorts(emu8080 *machine, uint8_t first_port, uint16_t count,
+				emu8080_port_read read, emu8080_port_write write, void *context);
+EMU8080_API void Emu8080DetachPorts(emu8080 *machine, uint8_t first_port, uint16_t count);
+
+//Native routines
+EMU8080_API int Emu8080RegisterNative(emu8080 *machine, uint16_t address, emu8080_native routine, void *context);
+EMU8080_API void Emu8080UnregisterNative(emu8080 *machine, uint16_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
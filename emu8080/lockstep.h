@@ -0,0 +1,523 @@
+/************************************************************************
+ * 8080 Emulator Lockstep Checker					*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Runs the loaded program on two engines, each in its own process,	*
+ * compares their states as they go and, at the first difference,	*
+ * replays both to print the instructions that led up to it		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define LOCKSTEP_RING_STATES		(1 << 16)	//power of 2
+#define LOCKSTEP_CACHE_LINE		64
+#define LOCKSTEP_HASH_INSTRUCTIONS	65536		//memory is hashed at the first state after this many instructions
+#define LOCKSTEP_MEMORY_DIFFERENCES	16		//differing bytes listed after a divergence
+#define LOCKSTEP_REGISTERS		8		//register_file up to and including STATUS
+
+typedef enum lockstep_engine_type
+{
+	LOCKSTEP_INTERPRETER,
+	LOCKSTEP_BLOCKS,
+	LOCKSTEP_RECOMPILED
+} lockstep_engine;
+
+const char *const lockstep_engine_names[3] = {"interpreter", "blocks", "recompiled"};
+
+//Architectural state after an instruction
+typedef struct lockstep_state_entry
+{
+	uint64_t instructions;				//executed so far
+	uint64_t memory_hash;				//0 if memory wasn't hashed at this state
+	uint32_t cycle;
+	uint16_t pc;
+	uint16_t sp;
+	uint8_t registers[LOCKSTEP_REGISTERS];
+	uint8_t interrupt_enable;
+	uint8_t halted;					//the engine's last state
+} lockstep_state;
+
+//One ring per engine, each written by that engine and read by the comparing process
+typedef struct lockstep_ring_header
+{
+	uint64_t head __attribute__ ((aligned (LOCKSTEP_CACHE_LINE)));
+	uint64_t tail __attribute__ ((aligned (LOCKSTEP_CACHE_LINE)));
+	uint32_t finished;
+	lockstep_state states[LOCKSTEP_RING_STATES] __attribute__ ((aligned (LOCKSTEP_CACHE_LINE)));
+} lockstep_ring;
+
+uint8_t lockstep_enabled = 0;
+lockstep_engine lockstep_engines[2];
+uint32_t lockstep_every = 0,			//0 to compare after every taken jump, call, return or interrupt
+	 lockstep_window = 32;			//instructions printed before a divergence
+
+lockstep_ring *lockstep_rings = NULL,		//both engines' rings
+	      *lockstep_ring_own = NULL;	//this engine's
+uint8_t *lockstep_memories = NULL;		//both engines' memory at the end of a replay
+uint8_t lockstep_side = 0;			//which of the two engines this process runs
+uint64_t lockstep_instructions = 0,
+	 lockstep_next = 0,			//instruction count of the next state with -lockstep-every
+	 lockstep_next_hash = LOCKSTEP_HASH_INSTRUCTIONS,
+	 lockstep_limit = 0;			//head may reach this before tail is read again
+volatile sig_atomic_t lockstep_interrupted = 0;
+
+//Replays run without rings, printing instructions after replay_start and stopping at replay_end
+uint8_t lockstep_replaying = 0;
+uint64_t lockstep_replay_start = 0,
+	 lockstep_replay_end = 0;
+FILE *lockstep_output = NULL;			//the replay's instructions (the program's own output is dropped)
+trace_record lockstep_last_record;
+uint8_t lockstep_previous[LOCKSTEP_REGISTERS];
+
+uint64_t LockstepMemoryHash()
+{
+	const uint64_t *words = (const uint64_t *)address_space;
+	uint64_t hash = 14695981039346656037ull;
+	uint32_t i;
+
+	for(i = 0; i < ADDRESSED_SPACE_SIZE / sizeof(uint64_t); i++)
+	{
+		hash = (hash ^ words[i]) * 1099511628211ull;
+	}
+
+	return hash ? hash : 1;
+}
+
+void RecordLockstep()
+{
+	uint64_t head = lockstep_ring_own -> head;
+	lockstep_state *state;
+
+	//a full ring waits for the comparing process
+	while(head == lockstep_limit)
+	{
+		lockstep_limit = __atomic_load_n(&(lockstep_ring_own -> tail), __ATOMIC_ACQUIRE) + LOCKSTEP_RING_STATES;
+	}
+
+	state = &(lockstep_ring_own -> states[head & (LOCKSTEP_RING_STATES - 1)]);
+	state -> instructions = lockstep_instructions;
+	state -> memory_hash = 0;
+	state -> cycle = time;
+	state -> pc = pc;
+	state -> sp = sp;
+	memcpy(state -> registers, register_file, LOCKSTEP_REGISTERS);
+	state -> interrupt_enable = interrupt_enable;
+	state -> halted = halt_enable;
+
+	if(lockstep_instructions >= lockstep_next_hash || halt_enable)
+	{
+		state -> memory_hash = LockstepMemoryHash();
+		lockstep_next_hash = lockstep_instructions + LOCKSTEP_HASH_INSTRUCTIONS;
+	}
+
+	lockstep_next += lockstep_every;
+
+	__atomic_store_n(&(lockstep_ring_own -> head), head + 1, __ATOMIC_RELEASE);
+}
+
+//Ends a replay, leaving this engine's memory for the comparing process
+void FinishLockstepReplay()
+{
+	memcpy(lockstep_memories + lockstep_side * ADDRESSED_SPACE_SIZE, address_space, ADDRESSED_SPACE_SIZE);
+	fflush(lockstep_output);
+	_exit(EXIT_SUCCESS);
+}
+
+void ReplayLockstep(uint16_t address)
+{
+	trace_record record;
+	uint8_t i;
+
+	if(lockstep_instructions > lockstep_replay_start)
+	{
+		record.cycle = time;
+		record.pc = address;
+		record.sp = sp;
+		record.opcode = instruction_register;
+		record.operands[0] = memory[(uint16_t)(address + 1)];
+		record.operands[1] = memory[(uint16_t)(address + 2)];
+		record.changed = 0;
+
+		for(i = 0; i < LOCKSTEP_REGISTERS; i++)
+		{
+			record.changed |= (register_file[i] != lockstep_previous[i]) << i;
+		}
+
+		memcpy(record.registers, register_file, LOCKSTEP_REGISTERS);
+		PrintTraceRecord(lockstep_output, &record, lockstep_instructions - 1 > lockstep_replay_start ? &lockstep_last_record : NULL);
+		lockstep_last_record = record;
+	}
+
+	memcpy(lockstep_previous, register_file, LOCKSTEP_REGISTERS);
+
+	if(lockstep_instructions == lockstep_replay_end)
+	{
+		FinishLockstepReplay();
+	}
+}
+
+//Called after every instruction; states are taken at the same instructions on both engines
+static inline void LockstepCheck(uint16_t address)
+{
+	lockstep_instructions++;
+
+	if(lockstep_replaying)
+	{
+		ReplayLockstep(address);
+	}
+	else if(lockstep_every ? lockstep_instructions == lockstep_next
+		: pc != (uint16_t)(address + instruction_set_data[instruction_register].size))
+	{
+		RecordLockstep();
+	}
+}
+
+//Index of the named engine in lockstep_engine_names, or -1
+int FindLockstepEngine(char *name)
+{
+	int engine;
+
+	for(engine = 0; engine < 3; engine++)
+	{
+		if(strcmp(name, lockstep_engine_names[engine]) == 0)
+		{
+			return engine;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Parses the engines to compare: <engine>:<engine>,
+ * each one of interpreter, blocks or recompiled
+ */
+int ParseLockstepOption(char *option)
+{
+	char first[16], second[16];
+	int first_engine, second_engine;
+
+	if(sscanf(option, "%15[a-z]:%15[a-z]", first, second) != 2
+	|| (first_engine = FindLockstepEngine(first)) < 0 || (second_engine = FindLockstepEngine(second)) < 0)
+	{
+		printf("Lockstep engines are given as <engine>:<engine> (interpreter, blocks or recompiled).\n");
+		return EXIT_FAILURE;
+	}
+
+	lockstep_engines[0] = first_engine;
+	lockstep_engines[1] = second_engine;
+	lockstep_enabled = 1;
+
+	return EXIT_SUCCESS;
+}
+
+uint8_t LockstepUses(lockstep_engine engine)
+{
+	return lockstep_enabled && (lockstep_engines[0] == engine || lockstep_engines[1] == engine);
+}
+
+void InterruptLockstep(int signal_number)
+{
+	(void)signal_number;
+
+	lockstep_interrupted = 1;
+}
+
+//Starts an engine's process from the machine as loaded; returns 0 in the engine's process
+pid_t ForkLockstepEngine(uint8_t side)
+{
+	pid_t pid = fork();
+
+	if(pid == 0)
+	{
+		//the comparing process decides when the engines stop
+		signal(SIGINT, SIG_IGN);
+		signal(SIGTERM, SIG_IGN);
+
+		lockstep_side = side;
+		lockstep_ring_own = lockstep_rings + side;
+		lockstep_limit = LOCKSTEP_RING_STATES;
+		lockstep_next = lockstep_every;
+	}
+
+	return pid;
+}
+
+void PrintLockstepStates(lockstep_state *first, lockstep_state *second)
+{
+	const char *const names[LOCKSTEP_REGISTERS] = {"C", "B", "E", "D", "L", "H", "A", "F"};
+	uint8_t i;
+
+	printf("%-13s %16s %16s\n", "", lockstep_engine_names[lockstep_engines[0]], lockstep_engine_names[lockstep_engines[1]]);
+	printf("%-13s %16llu %16llu%s\n", "instructions", (unsigned long long)first -> instructions,
+		(unsigned long long)second -> instructions, first -> instructions != second -> instructions ? "  *" : "");
+	printf("%-13s %16lu %16lu%s\n", "cycle", (unsigned long)first -> cycle, (unsigned long)second -> cycle,
+		first -> cycle != second -> cycle ? "  *" : "");
+	printf("%-13s %16.4x %16.4x%s\n", "pc", first -> pc, second -> pc, first -> pc != second -> pc ? "  *" : "");
+	printf("%-13s %16.4x %16.4x%s\n", "sp", first -> sp, second -> sp, first -> sp != second -> sp ? "  *" : "");
+
+	for(i = 0; i < LOCKSTEP_REGISTERS; i++)
+	{
+		printf("%-13s %16.2x %16.2x%s\n", names[i], first -> registers[i], second -> registers[i],
+			first -> registers[i] != second -> registers[i] ? "  *" : "");
+	}
+
+	printf("%-13s %16u %16u%s\n", "interrupts", first -> interrupt_enable, second -> interrupt_enable,
+		first -> interrupt_enable != second -> interrupt_enable ? "  *" : "");
+	printf("%-13s %16u %16u%s\n", "halted", first -> halted, second -> halted, first -> halted != second -> halted ? "  *" : "");
+
+	if(first -> memory_hash && second -> memory_hash)
+	{
+		printf("%-13s %16.16llx %16.16llx%s\n", "memory hash", (unsigned long long)first -> memory_hash,
+			(unsigned long long)second -> memory_hash, first -> memory_hash != second -> memory_hash ? "  *" : "");
+	}
+}
+
+static inline uint8_t LockstepStatesDiffer(lockstep_state *first, lockstep_state *second)
+{
+	return first -> instructions != second -> instructions || first -> cycle != second -> cycle
+		|| first -> pc != second -> pc || first -> sp != second -> sp
+		|| memcmp(first -> registers, second -> registers, LOCKSTEP_REGISTERS) != 0
+		|| first -> interrupt_enable != second -> interrupt_enable || first -> halted != second -> halted
+		|| (first -> memory_hash && second -> memory_hash && first -> memory_hash != second -> memory_hash);
+}
+
+/*
+ * Replays both engines from the start to the earlier of the two states that
+ * differ, printing each one's last lockstep_window instructions, then lists
+ * the bytes of memory that differ there
+ */
+void ReplayLockstepDivergence(uint64_t end)
+{
+	uint8_t side;
+	uint32_t address, differences = 0;
+	pid_t pid;
+
+	lockstep_memories = mmap(NULL, 2 * ADDRESSED_SPACE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if(lockstep_memories == MAP_FAILED)
+	{
+		printf("Couldn't replay the engines.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for(side = 0; side < 2; side++)
+	{
+		printf("\nLast instructions of %s up to instruction %llu:\n", lockstep_engine_names[lockstep_engines[side]], (unsigned long long)end);
+		fflush(stdout);
+
+		if((pid = ForkLockstepEngine(side)) == 0)
+		{
+			if((lockstep_output = fdopen(dup(STDOUT_FILENO), "w")) == NULL || freopen("/dev/null", "w", stdout) == NULL)
+			{
+				_exit(EXIT_FAILURE);
+			}
+
+			lockstep_replaying = 1;
+			lockstep_replay_end = end;
+			lockstep_replay_start = end > lockstep_window ? end - lockstep_window : 0;
+			memcpy(lockstep_previous, register_file, LOCKSTEP_REGISTERS);
+
+			return;
+		}
+
+		waitpid(pid, NULL, 0);
+	}
+
+	printf("\n");
+
+	for(address = 0; address < ADDRESSED_SPACE_SIZE; address++)
+	{
+		if(lockstep_memories[address] != lockstep_memories[ADDRESSED_SPACE_SIZE + address]
+		&& differences++ < LOCKSTEP_MEMORY_DIFFERENCES)
+		{
+			printf("memory[%04x] %16.2x %16.2x\n", address, lockstep_memories[address], lockstep_memories[ADDRESSED_SPACE_SIZE + address]);
+		}
+	}
+
+	printf("%lu bytes of memory differ at instruction %llu\n", (unsigned long)differences, (unsigned long long)end);
+
+	munmap(lockstep_memories, 2 * ADDRESSED_SPACE_SIZE);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * Compares the states from both rings as they arrive. Returns the index of the
+ * first pair that differs, or the number compared if both engines halted
+ * together or the run was interrupted.
+ */
+uint64_t CompareLockstep(pid_t *pids, uint8_t *diverged)
+{
+	uint64_t compared = 0, heads[2], end;
+	uint8_t side;
+
+	*diverged = 0;
+
+	while(!lockstep_interrupted)
+	{
+		heads[0] = __atomic_load_n(&(lockstep_rings[0].head), __ATOMIC_ACQUIRE);
+		heads[1] = __atomic_load_n(&(lockstep_rings[1].head), __ATOMIC_ACQUIRE);
+		end = heads[0] < heads[1] ? heads[0] : heads[1];
+
+		if(compared == end)
+		{
+			//heads were read after both engines were reaped, so there is nothing left to compare
+			if(pids[0] == 0 && pids[1] == 0)
+			{
+				return compared;
+			}
+
+			for(side = 0; side < 2; side++)
+			{
+				//an engine that exits without saying it finished has crashed
+				if(pids[side] > 0 && waitpid(pids[side], NULL, WNOHANG) == pids[side])
+				{
+					pids[side] = 0;
+
+					if(!__atomic_load_n(&(lockstep_rings[side].finished), __ATOMIC_ACQUIRE))
+					{
+						printf("The %s engine died after %llu states.\n", lockstep_engine_names[lockstep_engines[side]], (unsigned long long)compared);
+						*diverged = 1;
+						return compared;
+					}
+				}
+			}
+
+			usleep(100);
+			continue;
+		}
+
+		for(; compared < end; compared++)
+		{
+			if(LockstepStatesDiffer(&(lockstep_rings[0].states[compared & (LOCKSTEP_RING_STATES - 1)]),
+						&(lockstep_rings[1].states[compared & (LOCKSTEP_RING_STATES - 1)])))
+			{
+				*diverged = 1;
+				return compared;
+			}
+		}
+
+		__atomic_store_n(&(lockstep_rings[0].tail), compared, __ATOMIC_RELEASE);
+		__atomic_store_n(&(lockstep_rings[1].tail), compared, __ATOMIC_RELEASE);
+	}
+
+	return compared;
+}
+
+/*
+ * Forks a process for each engine; only those processes return, with the
+ * engine to run. The parent compares them and exits with EXIT_FAILURE if
+ * they diverge.
+ */
+lockstep_engine StartLockstep()
+{
+	struct timeval start, end;
+	lockstep_state *first, *second;
+	uint64_t compared, instructions = 0;
+	uint8_t side, diverged;
+	pid_t pids[2];
+
+	lockstep_rings = mmap(NULL, 2 * sizeof(lockstep_ring), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if(lockstep_rings == MAP_FAILED)
+	{
+		printf("Couldn't start the lockstep run.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	fflush(stdout);
+	gettimeofday(&start, NULL);
+
+	for(side = 0; side < 2; side++)
+	{
+		if((pids[side] = ForkLockstepEngine(side)) == 0)
+		{
+			//CP/M output is only shown once
+			if(side == 1 && freopen("/dev/null", "w", stdout) == NULL)
+			{
+				_exit(EXIT_FAILURE);
+			}
+
+			return lockstep_engines[side];
+		}
+		else if(pids[side] < 0)
+		{
+			printf("Couldn't start the lockstep run.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	signal(SIGINT, InterruptLockstep);
+	signal(SIGTERM, InterruptLockstep);
+
+	compared = CompareLockstep(pids, &diverged);
+	gettimeofday(&end, NULL);
+
+	for(side = 0; side < 2; side++)
+	{
+		if(pids[side] > 0)
+		{
+			kill(pids[side], SIGKILL);
+			waitpid(pids[side], NULL, 0);
+		}
+	}
+
+	if(compared > 0)
+	{
+		instructions = lockstep_rings[0].states[(compared - 1) & (LOCKSTEP_RING_STATES - 1)].instructions;
+	}
+
+	if(!diverged)
+	{
+		printf("%s and %s agree on %llu states over %llu instructions%s (%.2f s)\n",
+			lockstep_engine_names[lockstep_engines[0]], lockstep_engine_names[lockstep_engines[1]],
+			(unsigned long long)compared, (unsigned long long)instructions,
+			lockstep_interrupted ? ", interrupted" : "",
+			(end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+		exit(EXIT_SUCCESS);
+	}
+
+	first = &(lockstep_rings[0].states[compared & (LOCKSTEP_RING_STATES - 1)]);
+	second = &(lockstep_rings[1].states[compared & (LOCKSTEP_RING_STATES - 1)]);
+
+	if(compared < lockstep_rings[0].head && compared < lockstep_rings[1].head)
+	{
+		printf("Engines diverge at state %llu, after instruction %llu agreed:\n", (unsigned long long)compared, (unsigned long long)instructions);
+		PrintLockstepStates(first, second);
+	}
+
+	ReplayLockstepDivergence(compared < lockstep_rings[0].head && compared < lockstep_rings[1].head
+		? (first -> instructions < second -> instructions ? first -> instructions : second -> instructions)
+		: instructions + lockstep_window);
+
+	//only the replaying engines get here
+	return lockstep_engines[lockstep_side];
+}
+
+//Called by an engine's process when its run ends
+void StopLockstep()
+{
+	if(lockstep_replaying)
+	{
+		FinishLockstepReplay();
+	}
+
+	RecordLockstep();
+	__atomic_store_n(&(lockstep_ring_own -> finished), 1, __ATOMIC_RELEASE);
+	fflush(stdout);
+	_exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,142 @@
+/************************************************************************
+ * 8080 Machine State							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Definitions of the processor registers, memory and signals shared	*
+ * by the emulator and the tools built on the instruction set		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+//HARDWARE---
+uint8_t	*address_space,
+	*hard_disk,
+	*memory,
+	*video_memory,
+	*io;
+
+//Rows of video memory written since the renderer last converted them (video.h)
+uint8_t video_dirty_rows[VIDEO_HEIGHT];
+
+//Pages whose stores are tracked (STORE_VIDEO, STORE_CODE, STORE_WATCH), and what a store to decoded code (decode.h) or a watched page (debug.h) calls
+uint8_t store_pages[256] = {[VIDEO_MEM_START_ADDRESS >> 8 ... (VIDEO_MEM_START_ADDRESS + VIDEO_MEM_SIZE - 1) >> 8] = STORE_VIDEO};
+void (*code_store_hook)(uint16_t address, uint32_t count) = NULL;
+void (*watch_store_hook)(uint16_t address, uint32_t count) = NULL;
+
+uint8_t register_file[10];
+
+/*
+ * General Purpose Registers
+ * x86 stores data using little endian format.
+ *
+ * These registers are accessed as register pairs (where B, D, and H hold the higher order byte) 
+ * using  a uint16_t pointer in various instructions.
+ *
+ * As a result of these two facts, the registers are described in an order where the low order 
+ * register is assigned a lower address than it's higher order counterpart.
+ */
+uint8_t *const c = register_file + C;
+uint8_t *const b = register_file + B;
+uint8_t *const e = register_file + E;
+uint8_t *const d = register_file + D;
+uint8_t *const l = register_file + L;
+uint8_t *const h = register_file + H;
+
+//Accumulator
+uint8_t *const a = register_file + A;
+
+/*
+ * Status Byte
+ * FLAGS - Carry | Aux Carry | Sign | Zero | Even Parity
+ * BIT   - 0     | 1         | 2    | 3    | 4 
+ */
+uint8_t *const status = register_file + STATUS;
+
+//Registers Z and W can only be used for instruction execution
+//These registers are not directly accessible to the programmer
+//static uint8_t *const z = register_file + Z;
+//static uint8_t *const w = register_file + W;
+
+//Register Pairs
+//B+C
+uint16_t *const b_pair = (uint16_t*)(register_file + B_PAIR);
+//D+E
+uint16_t *const d_pair = (uint16_t*)(register_file + D_PAIR);
+//H+L
+uint16_t *const h_pair = (uint16_t*)(register_file + H_PAIR);
+//A+status
+uint16_t *const psw = (uint16_t*)(register_file + PSW);
+
+/*
+ * The pc and sp contain the emulated address and not the host address.
+ * The emulated address is in fact an index for the emulated memory,
+ * which is a dynamically-allocated array.
+ */
+uint16_t pc;
+uint16_t sp;
+
+//Instruction Register
+uint8_t instruction_register;
+
+//Processor Time
+uint32_t time;
+//---
+
+/*
+ * I/O---
+ * Control I/O Signals of 8080
+ * SIGNALS - WR'(0) | DBIN(O) | INTE(O) | INT(I) | HOLD ACK(O) | HOLD(I) | WAIT (0) | READY(I) | SYNC(O) | RESET(I) 
+ * BIT     - 0      | 1       | 2       | 3      | 4           | 5       | 6        | 7        | 8       | 9
+ */
+uint16_t control;
+uint8_t interrupt_enable;
+uint8_t halt_enable;
+uint8_t interrupt_request;
+uint8_t priority;
+
+//Event counts kept for the run statistics (stats.h)
+uint32_t interrupts_taken;	//interrupts acknowledged
+uint32_t device_events;		//storage transfers, keys read and BDOS calls
+uint32_t decode_cache_hits;	//blocks found in the decode cache
+uint32_t decode_cache_misses;	//blocks decoded on first use
+//---
+
+/*
+ * USER INTERFACE---
+ * Signals presented on the 8800 front panel
+ * SIGNALS - INTE | PROT | MEMR | INP | M1 | OUT | HLTA | STACK | WO'  | INT(A) | WAIT | HLDA | RESET
+ * BIT     - 0    | 1    | 2    | 3   | 4  | 5   | 6    | 7     | 8    | 9      | 10   | 11   | 12
+ */
+uint16_t indicator;
+//---
+//---
+
+/*
+ * Memory-mapped Nonvolatile Memory Registers
+ * 0x3ffc - Storage Control Register
+ * BITS:	3			2			1		0		
+ * VALUE:	Write-Request Flag	Read-Request Flag	Ready Flag	Interrupt-Enable
+ * 0x3ffd - Data Register
+ * 0x3ffe/f - Address Registers 
+ */
+
+/* Memory-mapped Keyboard Registers
+ * 0x3ff9 - Keyboard Control Register
+ * BITS:	1		0
+ * VALUE:	Ready Flag	Interrupt-Enable
+ * 0x3ffa - Data Register
+ */
+
+/* Memory-mapped Display Registers
+ *
+ */ 
+
+interrupt_device interrupt_vector;
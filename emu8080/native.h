@@ -0,0 +1,230 @@
+/************************************************************************
+ * 8080 Emulator Native Routines					*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * High-level emulation of hot guest subroutines: a CALL to a		*
+ * registered address runs a host C routine instead of the guest code	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define CALL_OPCODE		0xcd
+
+/*
+ * A native routine does the work of the guest subroutine (including its RET),
+ * leaving registers, flags and memory exactly as the guest code would, and
+ * returns the number of clock cycles the guest code would have taken.
+ */
+typedef uint32_t (*native_routine)(void);
+
+typedef struct native_routine_entry
+{
+	const char *name;
+	native_routine routine;
+} native_entry;
+
+//Routines by guest address; NULL where the guest code runs
+native_routine native_routine_table[0x10000];
+
+//The flags ORA leaves for the given accumulator value (every routine below ends with ORA before RZ)
+static inline void NativeOraFlags(uint8_t value)
+{
+	ModifyFlags(0, value, ALL);
+	status[0] &= ~0x03;
+}
+
+//Byte-by-byte forward copy, identical to the guest loop even when the ranges overlap or wrap
+static inline void NativeCopy(uint16_t destination, uint16_t source, uint16_t count)
+{
+	MarkStoreRange(destination, count);
+
+	if(source + count <= ADDRESSED_SPACE_SIZE && destination + count <= ADDRESSED_SPACE_SIZE
+	&& (destination <= source || destination >= source + count))
+	{
+		memmove(memory + destination, memory + source, count);
+		return;
+	}
+
+	while(count--)
+	{
+		memory[destination++] = memory[source++];
+	}
+}
+
+/*
+ * memcpy - copy BC bytes from (HL) to (DE)
+ * MEMCPY:	MOV A, B	;5
+ *		ORA C		;4
+ *		RZ		;5/11
+ *		MOV A, M	;7
+ *		STAX D		;7
+ *		INX H		;5
+ *		INX D		;5
+ *		DCX B		;5
+ *		JMP MEMCPY	;10
+ */
+uint32_t NativeMemcpy()
+{
+	uint16_t count = b_pair[0];
+
+	NativeCopy(d_pair[0], h_pair[0], count);
+
+	h_pair[0] += count;
+	d_pair[0] += count;
+	b_pair[0] = 0;
+	a[0] = 0;
+	NativeOraFlags(0);
+
+	return count * 53 + 20;
+}
+
+/*
+ * memset - fill BC bytes at (HL) with E
+ * MEMSET:	MOV A, B	;5
+ *		ORA C		;4
+ *		RZ		;5/11
+ *		MOV M, E	;7
+ *		INX H		;5
+ *		DCX B		;5
+ *		JMP MEMSET	;10
+ */
+uint32_t NativeMemset()
+{
+	uint16_t count = b_pair[0],
+		 address = h_pair[0];
+
+	MarkStoreRange(address, count);
+
+	if(address + count <= ADDRESSED_SPACE_SIZE)
+	{
+		memset(memory + address, e[0], count);
+	}
+	else
+	{
+		while(count--)
+		{
+			memory[address++] = e[0];
+		}
+		count = b_pair[0];
+	}
+
+	h_pair[0] += count;
+	b_pair[0] = 0;
+	a[0] = 0;
+	NativeOraFlags(0);
+
+	return count * 41 + 20;
+}
+
+/*
+ * strlen - length of the null-terminated string at (HL) in BC; HL is left on the terminator
+ * STRLEN:	LXI B, 0	;10
+ * LOOP:	MOV A, M	;7
+ *		ORA A		;4
+ *		RZ		;5/11
+ *		INX H		;5
+ *		INX B		;5
+ *		JMP LOOP	;10
+ */
+uint32_t NativeStrlen()
+{
+	uint16_t length = 0;
+
+	while(memory[(uint16_t)(h_pair[0] + length)] != 0 && length != 0xffff)
+	{
+		length++;
+	}
+
+	h_pair[0] += length;
+	b_pair[0] = length;
+	a[0] = 0;
+	NativeOraFlags(0);
+
+	return 10 + length * 36 + 22;
+}
+
+native_entry native_routine_library[] =
+{
+	{"memcpy", NativeMemcpy},
+	{"memset", NativeMemset},
+	{"strlen", NativeStrlen},
+	{NULL, NULL}
+};
+
+//CALL that runs the native routine registered at its target instead of the guest subroutine
+void CallNative(data *in)
+{
+	native_routine routine = native_routine_table[ReadWord(pc)];
+	uint16_t return_address = pc + 2;
+
+	if(routine == NULL)
+	{
+		Call(in);
+		return;
+	}
+
+	//the return address is left below sp, as the guest CALL and RET would leave it
+	WriteWord(sp - 2, return_address);
+	pc = return_address;
+
+	time += in -> duration + routine();	//CALL + body (which includes the RET)
+}
+
+/*
+ * Registers a host function to run in place of the guest subroutine at address.
+ * The CALL handler is only swapped for CallNative once a routine is registered,
+ * so programs without native routines keep the plain Call.
+ */
+int RegisterNativeFunction(uint16_t address, native_routine routine)
+{
+	if(routine == NULL || native_routine_table[address] != NULL)
+	{
+		printf("Couldn't register a native routine at %04x.\n", address);
+		return EXIT_FAILURE;
+	}
+
+	native_routine_table[address] = routine;
+	instruction_set[CALL_OPCODE] = CallNative;
+
+	return EXIT_SUCCESS;
+}
+
+//Registers a library routine (by name) at a guest address
+int RegisterNativeRoutine(const char *name, uint16_t address)
+{
+	int i;
+
+	for(i = 0; native_routine_library[i].name != NULL; i++)
+	{
+		if(strcmp(native_routine_library[i].name, name) == 0)
+		{
+			return RegisterNativeFunction(address, native_routine_library[i].routine);
+		}
+	}
+
+	printf("Unknown native routine %s.\n", name);
+	return EXIT_FAILURE;
+}
+
+//Parses a "<routine>@<hex address>" option, e.g. memcpy@0200
+int ParseNativeRoutineOption(char *option)
+{
+	char name[16];
+	unsigned int address;
+
+	if(sscanf(option, "%15[^@]@%x", name, &address) != 2 || address > 0xffff)
+	{
+		printf("Native routines are given as <routine>@<hex address>.\n");
+		return EXIT_FAILURE;
+	}
+
+	return RegisterNativeRoutine(name, address);
+}
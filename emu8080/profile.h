@@ -0,0 +1,214 @@
+/************************************************************************
+ * 8080 Emulator Execution Profile					*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Executions and cycles counted per opcode and per address, written	*
+ * as a sorted report and as a 64K-entry heatmap when the run ends	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <signal.h>
+
+#define PROFILE_ADDRESSES	0x10000
+#define PROFILE_MAGIC		"PRF8080"	//8 bytes with the terminator
+
+/*
+ * Heatmap File (binary, little-endian)
+ * 8 bytes	- "PRF8080\0"
+ * 256 KiB	- executions of the instruction at each address (uint32_t)
+ * 512 KiB	- cycles spent in the instruction at each address (uint64_t)
+ */
+typedef struct profile_counters
+{
+	uint32_t executions[PROFILE_ADDRESSES];
+	uint64_t cycles[PROFILE_ADDRESSES];
+	uint64_t opcode_executions[INSTRUCTION_SET_SIZE];
+	uint64_t opcode_cycles[INSTRUCTION_SET_SIZE];
+} profile_data;
+
+profile_data profile;
+uint8_t profile_enabled = 0;
+char *profile_report_file = NULL,
+     *profile_heatmap_file = NULL;
+uint32_t profile_time = 0;			//time when the instruction being recorded started
+
+/*
+ * Called after the instruction at address has executed. It is charged the time
+ * that passed while it ran, which covers taken calls and returns, native
+ * routines and idiom loops alike.
+ */
+static inline void RecordProfile(uint16_t address)
+{
+	uint8_t opcode = instruction_register;
+	uint32_t cycles = time - profile_time;
+
+	profile_time = time;
+
+	profile.executions[address] += 1;
+	profile.cycles[address] += cycles;
+	profile.opcode_executions[opcode] += 1;
+	profile.opcode_cycles[opcode] += cycles;
+}
+
+//Signal that ended the run, 0 if none did
+volatile sig_atomic_t stop_signal = 0;
+
+//SIGINT and SIGTERM end the run at the next instruction so the profile is still written
+void StopOnSignal(int signal_number)
+{
+	stop_signal = signal_number;
+	halt_enable = 1;
+}
+
+void StartProfile()
+{
+	profile_time = time;
+
+	signal(SIGINT, StopOnSignal);
+	signal(SIGTERM, StopOnSignal);
+}
+
+//Orders indices by cycles, most first
+uint64_t *profile_sort_cycles;
+
+int CompareProfileCycles(const void *first, const void *second)
+{
+	uint64_t x = profile_sort_cycles[*(const uint32_t *)first],
+		 y = profile_sort_cycles[*(const uint32_t *)second];
+
+	return (x < y) - (x > y);
+}
+
+/*
+ * Writes the opcodes, then the addresses, that took any cycles, most cycles first:
+ * <opcode> <name> <executions> <cycles> <percent of cycles>
+ * <address> <opcode> <name> <executions> <cycles> <percent of cycles>
+ */
+int WriteProfileReport(char *filename, profile_data *counters)
+{
+	FILE *file;
+	uint32_t *order = malloc(PROFILE_ADDRESSES * sizeof(uint32_t)), i;
+	uint64_t instructions = 0, total_cycles = 0;
+	uint8_t opcode;
+
+	if((file = fopen(filename, "w")) == NULL)
+	{
+		printf("Couldn't open profile report %s.\n", filename);
+		free(order);
+		return EXIT_FAILURE;
+	}
+
+	for(i = 0; i < INSTRUCTION_SET_SIZE; i++)
+	{
+		instructions += counters -> opcode_executions[i];
+		total_cycles += counters -> opcode_cycles[i];
+		order[i] = i;
+	}
+
+	if(total_cycles == 0)
+	{
+		total_cycles = 1;
+	}
+
+	fprintf(file, "%llu instructions, %llu cycles\n\nOpcodes\n",
+		(unsigned long long)instructions, (unsigned long long)total_cycles);
+
+	profile_sort_cycles = counters -> opcode_cycles;
+	qsort(order, INSTRUCTION_SET_SIZE, sizeof(uint32_t), CompareProfileCycles);
+
+	for(i = 0; i < INSTRUCTION_SET_SIZE && counters -> opcode_cycles[order[i]]; i++)
+	{
+		fprintf(file, "%02x %-12s %12llu %14llu %6.2f%%\n", order[i], instruction_set_data[order[i]].name,
+			(unsigned long long)counters -> opcode_executions[order[i]],
+			(unsigned long long)counters -> opcode_cycles[order[i]],
+			100.0 * counters -> opcode_cycles[order[i]] / total_cycles);
+	}
+
+	fprintf(file, "\nAddresses\n");
+
+	for(i = 0; i < PROFILE_ADDRESSES; i++)
+	{
+		order[i] = i;
+	}
+
+	profile_sort_cycles = counters -> cycles;
+	qsort(order, PROFILE_ADDRESSES, sizeof(uint32_t), CompareProfileCycles);
+
+	for(i = 0; i < PROFILE_ADDRESSES && counters -> cycles[order[i]]; i++)
+	{
+		//the opcode in memory now, which self-modifying code may have changed
+		opcode = memory[order[i]];
+
+		fprintf(file, "%04x %02x %-12s %12lu %14llu %6.2f%%\n", order[i], opcode, instruction_set_data[opcode].name,
+			(unsigned long)counters -> executions[order[i]],
+			(unsigned long long)counters -> cycles[order[i]],
+			100.0 * counters -> cycles[order[i]] / total_cycles);
+	}
+
+	fclose(file);
+	free(order);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Writes the per-address counters to filename.
+ * Files ending in .txt get one line per executed address instead:
+ * <address> <executions> <cycles>
+ */
+int WriteProfileHeatmap(char *filename, profile_data *counters)
+{
+	FILE *file;
+	size_t length = strlen(filename);
+	uint32_t address;
+
+	if((file = fopen(filename, "wb")) == NULL)
+	{
+		printf("Couldn't open heatmap file %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	if(length > 4 && strcmp(filename + length - 4, ".txt") == 0)
+	{
+		for(address = 0; address < PROFILE_ADDRESSES; address++)
+		{
+			if(counters -> executions[address])
+			{
+				fprintf(file, "%04x %lu %llu\n", address, (unsigned long)counters -> executions[address],
+					(unsigned long long)counters -> cycles[address]);
+			}
+		}
+	}
+	else
+	{
+		fwrite(PROFILE_MAGIC, 1, sizeof(PROFILE_MAGIC), file);
+		fwrite(counters -> executions, sizeof(counters -> executions), 1, file);
+		fwrite(counters -> cycles, sizeof(counters -> cycles), 1, file);
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+void WriteProfile()
+{
+	if(profile_report_file != NULL)
+	{
+		WriteProfileReport(profile_report_file, &profile);
+	}
+
+	if(profile_heatmap_file != NULL)
+	{
+		WriteProfileHeatmap(profile_heatmap_file, &profile);
+	}
+}
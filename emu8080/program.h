@@ -0,0 +1,58 @@
+/************************************************************************
+ * 8080 Emulator Program Files						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * The assembler's object files (.list) read for the emulator, the	*
+ * benchmarks and the image analyzer alike				*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+//Places one byte of a program; returns EXIT_FAILURE to stop reading
+typedef int (*program_byte_store)(uint32_t address, uint8_t value, void *context);
+
+/*
+ * Program File (text, written by the assembler as <object>.list)
+ * <byte count:4 hex><address:4 hex> followed by that many 2-digit hex bytes,
+ * repeated, and ended by "fi"; the format GetProgram reads from the terminal.
+ * Every byte is passed to store, which decides where it goes.
+ */
+int ReadProgramFile(char *filename, program_byte_store store, void *context)
+{
+	FILE *file;
+	char token[9];
+	uint32_t address = 0, byte_count = 0;
+	int result = EXIT_SUCCESS;
+
+	if((file = fopen(filename, "r")) == NULL)
+	{
+		printf("Couldn't open program %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	while(result == EXIT_SUCCESS && fscanf(file, "%8s", token) == 1 && strcmp(token, "fi") != 0)
+	{
+		if(strlen(token) == 8)
+		{
+			byte_count = (strtoul(token, NULL, 16) >> 16) & 0xffff;
+			address = strtoul(token, NULL, 16) & 0xffff;
+		}
+		else if(strlen(token) == 2 && byte_count > 0)
+		{
+			result = store(address++, strtoul(token, NULL, 16), context);
+			byte_count--;
+		}
+	}
+
+	fclose(file);
+
+	return result;
+}
@@ -0,0 +1,287 @@
+/************************************************************************
+ * 8080 Emulator Recompiled Code					*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Runtime for an image translated to C by the recompiler and built	*
+ * in with -DRECOMPILED_SOURCE='"<file>"'; the interpreter runs the	*
+ * code the recompiler didn't find					*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define RECOMPILED_STALE	0x01		//stored to since its hash was last checked
+#define RECOMPILED_CHANGED	0x02		//its bytes no longer match the image it was made from
+#define RECOMPILED_BREAKPOINT	0x04		//holds a breakpoint, so the interpreter runs it
+
+typedef struct recompiled_block_entry
+{
+	uint16_t start;
+	uint32_t end;			//exclusive, so a block can end at 0x10000
+	uint32_t hash;		//FNV-1a of the block's bytes when it was recompiled
+	uint8_t flags;		//RECOMPILED_STALE, RECOMPILED_CHANGED, RECOMPILED_BREAKPOINT
+} recompiled_block;
+
+uint8_t recompiled_enabled = 0,
+	recompiled_stepping = 0,	//every instruction is completed (coverage, profiles, traces, samples, lockstep)
+	recompiled_stop = 0;		//a store made a block stale; the running block stops after the instruction
+
+uint32_t RecompiledBlockHash(uint16_t start, uint32_t end)
+{
+	uint32_t hash = 2166136261u,
+		 address;
+
+	for(address = start; address < end; address++)
+	{
+		hash = (hash ^ memory[address]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+ * Checked on entry to a block with flags set, and while the debugger has the
+ * interpreter run everything. A stale block is hashed again (and, while
+ * debugging, searched for breakpoints) once; until the next store to it the
+ * result stands. Returns 0 to leave the block to the interpreter.
+ */
+uint8_t RecompiledBlockRunnable(recompiled_block *compiled)
+{
+	if(compiled -> flags & RECOMPILED_STALE)
+	{
+		compiled -> flags = (RecompiledBlockHash(compiled -> start, compiled -> end) != compiled -> hash) ? RECOMPILED_CHANGED : 0;
+
+		if(debugging && BreakpointInRange(compiled -> start, compiled -> end))
+		{
+			compiled -> flags |= RECOMPILED_BREAKPOINT;
+		}
+	}
+
+	return compiled -> flags == 0 && !debug_interpret;
+}
+
+//Completes the count instructions run since the last completion, the last of them at address
+static inline void RecompiledComplete(uint16_t address, uint8_t opcode, uint32_t count)
+{
+	instruction_register = opcode;
+
+	if(stats_enabled)
+	{
+		stats_instructions += count - 1;
+	}
+
+	InstructionComplete(address);
+}
+
+#ifdef RECOMPILED_SOURCE
+
+/*
+ * Recompiled Source (written by recompiler.c)
+ * A runner with one labeled block per basic block, included twice: once to
+ * run the blocks through, completing their instructions (InstructionComplete)
+ * and checking for halts, interrupts and write watchpoints only where a block
+ * is left, and once to complete every instruction as the interpreter does,
+ * for the tools that look at each one. The blocks' own code is the same in both.
+ *
+ * RECOMPILED_BLOCK(index)				- entry of recompiled_blocks[index]
+ * RECOMPILED_STEP(address, opcode, next)		- after an instruction inside a block
+ * RECOMPILED_STORED(address, opcode, next, count)	- after one that stores, which may have rewritten code
+ * RECOMPILED_SYNC(address, opcode, next, count)	- after one that reaches a device register
+ * RECOMPILED_COMPLETE(address, opcode, count)		- before leaving a block, with pc set
+ * RECOMPILED_CALL(address, opcode)			- an instruction left to its handler (io, traps, replaced handlers)
+ * RECOMPILED_HANDLED(address, opcode, next, count)	- after a handler inside a block
+ * count is the number of instructions since the last completion.
+ */
+#define RECOMPILED_BLOCK(index)							\
+	if((recompiled_blocks[index].flags || debug_interpret)			\
+	&& !RecompiledBlockRunnable(recompiled_blocks + (index)))		\
+	{									\
+		return entered;							\
+	}									\
+	entered = 1;
+
+#define RECOMPILED_CALL(address, opcode)					\
+	pc = (address) + 1;							\
+	instruction_register = (opcode);					\
+	instruction_set[opcode](&instruction_set_data[opcode]);
+
+#define RECOMPILED_HANDLED(address, opcode, next, count)			\
+	RECOMPILED_COMPLETE(address, opcode, count);				\
+	if(pc != (next))							\
+	{									\
+		goto dispatch;							\
+	}
+
+//Blocks run through
+#define RECOMPILED_RUNNER	RunRecompiledBlocks
+
+#define RECOMPILED_STEP(address, opcode, next)
+
+#define RECOMPILED_COMPLETE(address, opcode, count)				\
+	RecompiledComplete(address, opcode, count);				\
+	if(halt_enable || (interrupt_request && interrupt_enable) || watch_hit)	\
+	{									\
+		return 1;							\
+	}
+
+#define RECOMPILED_STORED(address, opcode, next, count)				\
+	if(recompiled_stop || watch_hit)					\
+	{									\
+		recompiled_stop = 0;						\
+		pc = (next);							\
+		RecompiledComplete(address, opcode, count);			\
+		return 1;							\
+	}
+
+#define RECOMPILED_SYNC(address, opcode, next, count)				\
+	pc = (next);								\
+	RECOMPILED_COMPLETE(address, opcode, count);
+
+#include RECOMPILED_SOURCE
+
+#undef RECOMPILED_RUNNER
+#undef RECOMPILED_STEP
+#undef RECOMPILED_COMPLETE
+#undef RECOMPILED_STORED
+#undef RECOMPILED_SYNC
+
+//Every instruction completed
+#define RECOMPILED_RUNNER	RunRecompiledSteps
+
+#define RECOMPILED_STEP(address, opcode, next)					\
+	pc = (next);								\
+	RECOMPILED_COMPLETE(address, opcode, 1);
+
+#define RECOMPILED_COMPLETE(address, opcode, count)				\
+	instruction_register = (opcode);					\
+	InstructionComplete(address);						\
+	if(halt_enable || (interrupt_request && interrupt_enable) || watch_hit)	\
+	{									\
+		return 1;							\
+	}
+
+#define RECOMPILED_STORED(address, opcode, next, count)				\
+	if(recompiled_stop)							\
+	{									\
+		recompiled_stop = 0;						\
+		return 1;							\
+	}
+
+#define RECOMPILED_SYNC(address, opcode, next, count)
+
+#include RECOMPILED_SOURCE
+
+uint8_t recompiled_code_available = 1;
+uint32_t recompiled_block_count = 0;
+
+//Bytes covered by recompiled blocks, one bit each; stores to them make the blocks stale (RecompiledStore)
+uint8_t recompiled_code_map[0x10000 / BYTE];
+
+/*
+ * Called for stores to pages holding recompiled code (TrackedStore), and when
+ * a breakpoint is set or cleared (debug.h). Every block covering a stored byte
+ * is checked again on its next entry, and a running block stops after the
+ * storing instruction. The decode cache, if it runs too, drops its copies.
+ */
+void RecompiledStore(uint16_t address, uint32_t count)
+{
+	uint32_t byte, i;
+
+	for(byte = address; byte < address + count; byte++)
+	{
+		if(!(recompiled_code_map[byte / BYTE] & (1 << (byte % BYTE))))
+		{
+			continue;
+		}
+
+		for(i = 0; i < recompiled_block_count && recompiled_blocks[i].start <= byte; i++)
+		{
+			if(recompiled_blocks[i].end > byte)
+			{
+				recompiled_blocks[i].flags |= RECOMPILED_STALE;
+				recompiled_stop = 1;
+			}
+		}
+	}
+
+	if(decode_cache_enabled)
+	{
+		InvalidateCode(address, count);
+	}
+}
+
+/*
+ * Before the recompiled code first runs: each block is checked on its first
+ * entry, stores to the blocks' bytes are tracked, and the tools that look at
+ * every instruction get the runner that completes each one.
+ */
+void StartRecompiledCode()
+{
+	uint32_t address;
+	recompiled_block *compiled;
+
+	for(compiled = recompiled_blocks; compiled -> end != 0; compiled++)
+	{
+		compiled -> flags = RECOMPILED_STALE;
+
+		for(address = compiled -> start; address < compiled -> end; address++)
+		{
+			recompiled_code_map[address / BYTE] |= 1 << (address % BYTE);
+			store_pages[address >> 8] |= STORE_CODE;
+		}
+
+		recompiled_block_count++;
+	}
+
+	code_store_hook = RecompiledStore;
+	recompiled_stepping = coverage_enabled || profile_enabled || trace_enabled || sample_enabled || lockstep_enabled;
+}
+
+int RunRecompiledCode()
+{
+	return recompiled_stepping ? RunRecompiledSteps() : RunRecompiledBlocks();
+}
+
+//The recompiled blocks only stand for the image they were made from
+int RecompiledCodeMatches()
+{
+	recompiled_block *compiled;
+
+	for(compiled = recompiled_blocks; compiled -> end != 0; compiled++)
+	{
+		if(compiled -> end > ADDRESSED_SPACE_SIZE || RecompiledBlockHash(compiled -> start, compiled -> end) != compiled -> hash)
+		{
+			printf("Recompiled block %04x doesn't match the loaded program.\n", compiled -> start);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+#else
+
+uint8_t recompiled_code_available = 0;
+
+void StartRecompiledCode()
+{
+}
+
+int RunRecompiledCode()
+{
+	return 0;
+}
+
+int RecompiledCodeMatches()
+{
+	return 0;
+}
+
+#endif
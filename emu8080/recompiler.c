@@ -0,0 +1,482 @@
+/************************************************************************
+ * 8080 Static Recompiler						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Translates the analyzed basic blocks of an 8080 image into C, to be	*
+ * compiled into the emulator with -DRECOMPILED_SOURCE='"<file>"'	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include "machine.h"
+#include "instruction_set.h"
+#include "program.h"
+#include "analysis.h"
+
+#define EMITTED_STORE		0x01		//the instruction stores to memory
+#define EMITTED_DEVICE		0x02		//it reaches a device register, which the devices must see at once
+#define EMITTED_HANDLER		0x04		//it is left to its handler
+
+//C for the register field of an opcode (6 is M) and for its register pair field
+const char *const register_operands[8] = {"b[0]", "c[0]", "d[0]", "e[0]", "h[0]", "l[0]", "memory[h_pair[0]]", "a[0]"};
+const char *const pair_operands[4] = {"b_pair[0]", "d_pair[0]", "h_pair[0]", "sp"};
+
+//Accumulator operations of 0x80 to 0xBF and of the immediates, by bits 3 to 5
+const char *const accumulator_operations[8] = {"Add", "Adc", "Sub", "Sbb", "Ana", "Xra", "Ora", "Cmp"};
+
+//Condition codes as tests of the status byte (see ConditionTrue): NZ, Z, NC, C, PO, PE, P, M
+const char *const conditions[8] =
+{
+	"!(status[0] & Z)", "(status[0] & Z)", "!(status[0] & CY)", "(status[0] & CY)",
+	"!(status[0] & EP)", "(status[0] & EP)", "!(status[0] & S)", "(status[0] & S)"
+};
+
+//FNV-1a, checked against memory before a block first runs and after stores to it
+uint32_t BlockHash(uint32_t start, uint32_t end)
+{
+	uint32_t hash = 2166136261u;
+
+	while(start < end)
+	{
+		hash = (hash ^ image[start++]) * 16777619u;
+	}
+
+	return hash;
+}
+
+static inline uint8_t IsDeviceAddress(uint16_t address, uint8_t size)
+{
+	return (address >> 8) == DEVICE_REGISTER_PAGE || ((uint16_t)(address + size - 1) >> 8) == DEVICE_REGISTER_PAGE;
+}
+
+//Continues at target: straight to its block when it has one, otherwise through the dispatcher
+void EmitGoto(FILE *file, const char *indent, uint32_t target)
+{
+	if(target < IMAGE_SIZE && IsBlockStart(target))
+	{
+		fprintf(file, "%sgoto block_%04x;\n", indent, target);
+	}
+	else
+	{
+		fprintf(file, "%sgoto dispatch;\n", indent);
+	}
+}
+
+//Leaves the block for target (or the dispatcher, if target is above 0xffff) with count instructions to complete
+void EmitLeave(FILE *file, const char *indent, uint32_t address, uint8_t opcode, uint32_t count, uint32_t target)
+{
+	if(target <= 0xffff)
+	{
+		fprintf(file, "%spc = 0x%04x;\n", indent, target);
+	}
+
+	fprintf(file, "%sRECOMPILED_COMPLETE(0x%04x, 0x%02x, %u);\n", indent, address, opcode, count);
+
+	if(target <= 0xffff)
+	{
+		EmitGoto(file, indent, target);
+	}
+	else
+	{
+		fprintf(file, "%sgoto dispatch;\n", indent);
+	}
+}
+
+/*
+ * Writes the C for one instruction that doesn't transfer control, with its
+ * operands as constants. Returns EMITTED_* bits; EMITTED_HANDLER means nothing
+ * was written and the instruction must be left to its handler.
+ */
+uint8_t EmitOperation(FILE *file, uint32_t address, uint8_t opcode)
+{
+	uint8_t immediate = image[(uint16_t)(address + 1)],
+		destination = (opcode >> 3) & 0x07,
+		source = opcode & 0x07;
+	uint16_t word = Word(address + 1);
+	const char *pair = pair_operands[(opcode >> 4) & 0x03];
+
+	//MOV (0x76 is HLT)
+	if(opcode >= 0x40 && opcode < 0x80 && opcode != 0x76)
+	{
+		if(destination == 6)
+		{
+			fprintf(file, "\tWriteByte(h_pair[0], %s);\n", register_operands[source]);
+			return EMITTED_STORE;
+		}
+
+		fprintf(file, "\t%s = %s;\n", register_operands[destination], register_operands[source]);
+		return 0;
+	}
+
+	//ADD, ADC, SUB, SBB, ANA, XRA, ORA and CMP
+	if(opcode >= 0x80 && opcode < 0xc0)
+	{
+		fprintf(file, "\t%s(%s);\n", accumulator_operations[destination], register_operands[source]);
+		return 0;
+	}
+
+	//ADI, ACI, SUI, SBI, ANI, XRI, ORI and CPI
+	if((opcode & 0xc7) == 0xc6)
+	{
+		fprintf(file, "\t%s(0x%02x);\n", accumulator_operations[destination], immediate);
+		return 0;
+	}
+
+	//INR, DCR and MVI
+	switch(opcode & 0xc7)
+	{
+	case 0x04: case 0x05:
+		if(destination == 6)
+		{
+			fprintf(file, "\tWriteByte(h_pair[0], %s(memory[h_pair[0]]));\n", (opcode & 0x01) ? "Decrement" : "Increment");
+			return EMITTED_STORE;
+		}
+
+		fprintf(file, "\t%s = %s(%s);\n", register_operands[destination], (opcode & 0x01) ? "Decrement" : "Increment", register_operands[destination]);
+		return 0;
+	case 0x06:
+		if(destination == 6)
+		{
+			fprintf(file, "\tWriteByte(h_pair[0], 0x%02x);\n", immediate);
+			return EMITTED_STORE;
+		}
+
+		fprintf(file, "\t%s = 0x%02x;\n", register_operands[destination], immediate);
+		return 0;
+	default:
+		break;
+	};
+
+	//LXI, DAD, INX, DCX, PUSH and POP by register pair
+	switch(opcode & 0xcf)
+	{
+	case 0x01:
+		fprintf(file, "\t%s = 0x%04x;\n", pair, word);
+		return 0;
+	case 0x09:
+		fprintf(file, "\t{\n\t\tuint32_t sum = h_pair[0] + %s;\n\n\t\th_pair[0] = sum;\n\t\tstatus[0] = (status[0] & ~CY) + (sum >> 16);\n\t}\n", pair);
+		return 0;
+	case 0x03:
+		fprintf(file, "\t%s += 1;\n", pair);
+		return 0;
+	case 0x0b:
+		fprintf(file, "\t%s -= 1;\n", pair);
+		return 0;
+	case 0xc5:
+		if(opcode == 0xf5)
+		{
+			fprintf(file, "\tPushWord((a[0] << 8) + PackedStatus());\n");
+		}
+		else
+		{
+			fprintf(file, "\tPushWord(%s);\n", pair);
+		}
+		return EMITTED_STORE;
+	case 0xc1:
+		if(opcode == 0xf1)
+		{
+			fprintf(file, "\t{\n\t\tuint16_t popped_value = PopWord();\n\n\t\tstatus[0] = UnpackedStatus(popped_value & 0xff);\n\t\ta[0] = popped_value >> 8;\n\t}\n");
+		}
+		else
+		{
+			fprintf(file, "\t%s = PopWord();\n", pair);
+		}
+		return 0;
+	default:
+		break;
+	};
+
+	switch(opcode)
+	{
+	//NOP and the unused opcodes that run as NOP
+	case 0x00: case 0x08: case 0x10: case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+		return 0;
+	case 0x02: case 0x12:
+		fprintf(file, "\tWriteByte(%s, a[0]);\n", pair);
+		return EMITTED_STORE;
+	case 0x0a: case 0x1a:
+		fprintf(file, "\ta[0] = memory[%s];\n", pair);
+		return 0;
+	case 0x22:
+		fprintf(file, "\tWriteWord(0x%04x, h_pair[0]);\n", word);
+		return EMITTED_STORE | (IsDeviceAddress(word, 2) ? EMITTED_DEVICE : 0);
+	case 0x2a:
+		fprintf(file, "\th_pair[0] = ReadWord(0x%04x);\n", word);
+		return IsDeviceAddress(word, 2) ? EMITTED_DEVICE : 0;
+	case 0x32:
+		fprintf(file, "\tWriteByte(0x%04x, a[0]);\n", word);
+		return EMITTED_STORE | (IsDeviceAddress(word, 1) ? EMITTED_DEVICE : 0);
+	case 0x3a:
+		fprintf(file, "\ta[0] = memory[0x%04x];\n", word);
+		return IsDeviceAddress(word, 1) ? EMITTED_DEVICE : 0;
+	case 0x07:
+		fprintf(file, "\ta[0] = (a[0] << 1) + (a[0] >> 7);\n\tstatus[0] = (status[0] & ~CY) + (a[0] & 0x01);\n");
+		return 0;
+	case 0x0f:
+		fprintf(file, "\tstatus[0] = (status[0] & ~CY) + (a[0] & 0x01);\n\ta[0] = (a[0] >> 1) + (a[0] << 7);\n");
+		return 0;
+	case 0x17:
+		fprintf(file, "\t{\n\t\tuint8_t carry = a[0] >> 7;\n\n\t\ta[0] = (a[0] << 1) + (status[0] & CY);\n\t\tstatus[0] = (status[0] & ~CY) + carry;\n\t}\n");
+		return 0;
+	case 0x1f:
+		fprintf(file, "\t{\n\t\tuint8_t carry = a[0] & 0x01;\n\n\t\ta[0] = (a[0] >> 1) + ((status[0] & CY) << 7);\n\t\tstatus[0] = (status[0] & ~CY) + carry;\n\t}\n");
+		return 0;
+	case 0x27:
+		fprintf(file, "\tDecimalAdjust();\n");
+		return 0;
+	case 0x2f:
+		fprintf(file, "\ta[0] = ~a[0];\n");
+		return 0;
+	case 0x37:
+		fprintf(file, "\tstatus[0] |= CY;\n");
+		return 0;
+	case 0x3f:
+		fprintf(file, "\tstatus[0] ^= CY;\n");
+		return 0;
+	case 0x76:
+		fprintf(file, "\thalt_enable |= 0x01;\n");
+		return 0;
+	case 0xe3:
+		fprintf(file, "\t{\n\t\tuint16_t exchanged = ReadWord(sp);\n\n\t\tWriteWord(sp, h_pair[0]);\n\t\th_pair[0] = exchanged;\n\t}\n");
+		return EMITTED_STORE;
+	case 0xeb:
+		fprintf(file, "\t{\n\t\tuint16_t exchanged = h_pair[0];\n\n\t\th_pair[0] = d_pair[0];\n\t\td_pair[0] = exchanged;\n\t}\n");
+		return 0;
+	case 0xf9:
+		fprintf(file, "\tsp = h_pair[0];\n");
+		return 0;
+	case 0xf3:
+		fprintf(file, "\tinterrupt_enable &= ~0x01;\n");
+		return 0;
+	case 0xfb:
+		fprintf(file, "\tinterrupt_enable |= 0x01;\n");
+		return 0;
+	//IN, OUT and the unused opcodes that a mode may take over (the CP/M BDOS trap)
+	default:
+		return EMITTED_HANDLER;
+	};
+}
+
+/*
+ * Writes the last instruction of a block and the block's exits. JMP, CALL,
+ * RST and conditional branches go straight to the blocks they lead to; RET,
+ * PCHL and targets without a block go through the dispatcher. JNZ and CALL
+ * are left to their handlers when those are replaced (loop idioms, native
+ * routines).
+ */
+void EmitExit(FILE *file, uint32_t address, uint8_t opcode, uint32_t count)
+{
+	uint32_t next = address + instruction_set_data[opcode].size,
+		 target = Word(address + 1);
+	uint8_t duration = instruction_set_data[opcode].duration,
+		emitted;
+	const char *condition = conditions[(opcode >> 3) & 0x07];
+
+	if(opcode == 0xc2 || opcode == 0xcd)
+	{
+		fprintf(file, "\tif(instruction_set[0x%02x] != %s)\n\t{\n", opcode, opcode == 0xc2 ? "JumpConditional" : "Call");
+		fprintf(file, "\t\tRECOMPILED_CALL(0x%04x, 0x%02x);\n", address, opcode);
+		fprintf(file, "\t\tRECOMPILED_COMPLETE(0x%04x, 0x%02x, %u);\n\t\tgoto dispatch;\n\t}\n", address, opcode, count);
+	}
+
+	//JMP
+	if(opcode == JMP_OPCODE)
+	{
+		fprintf(file, "\ttime += %u;\n", duration);
+		EmitLeave(file, "\t", address, opcode, count, target);
+	}
+	//Jcc
+	else if((opcode & 0xc7) == 0xc2)
+	{
+		fprintf(file, "\ttime += %u;\n\tif(%s)\n\t{\n", duration, condition);
+		EmitLeave(file, "\t\t", address, opcode, count, target);
+		fprintf(file, "\t}\n");
+		EmitLeave(file, "\t", address, opcode, count, next);
+	}
+	//CALL
+	else if(opcode == 0xcd)
+	{
+		fprintf(file, "\tPushWord(0x%04x);\n\ttime += %u;\n", next & 0xffff, duration);
+		EmitLeave(file, "\t", address, opcode, count, target);
+	}
+	//Ccc
+	else if((opcode & 0xc7) == 0xc4)
+	{
+		fprintf(file, "\ttime += %u;\n\tif(%s)\n\t{\n\t\tPushWord(0x%04x);\n\t\ttime += 6;\n", duration, condition, next & 0xffff);
+		EmitLeave(file, "\t\t", address, opcode, count, target);
+		fprintf(file, "\t}\n");
+		EmitLeave(file, "\t", address, opcode, count, next);
+	}
+	//RET
+	else if(opcode == 0xc9)
+	{
+		fprintf(file, "\tpc = PopWord();\n\ttime += %u;\n", duration);
+		fprintf(file, "\tRECOMPILED_COMPLETE(0x%04x, 0x%02x, %u);\n\tgoto dispatch;\n", address, opcode, count);
+	}
+	//Rcc
+	else if((opcode & 0xc7) == 0xc0)
+	{
+		fprintf(file, "\ttime += %u;\n\tif(%s)\n\t{\n\t\tpc = PopWord();\n\t\ttime += 6;\n", duration, condition);
+		fprintf(file, "\t\tRECOMPILED_COMPLETE(0x%04x, 0x%02x, %u);\n\t\tgoto dispatch;\n\t}\n", address, opcode, count);
+		EmitLeave(file, "\t", address, opcode, count, next);
+	}
+	//RST
+	else if((opcode & 0xc7) == 0xc7)
+	{
+		fprintf(file, "\tPushWord(0x%04x);\n\ttime += %u;\n", next & 0xffff, duration);
+		EmitLeave(file, "\t", address, opcode, count, opcode & 0x38);
+	}
+	//PCHL
+	else if(opcode == PCHL_OPCODE)
+	{
+		fprintf(file, "\tpc = h_pair[0];\n\ttime += %u;\n", duration);
+		fprintf(file, "\tRECOMPILED_COMPLETE(0x%04x, 0x%02x, %u);\n\tgoto dispatch;\n", address, opcode, count);
+	}
+	else if((emitted = EmitOperation(file, address, opcode)) & EMITTED_HANDLER)
+	{
+		fprintf(file, "\tRECOMPILED_CALL(0x%04x, 0x%02x);\n", address, opcode);
+		fprintf(file, "\tRECOMPILED_COMPLETE(0x%04x, 0x%02x, %u);\n\tgoto dispatch;\n", address, opcode, count);
+	}
+	//falls through to the next block (HLT, EI and DI, or a block cut by the next one's start)
+	else
+	{
+		fprintf(file, "\ttime += %u;\n", duration);
+		EmitLeave(file, "\t", address, opcode, count, next);
+	}
+}
+
+void EmitBlock(FILE *file, uint32_t index, uint32_t start, uint32_t end)
+{
+	uint32_t address = start, next, count = 0;
+	uint8_t opcode, emitted;
+
+	fprintf(file, "block_%04x:\n", start);
+	fprintf(file, "\tRECOMPILED_BLOCK(%u);\n", index);
+
+	while(address < end)
+	{
+		opcode = image[address];
+		next = address + instruction_set_data[opcode].size;
+		count++;
+
+		fprintf(file, "\t//%04x: %s\n", address, instruction_set_data[opcode].name);
+
+		if(next >= end)
+		{
+			EmitExit(file, address, opcode, count);
+			break;
+		}
+
+		if((emitted = EmitOperation(file, address, opcode)) & EMITTED_HANDLER)
+		{
+			fprintf(file, "\tRECOMPILED_CALL(0x%04x, 0x%02x);\n", address, opcode);
+			fprintf(file, "\tRECOMPILED_HANDLED(0x%04x, 0x%02x, 0x%04x, %u);\n", address, opcode, next, count);
+			count = 0;
+		}
+		else
+		{
+			fprintf(file, "\ttime += %u;\n", instruction_set_data[opcode].duration);
+			fprintf(file, "\tRECOMPILED_STEP(0x%04x, 0x%02x, 0x%04x);\n", address, opcode, next);
+
+			if(emitted & EMITTED_STORE)
+			{
+				fprintf(file, "\tRECOMPILED_STORED(0x%04x, 0x%02x, 0x%04x, %u);\n", address, opcode, next, count);
+			}
+
+			if(emitted & EMITTED_DEVICE)
+			{
+				fprintf(file, "\tRECOMPILED_SYNC(0x%04x, 0x%02x, 0x%04x, %u);\n", address, opcode, next, count);
+				count = 0;
+			}
+		}
+
+		address = next;
+	}
+
+	fprintf(file, "\n");
+}
+
+/*
+ * Recompiled Source
+ * One labeled block per basic block, each instruction written out as C with
+ * its immediates and branch targets as constants, in a runner that
+ * recompiled.h includes twice (see there for the RECOMPILED_* macros): once
+ * completing instructions only where blocks are left, once after every one.
+ * A block's bytes are hashed on its first entry and again after stores to
+ * them; a block that no longer matches is left to the interpreter.
+ * Known targets are reached by goto; RET, PCHL and unknown targets go through
+ * the dispatcher, which hands anything it doesn't know back to the interpreter.
+ */
+int WriteRecompiledSource(char *filename, char *image_name)
+{
+	FILE *file;
+	uint32_t address, end, blocks = 0;
+
+	if((file = fopen(filename, "w")) == NULL)
+	{
+		printf("Couldn't open %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(file, "/*\n * Recompiled from %s; included by recompiled.h, once for each runner.\n * Regenerate with the recompiler whenever the image changes.\n */\n\n", image_name);
+
+	fprintf(file, "#ifndef RECOMPILED_BLOCKS\n#define RECOMPILED_BLOCKS\n\n");
+	fprintf(file, "recompiled_block recompiled_blocks[] =\n{\n");
+	for(address = 0; address < IMAGE_SIZE; address++)
+	{
+		if(IsBlockStart(address))
+		{
+			end = BlockEnd(address);
+			fprintf(file, "\t{0x%04x, 0x%04x, 0x%08x, 0},\n", address, end, BlockHash(address, end));
+		}
+	}
+	fprintf(file, "\t{0x0000, 0x0000, 0x00000000, 0}\n};\n\n#endif\n\n");
+
+	fprintf(file, "int RECOMPILED_RUNNER()\n{\n\tuint8_t entered = 0;\n\n");
+	fprintf(file, "\tif(halt_enable || (interrupt_request && interrupt_enable))\n\t{\n\t\treturn 0;\n\t}\n\n");
+	fprintf(file, "dispatch:\n\tswitch(pc)\n\t{\n");
+	for(address = 0; address < IMAGE_SIZE; address++)
+	{
+		if(IsBlockStart(address))
+		{
+			fprintf(file, "\tcase 0x%04x: goto block_%04x;\n", address, address);
+		}
+	}
+	fprintf(file, "\tdefault: return entered;\n\t};\n\n");
+
+	for(address = 0; address < IMAGE_SIZE; address++)
+	{
+		if(IsBlockStart(address))
+		{
+			EmitBlock(file, blocks++, address, BlockEnd(address));
+		}
+	}
+
+	fprintf(file, "}\n");
+
+	fclose(file);
+
+	printf("%u blocks written to %s.\n", blocks, filename);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	char *image_name, *source_name;
+
+	if(AnalyzeCommandLine(argc, argv, &image_name, &source_name) != EXIT_SUCCESS)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	return WriteRecompiledSource(source_name, image_name);
+}
@@ -0,0 +1,525 @@
+/************************************************************************
+ * 8080 Reference Model							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Plain, separately written model of every opcode, with its own	*
+ * registers and memory, used to check the instruction set against	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#define REFERENCE_MEMORY_SIZE	0x10000
+#define REFERENCE_M		6		//register field value naming memory at HL
+#define REFERENCE_SP		3		//register pair field value naming sp (or PSW for PUSH and POP)
+
+/*
+ * Registers are indexed like register_file (C, B, E, D, L, H, A, STATUS),
+ * and the status byte has the same layout as the emulator's.
+ * Addresses wrap at 64K, as they do on the 8080.
+ */
+typedef struct reference_cpu_state
+{
+	uint8_t registers[8];
+	uint16_t pc;
+	uint16_t sp;
+	uint32_t time;
+	uint8_t interrupt_enable;
+	uint8_t halt_enable;
+} reference_cpu;
+
+uint8_t *reference_memory = NULL;
+uint8_t reference_io[PORTS];
+
+//register field (B, C, D, E, H, L, M, A) to register_file index
+const int8_t reference_register_index[8] = {B, C, D, E, H, L, -1, A};
+
+//register pair field (BC, DE, HL) to the index of the high register
+const uint8_t reference_pair_index[3] = {B, D, H};
+
+//condition field (NZ, Z, NC, C, PO, PE, P, M) to the flag tested
+const uint8_t reference_condition_flag[8] = {Z, Z, CY, CY, EP, EP, S, S};
+
+static inline uint16_t ReferenceReadWord(uint16_t address)
+{
+	return reference_memory[address] + (reference_memory[(uint16_t)(address + 1)] << 8);
+}
+
+static inline void ReferenceWriteWord(uint16_t address, uint16_t value)
+{
+	reference_memory[address] = value & 0xff;
+	reference_memory[(uint16_t)(address + 1)] = value >> 8;
+}
+
+static inline void ReferencePush(reference_cpu *cpu, uint16_t value)
+{
+	cpu -> sp -= 2;
+	ReferenceWriteWord(cpu -> sp, value);
+}
+
+static inline uint16_t ReferencePop(reference_cpu *cpu)
+{
+	uint16_t value = ReferenceReadWord(cpu -> sp);
+
+	cpu -> sp += 2;
+
+	return value;
+}
+
+static inline uint16_t ReferencePair(reference_cpu *cpu, uint8_t pair)
+{
+	uint8_t high;
+
+	if(pair == REFERENCE_SP)
+	{
+		return cpu -> sp;
+	}
+
+	high = reference_pair_index[pair];
+
+	return (cpu -> registers[high] << 8) + cpu -> registers[high - 1];
+}
+
+static inline void ReferenceSetPair(reference_cpu *cpu, uint8_t pair, uint16_t value)
+{
+	uint8_t high;
+
+	if(pair == REFERENCE_SP)
+	{
+		cpu -> sp = value;
+		return;
+	}
+
+	high = reference_pair_index[pair];
+
+	cpu -> registers[high] = value >> 8;
+	cpu -> registers[high - 1] = value & 0xff;
+}
+
+static inline uint8_t ReferenceOperand(reference_cpu *cpu, uint8_t field)
+{
+	if(field == REFERENCE_M)
+	{
+		return reference_memory[ReferencePair(cpu, 2)];
+	}
+
+	return cpu -> registers[reference_register_index[field]];
+}
+
+static inline void ReferenceSetOperand(reference_cpu *cpu, uint8_t field, uint8_t value)
+{
+	if(field == REFERENCE_M)
+	{
+		reference_memory[ReferencePair(cpu, 2)] = value;
+		return;
+	}
+
+	cpu -> registers[reference_register_index[field]] = value;
+}
+
+//Sets flag if condition is true and clears it otherwise
+static inline void ReferenceFlag(reference_cpu *cpu, uint8_t flag, int condition)
+{
+	if(condition)
+	{
+		cpu -> registers[STATUS] |= flag;
+	}
+	else
+	{
+		cpu -> registers[STATUS] &= ~flag;
+	}
+}
+
+static inline void ReferenceZeroSignParity(reference_cpu *cpu, uint8_t value)
+{
+	uint8_t parity = value;
+
+	parity ^= parity >> 4;
+	parity ^= parity >> 2;
+	parity ^= parity >> 1;
+
+	ReferenceFlag(cpu, Z, value == 0);
+	ReferenceFlag(cpu, S, value & 0x80);
+	ReferenceFlag(cpu, EP, !(parity & 0x01));
+}
+
+/*
+ * ADD, ADC, SUB, SBB, ANA, XRA, ORA, CMP (operation is bits 3 to 5 of the opcode)
+ * Subtraction adds the complement with the carry inverted, so AC is the carry
+ * out of bit 3 of that sum and CY is the inverse of its carry out of bit 7.
+ * AND sets AC to the OR of bit 3 of the operands.
+ */
+void ReferenceArithmetic(reference_cpu *cpu, uint8_t operation, uint8_t value)
+{
+	uint8_t accumulator = cpu -> registers[A],
+		carry = cpu -> registers[STATUS] & CY,
+		result;
+	uint16_t sum;
+
+	switch(operation)
+	{
+	case 0:		//ADD
+	case 1:		//ADC
+		carry = (operation == 1) ? carry : 0;
+		sum = accumulator + value + carry;
+		result = sum;
+
+		ReferenceFlag(cpu, AC, (accumulator & 0x0f) + (value & 0x0f) + carry > 0x0f);
+		ReferenceFlag(cpu, CY, sum > 0xff);
+		break;
+	case 2:		//SUB
+	case 3:		//SBB
+	case 7:		//CMP
+		carry = (operation == 3) ? !carry : 1;
+		sum = accumulator + (uint8_t)~value + carry;
+		result = sum;
+
+		ReferenceFlag(cpu, AC, (accumulator & 0x0f) + (~value & 0x0f) + carry > 0x0f);
+		ReferenceFlag(cpu, CY, sum <= 0xff);
+		break;
+	case 4:		//ANA
+		result = accumulator & value;
+
+		ReferenceFlag(cpu, AC, (accumulator | value) & 0x08);
+		ReferenceFlag(cpu, CY, 0);
+		break;
+	case 5:		//XRA
+	case 6:		//ORA
+	default:
+		result = (operation == 5) ? accumulator ^ value : accumulator | value;
+
+		ReferenceFlag(cpu, AC, 0);
+		ReferenceFlag(cpu, CY, 0);
+		break;
+	};
+
+	ReferenceZeroSignParity(cpu, result);
+
+	if(operation != 7)
+	{
+		cpu -> registers[A] = result;
+	}
+}
+
+//Decimal adjust accumulator
+void ReferenceDaa(reference_cpu *cpu)
+{
+	uint8_t accumulator = cpu -> registers[A],
+		status = cpu -> registers[STATUS],
+		correction = 0,
+		carry = status & CY;
+
+	if((accumulator & 0x0f) > 9 || (status & AC))
+	{
+		correction += 0x06;
+	}
+
+	if(accumulator > 0x99 || carry)
+	{
+		correction += 0x60;
+		carry = 1;
+	}
+
+	cpu -> registers[A] = accumulator + correction;
+
+	ReferenceFlag(cpu, AC, (accumulator & 0x0f) + (correction & 0x0f) > 0x0f);
+	ReferenceFlag(cpu, CY, carry);
+	ReferenceZeroSignParity(cpu, cpu -> registers[A]);
+}
+
+//PSW as it is pushed: S Z 0 AC 0 P 1 CY
+static inline uint8_t ReferencePackStatus(uint8_t status)
+{
+	return ((status & S) << 5) + ((status & Z) << 3) + ((status & AC) << 3) + ((status & EP) >> 2) + 0x02 + (status & CY);
+}
+
+static inline uint8_t ReferenceUnpackStatus(uint8_t packed)
+{
+	return ((packed & 0x80) >> 5) + ((packed & 0x40) >> 3) + ((packed & 0x10) >> 3) + ((packed & 0x04) << 2) + (packed & 0x01);
+}
+
+/*
+ * Fetches and executes the instruction at pc.
+ * The undocumented opcodes are NOPs, as they are in the instruction set.
+ */
+void ReferenceStep(reference_cpu *cpu)
+{
+	uint8_t opcode = reference_memory[cpu -> pc],
+		destination = (opcode >> 3) & 0x07,
+		source = opcode & 0x07,
+		pair = (opcode >> 4) & 0x03,
+		*registers = cpu -> registers,
+		value;
+	uint16_t immediate = ReferenceReadWord(cpu -> pc + 1),
+		 address;
+	uint32_t sum;
+	int taken = ((registers[STATUS] & reference_condition_flag[destination]) != 0) == (destination & 0x01);
+
+	cpu -> pc += 1;
+
+	//HLT sits in the middle of the MOV block
+	if(opcode == 0x76)
+	{
+		cpu -> halt_enable = 1;
+		cpu -> time += 7;
+		return;
+	}
+
+	if((opcode & 0xc0) == 0x40)
+	{
+		ReferenceSetOperand(cpu, destination, ReferenceOperand(cpu, source));
+		cpu -> time += (destination == REFERENCE_M || source == REFERENCE_M) ? 7 : 5;
+		return;
+	}
+
+	if((opcode & 0xc0) == 0x80)
+	{
+		ReferenceArithmetic(cpu, destination, ReferenceOperand(cpu, source));
+		cpu -> time += (source == REFERENCE_M) ? 7 : 4;
+		return;
+	}
+
+	if((opcode & 0xc0) == 0x00)
+	{
+		switch(opcode & 0x0f)
+		{
+		case 0x01:	//LXI
+			ReferenceSetPair(cpu, pair, immediate);
+			cpu -> pc += 2;
+			cpu -> time += 10;
+			return;
+		case 0x03:	//INX
+		case 0x0b:	//DCX
+			ReferenceSetPair(cpu, pair, ReferencePair(cpu, pair) + ((opcode & 0x08) ? -1 : 1));
+			cpu -> time += 5;
+			return;
+		case 0x09:	//DAD
+			sum = ReferencePair(cpu, 2) + ReferencePair(cpu, pair);
+			ReferenceSetPair(cpu, 2, sum);
+			ReferenceFlag(cpu, CY, sum > 0xffff);
+			cpu -> time += 10;
+			return;
+		default:
+			break;
+		};
+
+		switch(opcode & 0x07)
+		{
+		case 0x04:	//INR
+		case 0x05:	//DCR
+			value = ReferenceOperand(cpu, destination) + ((opcode & 0x01) ? -1 : 1);
+			ReferenceSetOperand(cpu, destination, value);
+			ReferenceFlag(cpu, AC, (opcode & 0x01) ? (value & 0x0f) != 0x0f : (value & 0x0f) == 0);
+			ReferenceZeroSignParity(cpu, value);
+			cpu -> time += (destination == REFERENCE_M) ? 10 : 5;
+			return;
+		case 0x06:	//MVI
+			ReferenceSetOperand(cpu, destination, immediate & 0xff);
+			cpu -> pc += 1;
+			cpu -> time += (destination == REFERENCE_M) ? 10 : 7;
+			return;
+		default:
+			break;
+		};
+
+		switch(opcode)
+		{
+		case 0x02:	//STAX B
+		case 0x12:	//STAX D
+			reference_memory[ReferencePair(cpu, pair)] = registers[A];
+			cpu -> time += 7;
+			break;
+		case 0x0a:	//LDAX B
+		case 0x1a:	//LDAX D
+			registers[A] = reference_memory[ReferencePair(cpu, pair)];
+			cpu -> time += 7;
+			break;
+		case 0x22:	//SHLD
+			ReferenceWriteWord(immediate, ReferencePair(cpu, 2));
+			cpu -> pc += 2;
+			cpu -> time += 16;
+			break;
+		case 0x2a:	//LHLD
+			ReferenceSetPair(cpu, 2, ReferenceReadWord(immediate));
+			cpu -> pc += 2;
+			cpu -> time += 16;
+			break;
+		case 0x32:	//STA
+			reference_memory[immediate] = registers[A];
+			cpu -> pc += 2;
+			cpu -> time += 13;
+			break;
+		case 0x3a:	//LDA
+			registers[A] = reference_memory[immediate];
+			cpu -> pc += 2;
+			cpu -> time += 13;
+			break;
+		case 0x07:	//RLC
+			registers[A] = (registers[A] << 1) + (registers[A] >> 7);
+			ReferenceFlag(cpu, CY, registers[A] & 0x01);
+			cpu -> time += 4;
+			break;
+		case 0x0f:	//RRC
+			registers[A] = (registers[A] >> 1) + (registers[A] << 7);
+			ReferenceFlag(cpu, CY, registers[A] & 0x80);
+			cpu -> time += 4;
+			break;
+		case 0x17:	//RAL
+			value = registers[A] >> 7;
+			registers[A] = (registers[A] << 1) + (registers[STATUS] & CY);
+			ReferenceFlag(cpu, CY, value);
+			cpu -> time += 4;
+			break;
+		case 0x1f:	//RAR
+			value = registers[A] & 0x01;
+			registers[A] = (registers[A] >> 1) + ((registers[STATUS] & CY) << 7);
+			ReferenceFlag(cpu, CY, value);
+			cpu -> time += 4;
+			break;
+		case 0x27:	//DAA
+			ReferenceDaa(cpu);
+			cpu -> time += 4;
+			break;
+		case 0x2f:	//CMA
+			registers[A] = ~registers[A];
+			cpu -> time += 4;
+			break;
+		case 0x37:	//STC
+			registers[STATUS] |= CY;
+			cpu -> time += 4;
+			break;
+		case 0x3f:	//CMC
+			registers[STATUS] ^= CY;
+			cpu -> time += 4;
+			break;
+		default:	//NOP
+			cpu -> time += 4;
+			break;
+		};
+
+		return;
+	}
+
+	switch(opcode & 0x07)
+	{
+	case 0x00:	//Rcc
+		if(taken)
+		{
+			cpu -> pc = ReferencePop(cpu);
+		}
+
+		cpu -> time += taken ? 11 : 5;
+		return;
+	case 0x02:	//Jcc
+		cpu -> pc = taken ? immediate : cpu -> pc + 2;
+		cpu -> time += 10;
+		return;
+	case 0x04:	//Ccc
+		cpu -> pc += 2;
+
+		if(taken)
+		{
+			ReferencePush(cpu, cpu -> pc);
+			cpu -> pc = immediate;
+		}
+
+		cpu -> time += taken ? 17 : 11;
+		return;
+	case 0x06:	//ADI, ACI, SUI, SBI, ANI, XRI, ORI, CPI
+		ReferenceArithmetic(cpu, destination, immediate & 0xff);
+		cpu -> pc += 1;
+		cpu -> time += 7;
+		return;
+	case 0x07:	//RST
+		ReferencePush(cpu, cpu -> pc);
+		cpu -> pc = opcode & 0x38;
+		cpu -> time += 11;
+		return;
+	default:
+		break;
+	};
+
+	switch(opcode)
+	{
+	case 0xc1:	//POP B
+	case 0xd1:	//POP D
+	case 0xe1:	//POP H
+		ReferenceSetPair(cpu, pair, ReferencePop(cpu));
+		cpu -> time += 10;
+		break;
+	case 0xf1:	//POP PSW
+		address = ReferencePop(cpu);
+		registers[A] = address >> 8;
+		registers[STATUS] = (registers[STATUS] & ~ALL) + ReferenceUnpackStatus(address & 0xff);
+		cpu -> time += 10;
+		break;
+	case 0xc5:	//PUSH B
+	case 0xd5:	//PUSH D
+	case 0xe5:	//PUSH H
+		ReferencePush(cpu, ReferencePair(cpu, pair));
+		cpu -> time += 11;
+		break;
+	case 0xf5:	//PUSH PSW
+		ReferencePush(cpu, (registers[A] << 8) + ReferencePackStatus(registers[STATUS]));
+		cpu -> time += 11;
+		break;
+	case 0xc3:	//JMP
+		cpu -> pc = immediate;
+		cpu -> time += 10;
+		break;
+	case 0xcd:	//CALL
+		ReferencePush(cpu, cpu -> pc + 2);
+		cpu -> pc = immediate;
+		cpu -> time += 17;
+		break;
+	case 0xc9:	//RET
+		cpu -> pc = ReferencePop(cpu);
+		cpu -> time += 10;
+		break;
+	case 0xd3:	//OUT
+		reference_io[immediate & 0xff] = registers[A];
+		cpu -> pc += 1;
+		cpu -> time += 10;
+		break;
+	case 0xdb:	//IN
+		registers[A] = reference_io[immediate & 0xff];
+		cpu -> pc += 1;
+		cpu -> time += 10;
+		break;
+	case 0xe3:	//XTHL
+		address = ReferenceReadWord(cpu -> sp);
+		ReferenceWriteWord(cpu -> sp, ReferencePair(cpu, 2));
+		ReferenceSetPair(cpu, 2, address);
+		cpu -> time += 18;
+		break;
+	case 0xe9:	//PCHL
+		cpu -> pc = ReferencePair(cpu, 2);
+		cpu -> time += 5;
+		break;
+	case 0xeb:	//XCHG
+		address = ReferencePair(cpu, 2);
+		ReferenceSetPair(cpu, 2, ReferencePair(cpu, 1));
+		ReferenceSetPair(cpu, 1, address);
+		cpu -> time += 4;
+		break;
+	case 0xf9:	//SPHL
+		cpu -> sp = ReferencePair(cpu, 2);
+		cpu -> time += 5;
+		break;
+	case 0xf3:	//DI
+	case 0xfb:	//EI
+		cpu -> interrupt_enable = (opcode == 0xfb);
+		cpu -> time += 4;
+		break;
+	default:	//NOP
+		cpu -> time += 4;
+		break;
+	};
+}
@@ -0,0 +1,262 @@
+/************************************************************************
+ * 8080 Emulator Sampling Profiler					*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Samples the guest pc every so many cycles and charges each sample	*
+ * to the routine it falls in (flat) and to the routines whose calls	*
+ * are on the guest stack (cumulative), using the assembler's symbols	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <signal.h>
+
+#define MAX_SAMPLE_SYMBOLS	4096
+#define SAMPLE_SYMBOL_LENGTH	32
+#define SAMPLE_STACK_DEPTH	32	//stack words searched for return addresses
+
+typedef struct sample_symbol_entry
+{
+	uint16_t address;
+	char name[SAMPLE_SYMBOL_LENGTH];
+	uint32_t self;				//samples with pc in the routine
+	uint32_t cumulative;			//samples with the routine running or on the stack
+	uint32_t last_sample;			//so a recursive routine counts once per sample
+} sample_symbol;
+
+sample_symbol sample_symbols[MAX_SAMPLE_SYMBOLS];
+uint32_t sample_symbol_count = 0;
+
+uint8_t sample_enabled = 0;
+char *sample_file = NULL,
+     *symbol_file = NULL;
+uint32_t sample_cycles = 10000,			//cycles between samples
+	 sample_next = 0,			//time of the next sample
+	 sample_count = 0;
+
+//Orders symbols by address, and labels sharing an address by name, so lookups don't depend on qsort's order
+int CompareSampleSymbolAddresses(const void *first, const void *second)
+{
+	const sample_symbol *x = first,
+			    *y = second;
+
+	if(x -> address != y -> address)
+	{
+		return x -> address - y -> address;
+	}
+
+	return strcmp(x -> name, y -> name);
+}
+
+/*
+ * Symbol File (text, written by the assembler next to the object file)
+ * <address> <label>	- one line per code label, in hex
+ * Lines starting with ';' are ignored.
+ */
+int LoadSymbols(char *filename)
+{
+	FILE *file;
+	char line[128], name[SAMPLE_SYMBOL_LENGTH];
+	unsigned int address;
+
+	if((file = fopen(filename, "r")) == NULL)
+	{
+		printf("Couldn't open symbol file %s.\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	while(fgets(line, sizeof(line), file) != NULL && sample_symbol_count < MAX_SAMPLE_SYMBOLS)
+	{
+		if(line[0] != ';' && sscanf(line, "%x %31s", &address, name) == 2)
+		{
+			sample_symbols[sample_symbol_count].address = address;
+			strcpy(sample_symbols[sample_symbol_count].name, name);
+			sample_symbol_count++;
+		}
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+//Index of the routine holding address: the closest symbol at or below it
+uint32_t FindSampleSymbol(uint16_t address)
+{
+	uint32_t low = 0, high = sample_symbol_count, middle;
+
+	while(high - low > 1)
+	{
+		middle = (low + high) / 2;
+
+		if(sample_symbols[middle].address <= address)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+static inline void ChargeSample(uint32_t symbol)
+{
+	if(sample_symbols[symbol].last_sample != sample_count)
+	{
+		sample_symbols[symbol].last_sample = sample_count;
+		sample_symbols[symbol].cumulative++;
+	}
+}
+
+/*
+ * A stack word is taken for a return address if it follows a CALL, a Ccc or
+ * an RST; data that happens to look like one is charged too, which is the
+ * price of not tracking calls as they are made
+ */
+static inline uint8_t IsReturnAddress(uint16_t address)
+{
+	uint8_t call = memory[(uint16_t)(address - 3)],
+		rst = memory[(uint16_t)(address - 1)];
+
+	return call == 0xcd || (call & 0xc7) == 0xc4 || (rst & 0xc7) == 0xc7;
+}
+
+void TakeSample(uint16_t address)
+{
+	uint16_t slot = sp, return_address;
+	uint32_t symbol, i;
+
+	sample_count++;
+	sample_next += sample_cycles;
+
+	symbol = FindSampleSymbol(address);
+	sample_symbols[symbol].self++;
+	ChargeSample(symbol);
+
+	for(i = 0; i < SAMPLE_STACK_DEPTH; i++, slot += 2)
+	{
+		return_address = ReadWord(slot);
+
+		if(IsReturnAddress(return_address))
+		{
+			ChargeSample(FindSampleSymbol(return_address - 1));
+		}
+	}
+}
+
+//Called after every instruction; the only cost between samples is the compare
+static inline void SampleCheck(uint16_t address)
+{
+	if((int32_t)(time - sample_next) >= 0)
+	{
+		TakeSample(address);
+	}
+}
+
+int StartSampling()
+{
+	//code below the first label is charged to "(unlabeled)", which stays first so a label at 0 still wins
+	strcpy(sample_symbols[0].name, "(unlabeled)");
+	sample_symbols[0].address = 0;
+	sample_symbol_count = 1;
+
+	if(symbol_file != NULL && LoadSymbols(symbol_file) != EXIT_SUCCESS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	qsort(sample_symbols + 1, sample_symbol_count - 1, sizeof(sample_symbol), CompareSampleSymbolAddresses);
+
+	sample_next = time + sample_cycles;
+
+	signal(SIGINT, StopOnSignal);
+	signal(SIGTERM, StopOnSignal);
+
+	return EXIT_SUCCESS;
+}
+
+//Orders symbol indices by self or cumulative samples, most first, then by address
+uint8_t sample_sort_cumulative;
+
+int CompareSampleCounts(const void *first, const void *second)
+{
+	uint32_t x_index = *(const uint32_t *)first,
+		 y_index = *(const uint32_t *)second;
+	const sample_symbol *x = &sample_symbols[x_index],
+			    *y = &sample_symbols[y_index];
+	uint32_t x_count = sample_sort_cumulative ? x -> cumulative : x -> self,
+		 y_count = sample_sort_cumulative ? y -> cumulative : y -> self;
+
+	if(x_count != y_count)
+	{
+		return (x_count < y_count) - (x_count > y_count);
+	}
+
+	return (x_index > y_index) - (x_index < y_index);
+}
+
+/*
+ * Writes the routines that were sampled, by self samples (flat) and then by
+ * cumulative samples:
+ * <self> <percent> <cumulative> <percent> <address> <label>
+ */
+int WriteSampleReport(char *filename)
+{
+	FILE *file;
+	uint32_t *order = malloc(sample_symbol_count * sizeof(uint32_t)), i, pass;
+	double total = sample_count ? sample_count : 1;
+	sample_symbol *symbol;
+
+	if((file = fopen(filename, "w")) == NULL)
+	{
+		printf("Couldn't open sample report %s.\n", filename);
+		free(order);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(file, "%lu samples, one every %lu cycles\n", (unsigned long)sample_count, (unsigned long)sample_cycles);
+
+	for(pass = 0; pass < 2; pass++)
+	{
+		fprintf(file, pass == 0 ? "\nFlat\n" : "\nCumulative\n");
+
+		for(i = 0; i < sample_symbol_count; i++)
+		{
+			order[i] = i;
+		}
+
+		sample_sort_cumulative = pass;
+		qsort(order, sample_symbol_count, sizeof(uint32_t), CompareSampleCounts);
+
+		for(i = 0; i < sample_symbol_count; i++)
+		{
+			symbol = &sample_symbols[order[i]];
+
+			if(symbol -> cumulative == 0)
+			{
+				continue;
+			}
+
+			fprintf(file, "%10lu %6.2f%% %10lu %6.2f%%  %04x %s\n",
+				(unsigned long)symbol -> self, 100.0 * symbol -> self / total,
+				(unsigned long)symbol -> cumulative, 100.0 * symbol -> cumulative / total,
+				symbol -> address, symbol -> name);
+		}
+	}
+
+	fclose(file);
+	free(order);
+
+	return EXIT_SUCCESS;
+}
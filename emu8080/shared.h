@@ -0,0 +1,98 @@
+/************************************************************************
+ * 8080 Emulator Shared Images						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Maps a program image and a base disk image copy-on-write, so every	*
+ * instance running them shares their pages until it writes to one	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHARED_REGION_SIZE	0x10000
+
+//options
+char *shared_image_file = NULL;		//raw memory image loaded at 0x0000
+char *shared_disk_file = NULL;		//raw disk image
+
+//mapped regions (NULL while the region is malloc'd)
+uint8_t *shared_address_space = NULL,
+	*shared_hard_disk = NULL;
+
+/*
+ * Maps filename privately over zero pages: reads come from the page cache
+ * shared by all instances mapping the file, and only the pages an instance
+ * writes are copied for it. Returns NULL if the file can't be mapped.
+ */
+uint8_t *MapSharedImage(char *filename)
+{
+	struct stat information;
+	uint8_t *region;
+	int file;
+
+	if((file = open(filename, O_RDONLY)) < 0 || fstat(file, &information) != 0)
+	{
+		printf("Couldn't open image %s.\n", filename);
+		return NULL;
+	}
+
+	if(information.st_size > SHARED_REGION_SIZE)
+	{
+		printf("Image %s is larger than %u bytes.\n", filename, SHARED_REGION_SIZE);
+		close(file);
+		return NULL;
+	}
+
+	//the anonymous mapping covers the part past the end of the file
+	region = mmap(NULL, SHARED_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(region == MAP_FAILED)
+	{
+		printf("Couldn't map image %s.\n", filename);
+		close(file);
+		return NULL;
+	}
+
+	if(information.st_size > 0 && mmap(region, information.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file, 0) == MAP_FAILED)
+	{
+		printf("Couldn't map image %s.\n", filename);
+		munmap(region, SHARED_REGION_SIZE);
+		close(file);
+		return NULL;
+	}
+
+	close(file);
+
+	return region;
+}
+
+//Frees address_space or hard_disk, whether it was mapped or malloc'd
+void ReleaseMemory(uint8_t *region)
+{
+	if(region != NULL && region == shared_address_space)
+	{
+		munmap(region, SHARED_REGION_SIZE);
+		shared_address_space = NULL;
+	}
+	else if(region != NULL && region == shared_hard_disk)
+	{
+		munmap(region, SHARED_REGION_SIZE);
+		shared_hard_disk = NULL;
+	}
+	else
+	{
+		free(region);
+	}
+}
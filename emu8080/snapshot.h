@@ -0,0 +1,226 @@
+/************************************************************************
+ * 8080 Emulator Snapshots						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Saves and restores the whole machine (processor, devices, memory	*
+ * and storage), and restores only the pages written since a save	*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define TRACKED_REGION_SIZE	0x10000		//address_space and hard_disk are mapped at this size while tracked
+#define MAX_TRACKED_PAGES	(TRACKED_REGION_SIZE / 512)
+
+typedef struct machine_snapshot
+{
+	//processor
+	uint8_t register_file[10];
+	uint16_t pc;
+	uint16_t sp;
+	uint8_t instruction_register;
+	uint32_t time;
+	uint16_t control;
+	uint8_t interrupt_enable;
+	uint8_t halt_enable;
+	uint8_t interrupt_request;
+	interrupt_device interrupt_vector;
+
+	//devices
+	uint32_t storage_op_completion_time;
+	io_state storage_state;
+	uint32_t kb_op_completion_time;
+	io_state kb_state;
+	uint8_t io[PORTS];
+
+	uint8_t address_space[ADDRESSED_SPACE_SIZE];
+	uint8_t hard_disk[HARD_DISK_SIZE];
+} snapshot;
+
+void SaveProcessorState(snapshot *save)
+{
+	memcpy(save -> register_file, register_file, sizeof(register_file));
+	save -> pc = pc;
+	save -> sp = sp;
+	save -> instruction_register = instruction_register;
+	save -> time = time;
+	save -> control = control;
+	save -> interrupt_enable = interrupt_enable;
+	save -> halt_enable = halt_enable;
+	save -> interrupt_request = interrupt_request;
+	save -> interrupt_vector = interrupt_vector;
+
+	save -> storage_op_completion_time = storage_op_completion_time;
+	save -> storage_state = storage_state;
+	save -> kb_op_completion_time = kb_op_completion_time;
+	save -> kb_state = kb_state;
+	memcpy(save -> io, io, PORTS);
+}
+
+void RestoreProcessorState(snapshot *save)
+{
+	memcpy(register_file, save -> register_file, sizeof(register_file));
+	pc = save -> pc;
+	sp = save -> sp;
+	instruction_register = save -> instruction_register;
+	time = save -> time;
+	control = save -> control;
+	interrupt_enable = save -> interrupt_enable;
+	halt_enable = save -> halt_enable;
+	interrupt_request = save -> interrupt_request;
+	interrupt_vector = save -> interrupt_vector;
+
+	storage_op_completion_time = save -> storage_op_completion_time;
+	storage_state = save -> storage_state;
+	kb_op_completion_time = save -> kb_op_completion_time;
+	kb_state = save -> kb_state;
+	memcpy(io, save -> io, PORTS);
+}
+
+void SaveMachineState(snapshot *save)
+{
+	SaveProcessorState(save);
+	memcpy(save -> address_space, address_space, ADDRESSED_SPACE_SIZE);
+	memcpy(save -> hard_disk, hard_disk, HARD_DISK_SIZE);
+}
+
+void RestoreMachineState(snapshot *save)
+{
+	RestoreProcessorState(save);
+	memcpy(address_space, save -> address_space, ADDRESSED_SPACE_SIZE);
+	memcpy(hard_disk, save -> hard_disk, HARD_DISK_SIZE);
+}
+
+/*
+ * Dirty Page Tracking
+ * address_space and hard_disk are moved to page-aligned mappings that are
+ * write-protected after each restore. The first write to a page faults;
+ * the handler marks the page dirty and unprotects it, so a restore only
+ * copies (and re-protects) the pages written since the last one.
+ */
+typedef struct tracked_memory_region
+{
+	uint8_t *start;
+	uint8_t dirty[MAX_TRACKED_PAGES];
+} tracked_region;
+
+tracked_region tracked_memory, tracked_disk;
+long host_page_size;
+uint8_t dirty_tracking = 0;
+
+int MarkPageDirty(tracked_region *region, uint8_t *address)
+{
+	long page;
+
+	if(address < region -> start || address >= region -> start + TRACKED_REGION_SIZE)
+	{
+		return 0;
+	}
+
+	page = (address - region -> start) / host_page_size;
+	region -> dirty[page] = 1;
+	mprotect(region -> start + page * host_page_size, host_page_size, PROT_READ | PROT_WRITE);
+
+	return 1;
+}
+
+void DirtyPageFault(int signal_number, siginfo_t *info, void *context)
+{
+	(void)signal_number;
+	(void)context;
+
+	if(!MarkPageDirty(&tracked_memory, info -> si_addr) && !MarkPageDirty(&tracked_disk, info -> si_addr))
+	{
+		//a real fault; let it happen again without the handler
+		signal(SIGSEGV, SIG_DFL);
+	}
+}
+
+uint8_t *MoveToTrackedRegion(tracked_region *region, uint8_t *old_location, int size)
+{
+	region -> start = mmap(NULL, TRACKED_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(region -> start == MAP_FAILED)
+	{
+		printf("Couldn't map memory for dirty page tracking.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	memcpy(region -> start, old_location, size);
+	memset(region -> dirty, 0, MAX_TRACKED_PAGES);
+	ReleaseMemory(old_location);
+
+	mprotect(region -> start, TRACKED_REGION_SIZE, PROT_READ);
+
+	return region -> start;
+}
+
+void StartDirtyTracking()
+{
+	struct sigaction action;
+
+	host_page_size = sysconf(_SC_PAGESIZE);
+
+	if(host_page_size <= 0 || TRACKED_REGION_SIZE / host_page_size > MAX_TRACKED_PAGES)
+	{
+		printf("Unsupported host page size %ld.\n", host_page_size);
+		exit(EXIT_FAILURE);
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = DirtyPageFault;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV, &action, NULL);
+
+	address_space = MoveToTrackedRegion(&tracked_memory, address_space, ADDRESSED_SPACE_SIZE);
+	memory = address_space + MEMORY_START_ADDRESS;
+	video_memory = address_space + VIDEO_MEM_START_ADDRESS;
+
+	hard_disk = MoveToTrackedRegion(&tracked_disk, hard_disk, HARD_DISK_SIZE);
+
+	dirty_tracking = 1;
+}
+
+void RestoreDirtyRegion(tracked_region *region, uint8_t *saved, int size)
+{
+	long page, offset, length;
+
+	for(page = 0; page < TRACKED_REGION_SIZE / host_page_size; page++)
+	{
+		if(!region -> dirty[page])
+		{
+			continue;
+		}
+
+		offset = page * host_page_size;
+		length = (offset + host_page_size > size) ? size - offset : host_page_size;
+
+		if(length > 0)
+		{
+			memcpy(region -> start + offset, saved + offset, length);
+		}
+
+		mprotect(region -> start + offset, host_page_size, PROT_READ);
+		region -> dirty[page] = 0;
+	}
+}
+
+//Restores a snapshot taken while tracking, copying only the dirty pages
+void RestoreDirtyPages(snapshot *save)
+{
+	RestoreProcessorState(save);
+	RestoreDirtyRegion(&tracked_memory, save -> address_space, ADDRESSED_SPACE_SIZE);
+	RestoreDirtyRegion(&tracked_disk, save -> hard_disk, HARD_DISK_SIZE);
+}
@@ -0,0 +1,28 @@
+/************************************************************************
+ * 8080 Emulator Random Numbers						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * SplitMix64, for test inputs that have to come out the same on	*
+ * every run and every host						*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+//Advances state and returns the next number; any seed, including 0, is fine
+static inline uint64_t SplitMix64(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+	return z ^ (z >> 31);
+}
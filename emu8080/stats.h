@@ -0,0 +1,226 @@
+/************************************************************************
+ * 8080 Emulator Run Statistics						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Throughput and event counters, reported as periodic lines in a log	*
+ * file and to anyone who connects to a Unix-domain socket, both	*
+ * served from the emulation loop without blocking it			*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define STATS_CHECK_CYCLES	100000		//emulated cycles between host clock reads (under a millisecond at full speed)
+#define STATS_SOCKET_MS		10		//longest wait for a connection to be answered
+#define STATS_LINE_SIZE		512
+
+//Counters at the start of a reporting period
+typedef struct stats_point_entry
+{
+	struct timeval when;
+	uint64_t instructions;
+	uint64_t cycles;
+} stats_point;
+
+uint8_t stats_enabled = 0;
+char *stats_socket_file = NULL,
+     *stats_log_file = NULL;
+uint32_t stats_interval = 1000;			//ms between log lines
+
+uint64_t stats_instructions = 0,
+	 stats_cycles = 0;			//time, without its 32-bit wraparound
+uint32_t stats_last_time = 0,
+	 stats_next = 0;			//time of the next host clock read
+stats_point stats_start, stats_last_line, stats_last_service;
+
+int stats_listener = -1;
+FILE *stats_log = NULL;
+
+void StatsNow(stats_point *point)
+{
+	gettimeofday(&(point -> when), NULL);
+	point -> instructions = stats_instructions;
+	point -> cycles = stats_cycles;
+}
+
+static inline double StatsSeconds(struct timeval *from, struct timeval *to)
+{
+	return (to -> tv_sec - from -> tv_sec) + (to -> tv_usec - from -> tv_usec) / 1e6;
+}
+
+/*
+ * One line of key=value pairs, the rates taken over the period since "since":
+ * seconds instructions cycles ns_per_instruction mips speed interrupts device_events decode_hit_rate
+ * speed is emulated time over real time (1.0 is a 2.5 MHz 8080)
+ */
+void FormatStats(char *line, size_t size, stats_point *since, stats_point *now)
+{
+	double seconds = StatsSeconds(&(since -> when), &(now -> when)),
+	       instructions = now -> instructions - since -> instructions,
+	       cycles = now -> cycles - since -> cycles,
+	       lookups = (double)decode_cache_hits + decode_cache_misses;
+
+	if(seconds <= 0)
+	{
+		seconds = 1e-6;
+	}
+
+	snprintf(line, size, "seconds=%.3f instructions=%llu cycles=%llu ns_per_instruction=%.2f mips=%.2f speed=%.2f"
+		" interrupts=%lu device_events=%lu decode_hit_rate=%.4f\n",
+		StatsSeconds(&(stats_start.when), &(now -> when)),
+		(unsigned long long)now -> instructions, (unsigned long long)now -> cycles,
+		instructions ? seconds * 1e9 / instructions : 0, instructions / seconds / 1e6,
+		cycles / seconds / CLOCK_RATE,
+		(unsigned long)interrupts_taken, (unsigned long)device_events,
+		lookups ? decode_cache_hits / lookups : 0);
+}
+
+//Answers every waiting connection with one line of totals since the start, then closes it
+void ServeStatsSocket(stats_point *now)
+{
+	char line[STATS_LINE_SIZE];
+	int client;
+
+	while((client = accept(stats_listener, NULL, NULL)) >= 0)
+	{
+		FormatStats(line, sizeof(line), &stats_start, now);
+
+		//a client that isn't reading loses the line rather than stalling the emulator
+		send(client, line, strlen(line), MSG_DONTWAIT | MSG_NOSIGNAL);
+		close(client);
+	}
+}
+
+void StatsCheck()
+{
+	stats_point now;
+	char line[STATS_LINE_SIZE];
+
+	stats_cycles += (uint32_t)(time - stats_last_time);
+	stats_last_time = time;
+	stats_next = time + STATS_CHECK_CYCLES;
+	StatsNow(&now);
+
+	if(stats_listener >= 0 && StatsSeconds(&(stats_last_service.when), &(now.when)) * 1000 >= STATS_SOCKET_MS)
+	{
+		ServeStatsSocket(&now);
+		stats_last_service = now;
+	}
+
+	if(stats_log != NULL && StatsSeconds(&(stats_last_line.when), &(now.when)) * 1000 >= stats_interval)
+	{
+		FormatStats(line, sizeof(line), &stats_last_line, &now);
+		fputs(line, stats_log);
+		fflush(stats_log);
+		stats_last_line = now;
+	}
+}
+
+//Called after every instruction; the host clock is only read once enough emulated time has passed
+static inline void CountInstruction()
+{
+	stats_instructions++;
+
+	if((int32_t)(time - stats_next) >= 0)
+	{
+		StatsCheck();
+	}
+}
+
+int StartStats()
+{
+	struct sockaddr_un address;
+	struct stat existing;
+
+	if(stats_log_file != NULL && (stats_log = fopen(stats_log_file, "a")) == NULL)
+	{
+		printf("Couldn't open stats log %s.\n", stats_log_file);
+		return EXIT_FAILURE;
+	}
+
+	if(stats_socket_file != NULL)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+
+		if(strlen(stats_socket_file) >= sizeof(address.sun_path))
+		{
+			printf("Stats socket path %s is too long.\n", stats_socket_file);
+			return EXIT_FAILURE;
+		}
+
+		strcpy(address.sun_path, stats_socket_file);
+
+		//a socket left by an earlier run is replaced, but nothing else is
+		if(lstat(stats_socket_file, &existing) == 0)
+		{
+			if(!S_ISSOCK(existing.st_mode))
+			{
+				printf("%s exists and isn't a socket.\n", stats_socket_file);
+				return EXIT_FAILURE;
+			}
+
+			unlink(stats_socket_file);
+		}
+
+		if((stats_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0
+		|| bind(stats_listener, (struct sockaddr *)&address, sizeof(address)) < 0
+		|| listen(stats_listener, 8) < 0)
+		{
+			printf("Couldn't open stats socket %s.\n", stats_socket_file);
+			return EXIT_FAILURE;
+		}
+	}
+
+	stats_last_time = time;
+	stats_next = time + STATS_CHECK_CYCLES;
+	StatsNow(&stats_start);
+	stats_last_line = stats_start;
+	stats_last_service = stats_start;
+
+	//so an interrupted run still logs its totals and removes the socket
+	signal(SIGINT, StopOnSignal);
+	signal(SIGTERM, StopOnSignal);
+
+	return EXIT_SUCCESS;
+}
+
+//Logs the whole run as a last line and removes the socket
+void StopStats()
+{
+	stats_point now;
+	char line[STATS_LINE_SIZE];
+
+	stats_cycles += (uint32_t)(time - stats_last_time);
+	stats_last_time = time;
+	StatsNow(&now);
+
+	if(stats_log != NULL)
+	{
+		FormatStats(line, sizeof(line), &stats_start, &now);
+		fputs(line, stats_log);
+		fclose(stats_log);
+		stats_log = NULL;
+	}
+
+	if(stats_listener >= 0)
+	{
+		close(stats_listener);
+		unlink(stats_socket_file);
+		stats_listener = -1;
+	}
+}
@@ -23,11 +23,19 @@
 
 FILE *storage = NULL;
 
-void LoadNonVolatileMemory(uint8_t *hard_disk)
+//device state (kept outside NonVolatileMemoryOperation so it can be saved and restored with the machine)
+uint32_t storage_op_completion_time = INT_MAX;
+io_state storage_state = READY;
+
+int LoadNonVolatileMemory(uint8_t *hard_disk)
 {
 	int i;
 	
-	storage = fopen("storage", "r");
+	if((storage = fopen("storage", "r")) == NULL)
+	{
+		printf("Couldn't open the storage file (storage) in the current directory.\n");
+		return EXIT_FAILURE;
+	}
 
 	for(i = 0; i < HARD_DISK_SIZE; i++)
 	{
@@ -36,13 +44,19 @@ void LoadNonVolatileMemory(uint8_t *hard_disk)
 
 	fclose(storage);
 	storage = NULL;
+
+	return EXIT_SUCCESS;
 }
 
 void StoreNonVolatileMemory(uint8_t *hard_disk)
 {
 	int i;
 
-	storage = fopen("storage", "w");
+	if((storage = fopen("storage", "w")) == NULL)
+	{
+		printf("Couldn't write the storage file (storage) in the current directory.\n");
+		return;
+	}
 
 	for(i = 0; i < HARD_DISK_SIZE; i++)
 	{
@@ -65,8 +79,6 @@ void StoreNonVolatileMemory(uint8_t *hard_disk)
 
 void NonVolatileMemoryOperation()
 {
-	static int storage_op_completion_time = INT_MAX;
-	static io_state storage_state = READY;
 	uint16_t address;
 
 	switch(storage_state)
@@ -98,8 +110,9 @@ void NonVolatileMemoryOperation()
 				{
 					//state output
 					address = (memory[NV_MEM_ADDR_HIGH] << 8) + memory[NV_MEM_ADDR_LOW];
-					memory[address] = memory[NV_MEM_DATA_REG];
+					WriteByte(address, memory[NV_MEM_DATA_REG]);
 					storage_op_completion_time = INT_MAX;
+					device_events++;
 
 					memory[NV_MEM_CTRL_REG] |= DONE;
 					//next state
@@ -123,6 +136,7 @@ void NonVolatileMemoryOperation()
 
 					memory[NV_MEM_CTRL_REG] |= DONE;
 					storage_op_completion_time = INT_MAX;
+					device_events++;
 
 					//next state
 					storage_state = OP_COMPLETE;
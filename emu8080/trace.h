@@ -0,0 +1,329 @@
+/************************************************************************
+ * 8080 Emulator Instruction Trace					*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Binary records of executed instructions, passed through a ring in	*
+ * shared memory to a drain process that writes them to a file and	*
+ * decodes the last of them when the emulator halts or dies		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define TRACE_MAGIC		"TRC8080"	//8 bytes with the terminator
+#define TRACE_RING_RECORDS	(1 << 16)	//power of 2
+#define TRACE_CACHE_LINE	64
+#define TRACE_REGISTERS		8		//register_file up to and including STATUS
+
+/*
+ * Trace File (binary, little-endian)
+ * 8 bytes	- "TRC8080\0"
+ * 20 bytes	- one trace_record per executed instruction, oldest first
+ */
+typedef struct trace_record_entry
+{
+	uint32_t cycle;				//time after the instruction
+	uint16_t pc;				//address of the instruction
+	uint16_t sp;				//after the instruction
+	uint8_t opcode;				//executed opcode (RST n for an interrupt)
+	uint8_t operands[2];			//the two bytes after the opcode
+	uint8_t changed;			//bit n set if register_file[n] changed
+	uint8_t registers[TRACE_REGISTERS];	//register_file after the instruction
+} trace_record;
+
+/*
+ * The ring is shared with the drain process, which has no locks to take:
+ * the emulator only writes head and the records at or past it, and the
+ * drain process only writes tail, each published with release ordering.
+ */
+typedef struct trace_ring_header
+{
+	uint64_t head __attribute__ ((aligned (TRACE_CACHE_LINE)));	//records written by the emulator
+	uint64_t tail __attribute__ ((aligned (TRACE_CACHE_LINE)));	//records written to the file
+	uint32_t finished;						//the emulator has stopped
+	trace_record records[TRACE_RING_RECORDS] __attribute__ ((aligned (TRACE_CACHE_LINE)));
+} trace_ring;
+
+trace_ring *trace_buffer = NULL;
+uint8_t trace_enabled = 0;
+char *trace_file = NULL;
+uint32_t trace_last = 64;			//records decoded when the run ends
+uint64_t trace_limit = 0;			//head may reach this before tail is read again
+uint8_t trace_previous[TRACE_REGISTERS];
+pid_t trace_drain_pid = 0;
+
+//Register names in register_file order
+const char *const trace_register_names[TRACE_REGISTERS] = {"C", "B", "E", "D", "L", "H", "A", "F"};
+
+//Called after the instruction at address has executed
+static inline void RecordTrace(uint16_t address)
+{
+	uint64_t head = trace_buffer -> head;
+	trace_record *record;
+	uint8_t i, changed = 0;
+
+	//a full ring waits for the drain process
+	while(head == trace_limit)
+	{
+		trace_limit = __atomic_load_n(&(trace_buffer -> tail), __ATOMIC_ACQUIRE) + TRACE_RING_RECORDS;
+	}
+
+	record = &(trace_buffer -> records[head & (TRACE_RING_RECORDS - 1)]);
+
+	for(i = 0; i < TRACE_REGISTERS; i++)
+	{
+		changed |= (register_file[i] != trace_previous[i]) << i;
+	}
+
+	record -> cycle = time;
+	record -> pc = address;
+	record -> sp = sp;
+	record -> opcode = instruction_register;
+	record -> operands[0] = memory[(uint16_t)(address + 1)];
+	record -> operands[1] = memory[(uint16_t)(address + 2)];
+	record -> changed = changed;
+	memcpy(record -> registers, register_file, TRACE_REGISTERS);
+	memcpy(trace_previous, register_file, TRACE_REGISTERS);
+
+	__atomic_store_n(&(trace_buffer -> head), head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Writes one record as text, with the registers that changed and SP if it moved:
+ * <cycle> <address>  <bytes>  <instruction>  <register>=<value>...
+ */
+void PrintTraceRecord(FILE *file, trace_record *record, trace_record *previous)
+{
+	const char *name = instruction_set_data[record -> opcode].name, *field;
+	uint8_t size = instruction_set_data[record -> opcode].size, i;
+	uint16_t word = record -> operands[0] + (record -> operands[1] << 8);
+	char text[32] = "", bytes[12];
+
+	//the operand replaces the D8, D16 or ADR in the instruction's name
+	if((field = strstr(name, "D8")) != NULL)
+	{
+		snprintf(text, sizeof(text), "%.*s%02x%s", (int)(field - name), name, record -> operands[0], field + 2);
+	}
+	else if((field = strstr(name, "D16")) != NULL || (field = strstr(name, "ADR")) != NULL)
+	{
+		snprintf(text, sizeof(text), "%.*s%04x%s", (int)(field - name), name, word, field + 3);
+	}
+	else
+	{
+		snprintf(text, sizeof(text), "%s", name);
+	}
+
+	snprintf(bytes, sizeof(bytes), size == 1 ? "%02x" : size == 2 ? "%02x %02x" : "%02x %02x %02x",
+		record -> opcode, record -> operands[0], record -> operands[1]);
+
+	fprintf(file, "%10lu %04x  %-8s  %-14s", (unsigned long)record -> cycle, record -> pc, bytes, text);
+
+	for(i = 0; i < TRACE_REGISTERS; i++)
+	{
+		if(record -> changed & (1 << i))
+		{
+			fprintf(file, " %s=%02x", trace_register_names[i], record -> registers[i]);
+		}
+	}
+
+	if(previous == NULL || previous -> sp != record -> sp)
+	{
+		fprintf(file, " SP=%04x", record -> sp);
+	}
+
+	fprintf(file, "\n");
+}
+
+//Writes all length bytes, going on after short writes and signals
+int WriteFully(int descriptor, const void *bytes, size_t length)
+{
+	const uint8_t *next = bytes;
+	ssize_t written;
+
+	while(length > 0)
+	{
+		if((written = write(descriptor, next, length)) < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			return EXIT_FAILURE;
+		}
+
+		next += written;
+		length -= written;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//Writes the records from first up to end in the ring to descriptor (at most two stretches)
+int WriteTraceRecords(int descriptor, uint64_t first, uint64_t end)
+{
+	uint64_t start = first & (TRACE_RING_RECORDS - 1),
+		 count = end - first;
+	size_t length;
+
+	if(start + count > TRACE_RING_RECORDS)
+	{
+		length = (TRACE_RING_RECORDS - start) * sizeof(trace_record);
+
+		if(WriteFully(descriptor, trace_buffer -> records + start, length) != EXIT_SUCCESS)
+		{
+			return EXIT_FAILURE;
+		}
+
+		count -= TRACE_RING_RECORDS - start;
+		start = 0;
+	}
+
+	length = count * sizeof(trace_record);
+
+	return WriteFully(descriptor, trace_buffer -> records + start, length);
+}
+
+//Decodes the last trace_last records to <trace file>.last
+void WriteLastTraceRecords(uint64_t end)
+{
+	uint64_t first = end > trace_last ? end - trace_last : 0;
+	trace_record *previous = NULL, *record;
+	char *filename = malloc(strlen(trace_file) + sizeof(".last"));
+	FILE *file;
+
+	sprintf(filename, "%s.last", trace_file);
+
+	if((file = fopen(filename, "w")) != NULL)
+	{
+		for(; first < end; first++)
+		{
+			record = &(trace_buffer -> records[first & (TRACE_RING_RECORDS - 1)]);
+			PrintTraceRecord(file, record, previous);
+			previous = record;
+		}
+
+		fclose(file);
+	}
+
+	free(filename);
+}
+
+/*
+ * Drain process: copies the ring to the file as records arrive. It ends when
+ * the emulator finishes or, if the emulator crashed, when it is no longer
+ * this process's parent; either way the last records are decoded.
+ */
+void DrainTrace(int descriptor, pid_t parent)
+{
+	uint64_t head, tail = 0;
+	uint32_t finished;
+	uint8_t writing = 1;
+
+	//Ctrl-C is for the emulator, which then finishes normally
+	signal(SIGINT, SIG_IGN);
+	signal(SIGTERM, SIG_IGN);
+
+	while(1)
+	{
+		finished = __atomic_load_n(&(trace_buffer -> finished), __ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&(trace_buffer -> head), __ATOMIC_ACQUIRE);
+
+		if(head == tail)
+		{
+			if(finished || getppid() != parent)
+			{
+				break;
+			}
+
+			usleep(1000);
+			continue;
+		}
+
+		//after a failed write the ring is still emptied so the emulator never waits on it
+		if(writing && WriteTraceRecords(descriptor, tail, head) != EXIT_SUCCESS)
+		{
+			printf("Couldn't write trace file %s.\n", trace_file);
+			writing = 0;
+		}
+
+		tail = head;
+		__atomic_store_n(&(trace_buffer -> tail), tail, __ATOMIC_RELEASE);
+	}
+
+	close(descriptor);
+
+	if(trace_last > TRACE_RING_RECORDS)
+	{
+		trace_last = TRACE_RING_RECORDS;
+	}
+
+	if(trace_last)
+	{
+		WriteLastTraceRecords(head);
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+int StartTrace()
+{
+	int descriptor;
+	pid_t parent = getpid();
+
+	if((descriptor = open(trace_file, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+	{
+		printf("Couldn't open trace file %s.\n", trace_file);
+		return EXIT_FAILURE;
+	}
+
+	trace_buffer = mmap(NULL, sizeof(trace_ring), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if(trace_buffer == MAP_FAILED || write(descriptor, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != sizeof(TRACE_MAGIC))
+	{
+		printf("Couldn't start the trace.\n");
+		close(descriptor);
+		return EXIT_FAILURE;
+	}
+
+	trace_limit = TRACE_RING_RECORDS;
+	memcpy(trace_previous, register_file, TRACE_REGISTERS);
+
+	if((trace_drain_pid = fork()) == 0)
+	{
+		DrainTrace(descriptor, parent);
+	}
+
+	close(descriptor);
+
+	if(trace_drain_pid < 0)
+	{
+		printf("Couldn't start the trace.\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//Waits for the drain process to write out the rest of the ring
+void StopTrace()
+{
+	__atomic_store_n(&(trace_buffer -> finished), 1, __ATOMIC_RELEASE);
+	waitpid(trace_drain_pid, NULL, 0);
+	munmap(trace_buffer, sizeof(trace_ring));
+	trace_buffer = NULL;
+}
@@ -0,0 +1,107 @@
+/************************************************************************
+ * 8080 Trace Decoder							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Prints the instruction trace written by the emulator's -trace	*
+ * option, one executed instruction per line				*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include "machine.h"
+#include "instruction_set.h"
+#include "trace.h"
+
+#define TRACE_READ_RECORDS	4096
+
+/*
+ * Prints the records in filename, or only the last <last> of them.
+ * The first record printed shows SP, later ones only when it moves.
+ */
+int DecodeTrace(char *filename, uint64_t last)
+{
+	FILE *file;
+	char magic[sizeof(TRACE_MAGIC)];
+	trace_record *records = malloc(TRACE_READ_RECORDS * sizeof(trace_record)), previous;
+	uint64_t total, skip = 0;
+	size_t count, i;
+	uint8_t have_previous = 0;
+
+	if((file = fopen(filename, "rb")) == NULL)
+	{
+		printf("Couldn't open trace file %s.\n", filename);
+		free(records);
+		return EXIT_FAILURE;
+	}
+
+	if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+	{
+		printf("%s is not a trace file.\n", filename);
+		fclose(file);
+		free(records);
+		return EXIT_FAILURE;
+	}
+
+	if(last)
+	{
+		fseek(file, 0, SEEK_END);
+		total = (ftell(file) - sizeof(magic)) / sizeof(trace_record);
+		skip = total > last ? total - last : 0;
+		fseek(file, sizeof(magic) + skip * sizeof(trace_record), SEEK_SET);
+	}
+
+	while((count = fread(records, sizeof(trace_record), TRACE_READ_RECORDS, file)) > 0)
+	{
+		for(i = 0; i < count; i++)
+		{
+			PrintTraceRecord(stdout, records + i, have_previous ? &previous : NULL);
+			previous = records[i];
+			have_previous = 1;
+		}
+	}
+
+	fclose(file);
+	free(records);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	char *filename = NULL;
+	uint64_t last = 0;
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-last") == 0 && i + 1 < argc)
+		{
+			last = strtoull(argv[++i], NULL, 0);
+		}
+		else if(filename == NULL)
+		{
+			filename = argv[i];
+		}
+		else
+		{
+			filename = NULL;
+			break;
+		}
+	}
+
+	if(filename == NULL)
+	{
+		printf("Usage: %s [-last <count>] <trace file>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	return DecodeTrace(filename, last);
+}
@@ -0,0 +1,342 @@
+/************************************************************************
+ * 8080 Emulator UI Process						*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Keyboard input, the status panel and the video window served by a	*
+ * process of their own, so the terminal and the X server never hold	*
+ * up the emulator; keys arrive through a lock-free queue and states	*
+ * go back through a triple buffer					*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define UI_RATE			60		//Hz, in host time: states published by the emulator
+#define UI_QUEUE_SIZE		256		//keys waiting for the emulator (power of 2)
+#define UI_CACHE_LINE		64
+#define UI_FRESH		0x04		//set in middle while the UI hasn't taken that buffer
+
+//A key and the emulated time it is delivered at (the time of the last state the UI had)
+typedef struct ui_event_entry
+{
+	uint32_t cycle;
+	uint8_t key;
+} ui_event;
+
+//What the UI shows of the machine
+typedef struct ui_state_entry
+{
+	uint32_t time;
+	uint16_t pc;
+	uint16_t sp;
+	uint8_t registers[8];				//register_file up to and including STATUS
+	uint8_t video[VIDEO_HEIGHT][VIDEO_WIDTH];	//the last frame video.h rendered, when there's a window
+} ui_state;
+
+/*
+ * Shared by the emulator and the UI process (a process rather than a thread, as
+ * pthread.h declares a time() that the processor's time would clash with).
+ * events: the UI writes head and the emulator tail, on separate cache lines.
+ * states: a triple buffer; the emulator fills its back buffer and swaps it into
+ * the middle, the UI swaps the middle into its front buffer when it's fresh,
+ * so neither ever waits for the other.
+ */
+typedef struct ui_buffer_header
+{
+	uint32_t head __attribute__ ((aligned (UI_CACHE_LINE)));
+	uint32_t tail __attribute__ ((aligned (UI_CACHE_LINE)));
+	uint32_t time __attribute__ ((aligned (UI_CACHE_LINE)));	//emulated time of the last state published
+	uint8_t middle;							//buffer index | UI_FRESH
+	uint8_t stopped;
+	ui_event events[UI_QUEUE_SIZE] __attribute__ ((aligned (UI_CACHE_LINE)));
+	ui_state states[3];
+} ui_buffers;
+
+uint8_t ui_process = 0,				//-ui
+	ui_enabled = 0,
+	ui_monitor = 0,				//the UI process draws the status panel
+	ui_window = 0,				//the UI process owns the video window
+	ui_back = 0,				//the emulator's buffer
+	ui_front = 2;				//the UI's buffer
+ui_buffers *ui_shared = NULL;
+pid_t ui_pid = -1;
+volatile sig_atomic_t ui_publish_due = 0;
+uint8_t ui_shown[VIDEO_HEIGHT][VIDEO_WIDTH];	//the frame in the window (UI process)
+
+//Keys for the keyboard device; a key waits in the queue until its time has come
+int UiKeyboardByte()
+{
+	uint32_t tail = ui_shared -> tail;
+	ui_event *event = &(ui_shared -> events[tail & (UI_QUEUE_SIZE - 1)]);
+
+	if(tail == __atomic_load_n(&(ui_shared -> head), __ATOMIC_ACQUIRE) || (int32_t)(time - event -> cycle) < 0)
+	{
+		return ERR;
+	}
+
+	__atomic_store_n(&(ui_shared -> tail), tail + 1, __ATOMIC_RELEASE);
+
+	return event -> key;
+}
+
+void PublishUiState()
+{
+	ui_state *state = &(ui_shared -> states[ui_back]);
+
+	state -> time = time;
+	state -> pc = pc;
+	state -> sp = sp;
+	memcpy(state -> registers, register_file, sizeof(state -> registers));
+
+	if(ui_window)
+	{
+		memcpy(state -> video, video_frame, sizeof(state -> video));
+	}
+
+	__atomic_store_n(&(ui_shared -> time), time, __ATOMIC_RELAXED);
+	ui_back = __atomic_exchange_n(&(ui_shared -> middle), ui_back | UI_FRESH, __ATOMIC_ACQ_REL) & ~UI_FRESH;
+}
+
+void UiTick(int signal_number)
+{
+	(void)signal_number;
+
+	ui_publish_due = 1;
+}
+
+//Called after every instruction; publishes at most UI_RATE states a second
+static inline void UiCheck()
+{
+	if(ui_publish_due)
+	{
+		ui_publish_due = 0;
+		PublishUiState();
+	}
+}
+
+//Queues the keys typed since the last call (UI process); keys that don't fit are dropped
+void QueueUiKeys(struct pollfd *input)
+{
+	uint8_t keys[UI_QUEUE_SIZE];
+	uint32_t head = ui_shared -> head,
+		 tail = __atomic_load_n(&(ui_shared -> tail), __ATOMIC_ACQUIRE),
+		 cycle = __atomic_load_n(&(ui_shared -> time), __ATOMIC_RELAXED);
+	ssize_t count, i;
+
+	if((count = read(STDIN_FILENO, keys, sizeof(keys))) <= 0)
+	{
+		//end of input; poll skips a negative descriptor
+		input -> fd = -1;
+		return;
+	}
+
+	for(i = 0; i < count && head - tail < UI_QUEUE_SIZE; i++)
+	{
+		ui_shared -> events[head & (UI_QUEUE_SIZE - 1)].cycle = cycle;
+		ui_shared -> events[head & (UI_QUEUE_SIZE - 1)].key = keys[i];
+		head++;
+	}
+
+	__atomic_store_n(&(ui_shared -> head), head, __ATOMIC_RELEASE);
+}
+
+//Shows a state (UI process); the status panel draws from this process's copy of the machine
+void ShowUiState(ui_state *state)
+{
+#ifdef VIDEO_X11
+	uint32_t row, first = VIDEO_HEIGHT, last = 0;
+#endif
+
+	time = state -> time;
+	pc = state -> pc;
+	sp = state -> sp;
+	memcpy(register_file, state -> registers, sizeof(state -> registers));
+
+	if(ui_monitor)
+	{
+		PrintMachineState();
+	}
+
+#ifdef VIDEO_X11
+	if(ui_window)
+	{
+		//only the band of rows that differ from the window is drawn
+		for(row = 0; row < VIDEO_HEIGHT; row++)
+		{
+			if(memcmp(state -> video[row], ui_shown[row], VIDEO_WIDTH) != 0)
+			{
+				first = first < row ? first : row;
+				last = row;
+			}
+		}
+
+		if(PollDisplayWindow())
+		{
+			first = 0;
+			last = VIDEO_HEIGHT - 1;
+		}
+
+		if(first <= last)
+		{
+			memcpy(ui_shown, state -> video, sizeof(ui_shown));
+			DrawDisplayRows(state -> video[0], first, last);
+		}
+	}
+#endif
+}
+
+//Takes the middle buffer if the emulator has published since the last call (UI process)
+void TakeUiState()
+{
+	if(__atomic_load_n(&(ui_shared -> middle), __ATOMIC_ACQUIRE) & UI_FRESH)
+	{
+		ui_front = __atomic_exchange_n(&(ui_shared -> middle), ui_front, __ATOMIC_ACQ_REL) & ~UI_FRESH;
+		ShowUiState(&(ui_shared -> states[ui_front]));
+	}
+}
+
+/*
+ * UI process: waits for keys for at most a state's time, then shows the latest
+ * state. It ends when the emulator finishes or, if the emulator crashed, when
+ * it is no longer this process's parent.
+ */
+void RunUi(pid_t parent)
+{
+	struct pollfd input;
+
+	//Ctrl-C is for the emulator, which then finishes normally
+	signal(SIGINT, SIG_IGN);
+	signal(SIGTERM, SIG_IGN);
+
+	if(ui_monitor)
+	{
+		StartMonitor();
+	}
+
+#ifdef VIDEO_X11
+	if(ui_window && OpenDisplayWindow(VIDEO_WIDTH, VIDEO_HEIGHT) != EXIT_SUCCESS)
+	{
+		ui_window = 0;
+	}
+
+	//0x01 is no gray level, so the first frame is drawn whole
+	memset(ui_shown, 0x01, sizeof(ui_shown));
+#endif
+
+	input.fd = STDIN_FILENO;
+	input.events = POLLIN;
+
+	while(!__atomic_load_n(&(ui_shared -> stopped), __ATOMIC_ACQUIRE) && getppid() == parent)
+	{
+		if(poll(&input, 1, 1000 / UI_RATE) > 0 && (input.revents & (POLLIN | POLLHUP)))
+		{
+			QueueUiKeys(&input);
+		}
+
+		TakeUiState();
+	}
+
+	TakeUiState();
+	StopMonitor();
+
+#ifdef VIDEO_X11
+	if(ui_window)
+	{
+		CloseDisplayWindow();
+	}
+#endif
+
+	_exit(EXIT_SUCCESS);
+}
+
+int StartUi()
+{
+	struct sigaction action;
+	struct itimerval period;
+	pid_t parent = getpid();
+
+	if(video_window && !video_window_available)
+	{
+		printf("This emulator was built without the X11 window (-DVIDEO_X11, -lX11).\n");
+		return EXIT_FAILURE;
+	}
+
+	ui_shared = mmap(NULL, sizeof(ui_buffers), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if(ui_shared == MAP_FAILED)
+	{
+		ui_shared = NULL;
+		printf("Couldn't start the UI process.\n");
+		return EXIT_FAILURE;
+	}
+
+	ui_shared -> middle = 1;
+
+	//the window belongs to the UI process; video.h only renders the frames
+	ui_window = video_window;
+	video_window = 0;
+
+	fflush(stdout);
+
+	if((ui_pid = fork()) == 0)
+	{
+		RunUi(parent);
+	}
+
+	if(ui_pid < 0)
+	{
+		printf("Couldn't start the UI process.\n");
+		return EXIT_FAILURE;
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = UiTick;
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &action, NULL);
+
+	period.it_interval.tv_sec = 0;
+	period.it_interval.tv_usec = 1000000 / UI_RATE;
+	period.it_value = period.it_interval;
+	setitimer(ITIMER_REAL, &period, NULL);
+
+	//so an interrupted run still lets the UI process restore the terminal
+	signal(SIGINT, StopOnSignal);
+	signal(SIGTERM, StopOnSignal);
+
+	PublishUiState();
+	ui_enabled = 1;
+
+	return EXIT_SUCCESS;
+}
+
+//Publishes the final state and waits for the UI process to show it and finish
+void StopUi()
+{
+	struct itimerval stopped;
+
+	memset(&stopped, 0, sizeof(stopped));
+	setitimer(ITIMER_REAL, &stopped, NULL);
+	signal(SIGALRM, SIG_DFL);
+
+	PublishUiState();
+	__atomic_store_n(&(ui_shared -> stopped), 1, __ATOMIC_RELEASE);
+	waitpid(ui_pid, NULL, 0);
+
+	munmap(ui_shared, sizeof(ui_buffers));
+	ui_shared = NULL;
+	ui_enabled = 0;
+}
@@ -0,0 +1,288 @@
+/************************************************************************
+ * 8080 Emulator Video							*
+ * Pramuka Perera							*
+ * October 19, 2026							*
+ * Framebuffer for video memory: once per emulated frame the rows	*
+ * stored to since the last frame are converted to gray pixels, then	*
+ * shown in an X11 window or captured as PPM or Y4M frames		*
+ ************************************************************************/
+
+#ifndef INCLUDE
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <stdint.h>
+	#include <string.h>
+	#include "common.h"
+
+	#define INCLUDE
+#endif
+
+#ifdef VIDEO_X11
+	#include "display.h"
+#endif
+
+#define VIDEO_FRAME_RATE	60				//frames per emulated second
+#define VIDEO_FRAME_CYCLES	(CLOCK_RATE / VIDEO_FRAME_RATE)
+#define VIDEO_NAME_SIZE		4096
+
+/*
+ * Frame Capture (-frames <file>)
+ * .y4m - one 8-bit gray (mono) Y4M stream at 60 frames per second, every frame
+ * .ppm - binary PPM images one after another in the file, for the frames that changed
+ * otherwise an existing directory, given <directory>/frame_<n>.ppm for each frame that changed
+ */
+typedef enum video_capture_format
+{
+	NO_CAPTURE,
+	PPM_FILES,
+	PPM_STREAM,
+	Y4M_STREAM
+} video_capture;
+
+uint8_t video_enabled = 0,
+	video_window = 0;				//-window (X11 builds only)
+char *frame_file = NULL;
+video_capture frame_format = NO_CAPTURE;
+FILE *frame_stream = NULL;
+
+#ifdef VIDEO_X11
+uint8_t video_window_available = 1;
+#else
+uint8_t video_window_available = 0;
+#endif
+
+//Gray level of each pixel (one byte per pixel) and of each 2-bit pixel value
+uint8_t video_frame[VIDEO_HEIGHT][VIDEO_WIDTH];
+const uint8_t video_gray_levels[4] = {0x00, 0x55, 0xaa, 0xff};
+uint8_t video_expansion[256][4];			//the four pixels of every byte value
+
+uint32_t video_frame_deadline = 0,
+	 video_frames = 0;				//emulated frames so far
+
+/*
+ * Converts the rows marked by the stores (MarkStore) and clears their marks.
+ * Returns the number converted, and the first and last of them.
+ */
+uint32_t ConvertDirtyRows(uint32_t *first, uint32_t *last)
+{
+	uint32_t row, column, converted = 0;
+	uint8_t *bytes;
+
+	for(row = 0; row < VIDEO_HEIGHT; row++)
+	{
+		if(!video_dirty_rows[row])
+		{
+			continue;
+		}
+
+		video_dirty_rows[row] = 0;
+		bytes = video_memory + row * VIDEO_ROW_BYTES;
+
+		for(column = 0; column < VIDEO_ROW_BYTES; column++)
+		{
+			memcpy(video_frame[row] + column * 4, video_expansion[bytes[column]], 4);
+		}
+
+		if(converted == 0)
+		{
+			*first = row;
+		}
+
+		*last = row;
+		converted++;
+	}
+
+	return converted;
+}
+
+//PPM frames are gray, so each level is written as three equal channels
+void WritePpmFrame(FILE *file)
+{
+	uint8_t line[VIDEO_WIDTH * 3];
+	uint32_t row, column;
+
+	fprintf(file, "P6\n%d %d\n255\n", VIDEO_WIDTH, VIDEO_HEIGHT);
+
+	for(row = 0; row < VIDEO_HEIGHT; row++)
+	{
+		for(column = 0; column < VIDEO_WIDTH; column++)
+		{
+			memset(line + column * 3, video_frame[row][column], 3);
+		}
+
+		fwrite(line, sizeof(line), 1, file);
+	}
+}
+
+void CaptureFrame(uint32_t changed)
+{
+	char filename[VIDEO_NAME_SIZE];
+	FILE *file;
+
+	switch(frame_format)
+	{
+	case Y4M_STREAM:
+		fprintf(frame_stream, "FRAME\n");
+		fwrite(video_frame, sizeof(video_frame), 1, frame_stream);
+		break;
+	case PPM_STREAM:
+		if(changed)
+		{
+			WritePpmFrame(frame_stream);
+		}
+		break;
+	case PPM_FILES:
+		if(!changed)
+		{
+			break;
+		}
+
+		snprintf(filename, sizeof(filename), "%s/frame_%06u.ppm", frame_file, video_frames);
+
+		if((file = fopen(filename, "wb")) == NULL)
+		{
+			printf("Couldn't write frame %s.\n", filename);
+			break;
+		}
+
+		WritePpmFrame(file);
+		fclose(file);
+		break;
+	case NO_CAPTURE:
+	default:
+		break;
+	};
+}
+
+//Ends an emulated frame: converts the dirty rows once, then passes the frame on
+void VideoFrame()
+{
+	uint32_t first = 0, last = 0,
+		 changed = ConvertDirtyRows(&first, &last);
+
+#ifdef VIDEO_X11
+	if(video_window)
+	{
+		if(PollDisplayWindow())
+		{
+			first = 0;
+			last = VIDEO_HEIGHT - 1;
+			changed = VIDEO_HEIGHT;
+		}
+
+		if(changed)
+		{
+			DrawDisplayRows(video_frame[0], first, last);
+		}
+	}
+#endif
+
+	CaptureFrame(changed);
+
+	video_frames++;
+	video_frame_deadline += VIDEO_FRAME_CYCLES;
+}
+
+//Called after every instruction; the rendering itself only happens once a frame
+static inline void VideoCheck()
+{
+	if((int32_t)(time - video_frame_deadline) >= 0)
+	{
+		VideoFrame();
+	}
+}
+
+int StartVideo()
+{
+	size_t length;
+	uint32_t value, pixel;
+
+	if(video_window && !video_window_available)
+	{
+		printf("This emulator was built without the X11 window (-DVIDEO_X11, -lX11).\n");
+		return EXIT_FAILURE;
+	}
+
+	if(frame_file != NULL)
+	{
+		length = strlen(frame_file);
+
+		if(length > 4 && strcmp(frame_file + length - 4, ".y4m") == 0)
+		{
+			frame_format = Y4M_STREAM;
+		}
+		else if(length > 4 && strcmp(frame_file + length - 4, ".ppm") == 0)
+		{
+			frame_format = PPM_STREAM;
+		}
+		else
+		{
+			frame_format = PPM_FILES;
+		}
+
+		if(frame_format != PPM_FILES && (frame_stream = fopen(frame_file, "wb")) == NULL)
+		{
+			printf("Couldn't open frame file %s.\n", frame_file);
+			return EXIT_FAILURE;
+		}
+
+		if(frame_format == Y4M_STREAM)
+		{
+			fprintf(frame_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n", VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FRAME_RATE);
+		}
+	}
+
+#ifdef VIDEO_X11
+	if(video_window && OpenDisplayWindow(VIDEO_WIDTH, VIDEO_HEIGHT) != EXIT_SUCCESS)
+	{
+		return EXIT_FAILURE;
+	}
+#endif
+
+	for(value = 0; value < 256; value++)
+	{
+		for(pixel = 0; pixel < 4; pixel++)
+		{
+			video_expansion[value][pixel] = video_gray_levels[(value >> (6 - pixel * 2)) & 0x03];
+		}
+	}
+
+	//the first frame shows whatever video memory already holds
+	memset(video_dirty_rows, 1, sizeof(video_dirty_rows));
+	video_frame_deadline = time + VIDEO_FRAME_CYCLES;
+	video_enabled = 1;
+
+	return EXIT_SUCCESS;
+}
+
+//Finishes the frame in progress, so stores since the last one aren't lost
+void StopVideo()
+{
+	uint32_t first = 0, last = 0,
+		 changed = ConvertDirtyRows(&first, &last);
+
+	if(changed)
+	{
+		CaptureFrame(changed);
+	}
+
+	if(frame_stream != NULL)
+	{
+		fclose(frame_stream);
+		frame_stream = NULL;
+	}
+
+#ifdef VIDEO_X11
+	if(video_window)
+	{
+		if(changed)
+		{
+			DrawDisplayRows(video_frame[0], first, last);
+		}
+
+		CloseDisplayWindow();
+	}
+#endif
+
+	video_enabled = 0;
+}
@@ -16,7 +16,9 @@
 #endif
 
 #include <limits.h>
+#include <signal.h>
 #include <curses.h>
+#include <sys/time.h>
 
 //#define MAX_ROWS	1000
 //#define MAX_COLS	500
@@ -24,6 +26,8 @@
 #define KB_READ_RATE		20	//Hz (80 ms)
 #define KB_READ_PERIOD		(CLOCK_RATE / KB_READ_RATE) //Clock Cycles 
 
+#define MONITOR_RATE		30	//Hz, in host time
+
 int 	max_columns, 
 	max_rows,
 	col,
@@ -31,15 +35,96 @@ int 	max_columns,
 
 WINDOW *monitor;
 
+//device state (kept outside ReadKeyboardInput so it can be saved and restored with the machine)
+uint32_t kb_op_completion_time = INT_MAX;
+io_state kb_state = READY;
+
+//source of key presses; returns ERR when no key is available
+int (*keyboard_source)(void) = getchar;
+
+/*
+ * Status Panel
+ * Each field's value is drawn after its label, and only when it has changed
+ * since the last frame; the labels are drawn once.
+ */
+typedef struct monitor_field_entry
+{
+	uint8_t row;
+	uint8_t column;
+	const char *label;
+	const char *format;
+} monitor_field;
+
+enum monitor_field_index
+{
+	FIELD_B, FIELD_C, FIELD_D, FIELD_E, FIELD_H, FIELD_L, FIELD_A,
+	FIELD_PC, FIELD_SP, FIELD_FLAGS, FIELD_CYCLES,
+	MONITOR_FIELDS
+};
+
+const monitor_field monitor_fields[MONITOR_FIELDS] =
+{
+	{0, 27, "B -> ", "%02lx"},
+	{0, 35, "C -> ", "%02lx"},
+	{0, 43, "D -> ", "%02lx"},
+	{0, 51, "E -> ", "%02lx"},
+	{0, 59, "H -> ", "%02lx"},
+	{0, 67, "L -> ", "%02lx"},
+	{0, 75, "A -> ", "%02lx"},
+	{1, 17, "PC -> ", "%04lx"},
+	{1, 29, "SP -> ", "%04lx"},
+	{1, 41, "FLAGS -> ", "%02lx"},
+	{2, 0, "Cycles -> ", "%-10lu"}
+};
+
+uint8_t monitor_started = 0,
+	monitor_stale = 1;			//every field is drawn in the next frame
+volatile sig_atomic_t monitor_frame_due = 0;
+unsigned long monitor_shown[MONITOR_FIELDS];	//values on the screen
+
+void MonitorTick(int signal_number)
+{
+	(void)signal_number;
+
+	monitor_frame_due = 1;
+}
+
 void StartMonitor()
 {
+	struct sigaction action;
+	struct itimerval period;
+	int i;
+
 	monitor = initscr();
 	cbreak();
 	noecho();
 	nodelay(monitor, FALSE);
 	getmaxyx(monitor, max_rows, max_columns);
 	clear();
+
+	mvaddstr(0, 0, "General Purpose Registers: ");
+	mvaddstr(1, 0, "State Registers: ");
+
+	for(i = 0; i < MONITOR_FIELDS; i++)
+	{
+		mvaddstr(monitor_fields[i].row, monitor_fields[i].column, monitor_fields[i].label);
+	}
+
 	refresh();
+
+	//frames are drawn when the timer has gone off, so the emulator only tests a flag between them
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = MonitorTick;
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &action, NULL);
+
+	period.it_interval.tv_sec = 0;
+	period.it_interval.tv_usec = 1000000 / MONITOR_RATE;
+	period.it_value = period.it_interval;
+	setitimer(ITIMER_REAL, &period, NULL);
+
+	monitor_stale = 1;
+	monitor_started = 1;
 }
 
 /*
@@ -52,8 +137,7 @@ void StartMonitor()
  
 void ReadKeyboardInput()
 {
-	static int kb_op_completion_time = INT_MAX;
-	static io_state kb_state;
+	int key;
 
 	switch (kb_state)
 	{
@@ -72,9 +156,11 @@ void ReadKeyboardInput()
 		if(time >= kb_op_completion_time)
 		{
 			//state output
-			if((memory[KB_DATA_REG] = getchar()) != ERR)
+			if((key = keyboard_source()) != ERR)
 			{
+				memory[KB_DATA_REG] = key;
 				kb_op_completion_time = INT_MAX;
+				device_events++;
 				memory[KB_CTRL_REG] |= DONE;
 
 				//next state
@@ -105,7 +191,7 @@ void ReadKeyboardInput()
 		}
 		break;
 	case OP_COMPLETE:
-		if((memory[NV_MEM_CTRL_REG] & DONE) == 0)
+		if((memory[KB_CTRL_REG] & DONE) == 0)
 		{
 			memory[KB_CTRL_REG] |= RDY;
 			memory[KB_CTRL_REG] &= ~READ_REQUEST;
@@ -143,70 +229,60 @@ void ReadKeyboardInput()
 	*/
 }
 
-void PrintMachineState()
+//Draws the fields that changed since the last frame, from a snapshot of the machine
+void DrawMachineState()
 {
-	char 	data[2],
-		address[4];	
+	unsigned long values[MONITOR_FIELDS] =
+	{
+		b[0], c[0], d[0], e[0], h[0], l[0], a[0],
+		pc, sp, status[0], time
+	};
+	uint8_t changed = 0;
+	int i;
 
-	clear();
-	move(0,0);
-
-	addstr("General Purpose Registers: ");
-
-	sprintf(data, "%02x", b[0]);
-	addstr("B -> ");
-	addstr(data);
-	addstr(" ");
-
-	sprintf(data, "%02x", c[0]);
-	addstr("C -> ");
-	addstr(data);
-	addstr(" ");
-	
-	sprintf(data, "%02x", d[0]);
-	addstr("D -> ");
-	addstr(data);
-	addstr(" ");
-
-	sprintf(data, "%02x", e[0]);
-	addstr("E -> ");
-	addstr(data);
-	addstr(" ");
-
-	sprintf(data, "%02x", h[0]);
-	addstr("H -> ");
-	addstr(data);
-	addstr(" ");
-
-	sprintf(data, "%02x", l[0]);
-	addstr("L -> ");
-	addstr(data);
-	addstr(" ");
-
-	addstr("\n");
-
-	addstr("State Registers: ");
-
-	sprintf(address, "%02x", pc);
-	addstr("PC -> ");
-	addstr(address);
-	addstr(" ");
-	
-	sprintf(address, "%02x", sp);
-	addstr("SP -> ");
-	addstr(address);
-	addstr(" ");
-
-	sprintf(address, "%02x", status[0]);
-	addstr("FLAGS -> ");
-	addstr(address);
-	addstr(" ");
-
-	refresh();	
+	for(i = 0; i < MONITOR_FIELDS; i++)
+	{
+		if(monitor_stale || values[i] != monitor_shown[i])
+		{
+			move(monitor_fields[i].row, monitor_fields[i].column + strlen(monitor_fields[i].label));
+			printw(monitor_fields[i].format, values[i]);
+			monitor_shown[i] = values[i];
+			changed = 1;
+		}
+	}
+
+	monitor_stale = 0;
+
+	if(changed)
+	{
+		refresh();
+	}
+}
+
+//Called after every instruction; draws at most MONITOR_RATE frames a second
+static inline void PrintMachineState()
+{
+	if(monitor_frame_due)
+	{
+		monitor_frame_due = 0;
+		DrawMachineState();
+	}
 }
 
 void StopMonitor()
 {
+	struct itimerval stopped;
+
+	if(!monitor_started)
+	{
+		return;
+	}
+
+	memset(&stopped, 0, sizeof(stopped));
+	setitimer(ITIMER_REAL, &stopped, NULL);
+	signal(SIGALRM, SIG_DFL);
+
+	DrawMachineState();
 	endwin();
+	monitor_started = 0;
 }
-